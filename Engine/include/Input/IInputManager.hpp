@@ -8,10 +8,20 @@ namespace Engine::Input {
         A,
         S,
         D,
+        B,
         Mouse1,
         F1,
         F2,
         F3,
+        F4,
+        F5,
+        F6,
+        F7,
+        F8,
+        F9,
+        F10,
+        F11,
+        F12,
         Size
     };
 
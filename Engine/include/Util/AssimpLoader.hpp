@@ -1,7 +1,23 @@
 #pragma once
 
 #include "Video/Model.hpp"
+#include "Util/MeshData.hpp"
 
 namespace Engine::Util::AssimpLoader {
-    Engine::GL::Model LoadModel(const char* path);
-}
\ No newline at end of file
+    struct LoadOptions {
+        GL::VertexFormat vertexFormat = GL::VertexFormat::Full;
+
+        /// split every mesh into meshlets, so Model::DrawCulled can skip parts of it
+        bool buildMeshlets = false;
+
+        /// detail levels to build for Model::SelectLod, each with half the triangles of the previous one.
+        /// 1 means just the mesh as it was loaded
+        size_t lodLevels = 1;
+    };
+
+    Engine::GL::Model LoadModel(const char* path, const LoadOptions& options = LoadOptions());
+
+    /// Loads every mesh in a file into a single CPU side mesh, without uploading anything or loading textures.
+    /// Only positions, normals and indices are filled in, meant for occluders and other geometry only the CPU looks at
+    MeshData LoadMeshData(const char* path);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Engine::Util {
+    /// A light's reach as far as binning goes, in world space. Point lights have a cosAngle of -1
+    struct ClusterLight {
+        glm::vec3 position;
+        float radius;
+
+        /// which way a spot light points, normalized
+        glm::vec3 direction;
+
+        /// cosine of the angle between the spot light's axis and the edge of its cone
+        float cosAngle;
+    };
+
+    /// How full the clusters ended up after a Build
+    struct ClusterStats {
+        size_t nonEmpty = 0;
+
+        /// light indices over all clusters
+        size_t references = 0;
+
+        size_t maxLights = 0;
+    };
+
+    /// Bins lights into a grid of clusters over the view frustum: screen tiles in x and y, slices spaced
+    /// exponentially in view depth in z. Each cluster ends up with the list of lights whose sphere touches its view
+    /// space bounding box, and whose cone touches its bounding sphere for spot lights.
+    /// Slices are split between worker threads kept around between builds, and each light is tested against a
+    /// whole slice 8 clusters at a time with AVX2 when the CPU has it. Doesn't touch GL, so it can be run and
+    /// timed without a context
+    class ClusterBuilder {
+        glm::uvec3 m_dimensions;
+        float m_near = 0.0f;
+        float m_far = 0.0f;
+
+        /// view depth where each slice starts, and where the last one ends
+        std::vector<float> m_sliceDepths;
+
+        /// clusters per slice, rounded up to a multiple of 8
+        size_t m_sliceStride = 0;
+
+        // view space cluster bounds as a structure of arrays, slice after slice, padded with empty boxes
+        std::vector<float> m_minX;
+        std::vector<float> m_minY;
+        std::vector<float> m_minZ;
+        std::vector<float> m_maxX;
+        std::vector<float> m_maxY;
+        std::vector<float> m_maxZ;
+
+        /// center and radius around each cluster's box, for the spot light cone test
+        std::vector<glm::vec4> m_spheres;
+
+        /// the lights being binned, moved to view space
+        std::vector<ClusterLight> m_viewLights;
+
+        /// per padded cluster, kept between builds so they stop allocating once they've grown
+        std::vector<std::vector<uint16_t>> m_lists;
+
+        std::vector<uint32_t> m_ranges;
+        std::vector<uint16_t> m_indices;
+
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        uint64_t m_generation = 0;
+        size_t m_running = 0;
+        bool m_stop = false;
+
+        void Work(size_t worker);
+
+        /// Bins every worker'th slice, starting at the worker's index
+        void BinSlices(size_t worker);
+    public:
+        /// @param dimensions Tiles across, tiles down and depth slices
+        /// @param threads Workers binning slices, including the calling thread. 0 uses every hardware thread
+        explicit ClusterBuilder(glm::uvec3 dimensions, size_t threads = 0);
+
+        ~ClusterBuilder();
+
+        ClusterBuilder(const ClusterBuilder&) = delete;
+        ClusterBuilder& operator=(const ClusterBuilder&) = delete;
+
+        /// Recomputes the cluster bounds, needed before the first Build and whenever the projection changes.
+        /// Only perspective projections, the tiles' edges are taken to be rays through the camera
+        /// @param near Where the exponential slicing starts, the first slice also takes in everything closer. Can be
+        /// farther out than the projection's near plane, to keep the slices near the camera from getting too thin
+        /// @param far Where the last slice ends, lights past it aren't binned
+        void SetProjection(const glm::mat4& projection, float near, float far);
+
+        /// Bins the lights, in the order given, into the clusters of the camera at view
+        /// @throws std::runtime_error with more lights than 16-bit indices can address, or before SetProjection
+        void Build(const std::vector<ClusterLight>& lights, const glm::mat4& view);
+
+        /// An offset into GetIndices and a light count per cluster, x varying fastest, then y, then the slice
+        const std::vector<uint32_t>& GetRanges() const { return m_ranges; }
+
+        const std::vector<uint16_t>& GetIndices() const { return m_indices; }
+
+        /// The cluster a view space position is in, or -1 outside the grid
+        /// @param ndc The position's normalized device x and y
+        /// @param depth The position's view depth, positive in front of the camera
+        size_t GetCluster(const glm::vec2& ndc, float depth) const;
+
+        const glm::uvec3& GetDimensions() const { return m_dimensions; }
+
+        size_t GetClusterCount() const { return m_dimensions.x * m_dimensions.y * m_dimensions.z; }
+
+        float GetNear() const { return m_near; }
+
+        float GetFar() const { return m_far; }
+
+        size_t GetThreadCount() const { return m_threads.size() + 1; }
+
+        ClusterStats GetStats() const;
+    };
+}
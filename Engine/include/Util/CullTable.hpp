@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Util/Frustum.hpp"
+
+namespace Engine::Util {
+    /// World space bounding spheres stored as a structure of arrays, so the frustum test can run 8 at a time
+    class CullTable {
+        // each array is padded to a multiple of 8 entries, so the SIMD loop never needs a scalar tail
+        std::vector<float> m_x;
+        std::vector<float> m_y;
+        std::vector<float> m_z;
+        std::vector<float> m_radius;
+
+        /// 1 for every entry that survived the last Cull, padded like the arrays
+        std::vector<uint8_t> m_visible;
+
+        size_t m_count = 0;
+    public:
+        /// @returns The index of the new entry
+        size_t Add(const glm::vec3& center, float radius);
+
+        void Set(size_t index, const glm::vec3& center, float radius)
+        {
+            m_x[index] = center.x;
+            m_y[index] = center.y;
+            m_z[index] = center.z;
+            m_radius[index] = radius;
+        }
+
+        size_t Size() const { return m_count; }
+
+        /// Tests every entry against the frustum, with AVX2 when the CPU has it
+        /// @returns How many entries are visible
+        size_t Cull(const Frustum& frustum);
+
+        /// @returns Whether the entry survived the last Cull
+        bool IsVisible(size_t index) const { return m_visible[index] != 0; }
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+
+#include <glm/glm.hpp>
+
+namespace Engine::Util {
+    /// The six planes of a view frustum, pointing inwards
+    class Frustum {
+        std::array<glm::vec4, 6> m_planes;
+    public:
+        /// Extracts the planes from a clip matrix (Gribb and Hartmann). The planes end up in whatever
+        /// space the matrix transforms from, so passing projection * view * model gives object space planes
+        explicit Frustum(const glm::mat4& m)
+        {
+            auto row = [&m](int i) {
+                return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+            };
+
+            m_planes[0] = row(3) + row(0); // left
+            m_planes[1] = row(3) - row(0); // right
+            m_planes[2] = row(3) + row(1); // bottom
+            m_planes[3] = row(3) - row(1); // top
+            m_planes[4] = row(3) + row(2); // near
+            m_planes[5] = row(3) - row(2); // far
+
+            for (auto& plane : m_planes) {
+                plane /= glm::length(glm::vec3(plane));
+            }
+        }
+
+        const std::array<glm::vec4, 6>& GetPlanes() const { return m_planes; }
+
+        /// @returns false if the sphere is entirely outside the frustum
+        bool TestSphere(const glm::vec3& center, float radius) const
+        {
+            for (const auto& plane : m_planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    };
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Util/MeshData.hpp"
+
+namespace Engine::Util::IndexOptimizer {
+    /// Post-transform cache efficiency of an index buffer
+    struct CacheStats {
+        /// average cache miss ratio, vertex shader invocations per triangle (0.5 is the best a regular grid can do)
+        float acmr = 0.0f;
+
+        /// average transform to vertex ratio, vertex shader invocations per vertex (1.0 is optimal)
+        float atvr = 0.0f;
+    };
+
+    /// Simulates a FIFO post-transform cache over the index buffer
+    /// @param indices A triangle list
+    /// @param vertexCount How many vertices the triangle list references
+    /// @param cacheSize Entries in the simulated cache, 16 is a conservative guess for current hardware
+    CacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = 16);
+
+    /// Reorders triangles for post-transform cache locality, using Tom Forsyth's linear-speed algorithm
+    void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+    /// Reorders clusters of triangles so the ones likely to occlude the rest of the mesh come first
+    /// (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+    /// @param indices A triangle list, preferably already optimized with OptimizeVertexCache
+    /// @param positions The mesh's vertex positions
+    /// @param threshold How much worse than the input the ACMR of the result is allowed to get
+    void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold = 1.05f);
+
+    /// Reorders the vertices in the order the index buffer first references them, dropping unreferenced ones
+    void OptimizeVertexFetch(MeshData& mesh);
+
+    /// Runs the vertex cache, overdraw and vertex fetch passes on a mesh, in that order
+    /// @param before If not null, receives the cache stats of the mesh as it came in
+    /// @param after If not null, receives the cache stats of the optimized mesh
+    void Optimize(MeshData& mesh, CacheStats* before = nullptr, CacheStats* after = nullptr);
+}
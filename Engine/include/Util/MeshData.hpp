@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Engine::Util {
+    /// CPU side copy of a mesh, what the loaders build before handing it over to GL::Mesh
+    struct MeshData {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> uvs;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec3> tangents;
+
+        std::vector<uint32_t> indices;
+    };
+
+    /// Splits a mesh into chunks that reference at most maxVertices vertices each,
+    /// so every chunk can be drawn with 16-bit indices
+    /// @param mesh The mesh to split
+    /// @param maxVertices How many vertices a chunk may reference
+    /// @returns The chunks, or a single copy of the mesh if it was small enough already
+    std::vector<MeshData> SplitMesh(const MeshData& mesh, size_t maxVertices = 65536);
+
+    /// An axis aligned box as 12 triangles, only positions and indices filled in, for occluders and other
+    /// geometry only the CPU looks at
+    MeshData MakeBox(const glm::vec3& min, const glm::vec3& max);
+}
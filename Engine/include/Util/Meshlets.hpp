@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Util/MeshData.hpp"
+
+namespace Engine::Util {
+    /// A small cluster of triangles, stored as a contiguous range of the mesh's index buffer
+    struct Meshlet {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+
+        /// bounding sphere, in object space
+        glm::vec3 center;
+        float radius;
+
+        /// every triangle normal is within the cone around coneAxis. coneCutoff is the sine of the cone's
+        /// half angle, 1 when the normals are too spread out for the cone to ever cull anything
+        glm::vec3 coneAxis;
+        float coneCutoff;
+
+        /// @returns true if every triangle in the meshlet faces away from the camera
+        bool IsBackfacing(const glm::vec3& cameraPosition) const
+        {
+            auto toCenter = center - cameraPosition;
+            return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+        }
+    };
+
+    /// Groups the triangles of a mesh into meshlets, in index buffer order. Run it after IndexOptimizer so
+    /// consecutive triangles are close to each other, which keeps the bounds tight
+    /// @param mesh The mesh to cluster, left untouched
+    /// @param maxVertices How many unique vertices a meshlet may reference
+    /// @param maxTriangles How many triangles a meshlet may contain
+    std::vector<Meshlet> BuildMeshlets(const MeshData& mesh, size_t maxVertices = 64, size_t maxTriangles = 124);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Engine::Util {
+    /// A small software depth buffer to test bounds against before drawing them.
+    /// Occluders are rasterized into tiles of TILE_SIZE x TILE_SIZE pixels, then a min-max hierarchy is
+    /// built over the tiles so most tests are answered without looking at single pixels.
+    /// Depth is z / w mapped to [0, 1], like the default glDepthRange
+    class OcclusionBuffer {
+    public:
+        static constexpr size_t TILE_SIZE = 8;
+    private:
+        /// min and max depth of square blocks of tiles, level 0 has one texel per tile
+        struct Level {
+            size_t width;
+            size_t height;
+            std::vector<float> min;
+            std::vector<float> max;
+        };
+
+        size_t m_width;
+        size_t m_height;
+        size_t m_tilesX;
+
+        /// tile after tile, each one row major
+        std::vector<float> m_depth;
+
+        /// each level halves the one before it, the last one is a single texel
+        std::vector<Level> m_levels;
+
+        // reused between RasterizeOccluder calls
+        std::vector<glm::vec4> m_projected;
+
+        float* Row(size_t x, size_t y)
+        {
+            return &m_depth[((y / TILE_SIZE) * m_tilesX + x / TILE_SIZE) * TILE_SIZE * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+        }
+
+        const float* Row(size_t x, size_t y) const { return const_cast<OcclusionBuffer*>(this)->Row(x, y); }
+
+        void RasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+
+        bool TestNode(size_t level, size_t x, size_t y, const glm::ivec4& rect, float depth) const;
+    public:
+        /// @param width Rounded up to a multiple of TILE_SIZE
+        /// @param height Rounded up to a multiple of TILE_SIZE
+        explicit OcclusionBuffer(size_t width = 256, size_t height = 128);
+
+        /// Resets every pixel to the far plane
+        void Clear();
+
+        /// Rasterizes an occluder, which should be a low-poly mesh that is entirely inside what it stands in for.
+        /// Triangles crossing the near plane are skipped rather than clipped, which only ever loses occlusion
+        /// @param positions The occluder's vertices
+        /// @param indices A triangle list, either winding is fine
+        /// @param clip projection * view * model for the occluder
+        void RasterizeOccluder(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const glm::mat4& clip);
+
+        /// Builds the min-max hierarchy, call it after the last occluder and before testing
+        void BuildHierarchy();
+
+        /// Tests the screen rectangle a box covers, at the box's nearest depth
+        /// @param min The box's minimum corner
+        /// @param max The box's maximum corner
+        /// @param clip projection * view * model for the box
+        /// @returns false if the box is certainly hidden behind the occluders
+        bool TestAabb(const glm::vec3& min, const glm::vec3& max, const glm::mat4& clip) const;
+
+        /// The depth rasterized at a pixel, x and y from the bottom left corner like gl_FragCoord
+        float GetDepth(size_t x, size_t y) const { return *Row(x, y); }
+
+        size_t GetWidth() const { return m_width; }
+
+        size_t GetHeight() const { return m_height; }
+    };
+}
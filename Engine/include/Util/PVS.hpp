@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Util/MeshData.hpp"
+
+namespace Engine::Util {
+    struct PvsBakeSettings {
+        /// edge length of the cubic view cells, in world units
+        float cellSize = 2.0f;
+
+        /// viewpoints sampled inside each cell
+        size_t samplesPerCell = 16;
+
+        /// rays cast from each viewpoint to random points on each object, before giving up on it
+        size_t raysPerObject = 16;
+
+        /// 0 uses every hardware thread
+        size_t threads = 0;
+    };
+
+    /// A potentially visible set: the scene's bounds split into a grid of view cells, each with a bitset
+    /// of the objects that can be seen from somewhere inside it.
+    /// Bitsets are stored run length encoded (runs of zero bytes become a zero and a count, like Quake's vis)
+    class PVS {
+        glm::vec3 m_min;
+        float m_cellSize;
+        glm::uvec3 m_cells;
+        size_t m_objectCount;
+
+        /// where each cell's compressed bitset starts in m_data, with one extra entry for the end of the last one
+        std::vector<uint32_t> m_offsets;
+        std::vector<uint8_t> m_data;
+
+        // the last set Lookup decompressed, and the set used outside the grid, where everything counts as visible
+        std::vector<bool> m_visible;
+        size_t m_visibleCell = static_cast<size_t>(-1);
+        std::vector<bool> m_everything;
+
+        PVS() = default;
+    public:
+        /// Bakes the set by casting rays from viewpoints in each cell to points on each object. Every object
+        /// is also an occluder, and an object counts as visible as soon as one ray reaches it.
+        /// Sampling can miss an object that is only visible through a small gap, more samples make that less likely
+        /// @param objects The static scene, in world space
+        static PVS Bake(const std::vector<MeshData>& objects, const PvsBakeSettings& settings = PvsBakeSettings());
+
+        /// @throws std::runtime_error if the file can't be read or isn't a baked set
+        static PVS Load(const char* path);
+
+        /// @throws std::runtime_error if the file can't be written
+        void Save(const char* path) const;
+
+        /// @returns The index of the cell containing the position, or -1 if it's outside the grid
+        size_t GetCell(const glm::vec3& position) const;
+
+        /// Picks the cell the position is in and returns its visible set, indexed by object.
+        /// The set is only decompressed when the position moves to a different cell
+        const std::vector<bool>& Lookup(const glm::vec3& position);
+
+        size_t GetObjectCount() const { return m_objectCount; }
+
+        size_t GetCellCount() const { return m_offsets.empty() ? 0 : m_offsets.size() - 1; }
+
+        /// Size of the compressed bitsets, in bytes
+        size_t GetDataSize() const { return m_data.size(); }
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Util/MeshData.hpp"
+
+namespace Engine::Util {
+    /// One level of a LOD chain, an index buffer over the same vertices as the full detail mesh
+    struct LodLevel {
+        std::vector<uint32_t> indices;
+
+        /// how far (in object space units) the level deviates from the full detail mesh, roughly
+        float error;
+    };
+
+    /// Simplifies a triangle list by collapsing edges in quadric error order (Garland and Heckbert).
+    /// Vertices only ever collapse onto existing vertices, so the result reuses the mesh's vertex buffer.
+    /// Vertices on open borders and on attribute seams (positions shared by vertices with different
+    /// uvs or normals) are locked, and collapses across diverging normals are penalized
+    /// @param mesh The mesh the indices refer to
+    /// @param indices The triangle list to simplify, usually mesh.indices or a previous level
+    /// @param targetIndexCount The index count to stop at
+    /// @param error Receives the largest error a collapse introduced
+    /// @returns The simplified triangle list, larger than targetIndexCount if nothing else could be collapsed
+    std::vector<uint32_t> Simplify(const MeshData& mesh, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error);
+
+    /// Builds a chain of levels, each with half the triangles of the one before it
+    /// @param mesh The full detail mesh, level 0 of the chain
+    /// @param levels How many levels to build, including level 0
+    std::vector<LodLevel> BuildLodChain(const MeshData& mesh, size_t levels);
+}
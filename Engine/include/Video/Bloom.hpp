@@ -0,0 +1,47 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include "Video/Program.hpp"
+#include "Video/RenderGraph.hpp"
+
+namespace Engine::GL {
+    /// Bloom as RenderGraph passes. The finished scene gets resolved out of the backbuffer, its bright parts go to
+    /// a half resolution half float texture, which gets blurred horizontally and then vertically, and the result
+    /// is added on top of the backbuffer. The vertical blur writes a texture described like the bright pass's,
+    /// which is done with by then, so the graph has the two share
+    class Bloom {
+        Program m_brightProgram;
+        Program m_blurProgram;
+        Program m_compositeProgram;
+
+        /// the full screen passes make their triangle up in the vertex shader, but core GL still wants a vao bound
+        GLuint m_emptyVao = 0;
+
+        /// a blit resolving a multisampled framebuffer needs the target in the same format
+        GLenum m_sceneFormat = GL_RGBA8;
+
+        float m_threshold = 0.6f;
+        float m_intensity = 0.8f;
+    public:
+        /// Needs the default framebuffer bound, to find out its format
+        Bloom();
+
+        ~Bloom();
+
+        Bloom(const Bloom&) = delete;
+        Bloom& operator=(const Bloom&) = delete;
+
+        /// Declares the resolve, bright and blur passes for a backbuffer of the given size and returns the
+        /// blurred texture. They only run if something reads it, AddComposite or otherwise
+        RenderResource AddPasses(RenderGraph& graph, RenderResource backbuffer, int width, int height);
+
+        /// Declares the pass adding the blurred texture to the backbuffer
+        void AddComposite(RenderGraph& graph, RenderResource bloom, RenderResource backbuffer);
+
+        /// Brightness, the largest of the three channels, below which nothing blooms
+        void SetThreshold(float threshold) { m_threshold = threshold; }
+
+        void SetIntensity(float intensity) { m_intensity = intensity; }
+    };
+}
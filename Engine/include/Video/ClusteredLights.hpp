@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "glad/glad.h"
+
+#include "Util/ClusterBuilder.hpp"
+#include "Video/LightBuffer.hpp"
+#include "Video/Program.hpp"
+
+namespace Engine::GL {
+    /// A light with a cone, only the clustered shaders know about these
+    struct SpotLight {
+        glm::vec3 position;
+        float radius;
+        glm::vec3 color;
+
+        /// cosine of the angle between the axis and the edge of the cone
+        float cosAngle;
+
+        /// normalized, in world space
+        glm::vec3 direction;
+        float pad0;
+    };
+
+    /// Clustered forward shading: a Util::ClusterBuilder bins the frame's lights on the CPU, then the lights, each
+    /// cluster's range and the light indices go to the GPU as buffer textures, and the CLUSTERED variants of the mesh
+    /// shaders only loop over the lights of the cluster their fragment is in. Buffer textures rather than storage
+    /// buffers, those need GL 4.3. Unlike LightBuffer there's no cap on the light count short of the 16-bit indices
+    class ClusteredLights {
+        Util::ClusterBuilder m_builder;
+        std::vector<Util::ClusterLight> m_clusterLights;
+
+        /// 3 GL_RGBA32F texels a light: position and radius, color, direction and cosAngle
+        std::vector<glm::vec4> m_texels;
+
+        GLuint m_lightsBuffer = 0;
+        GLuint m_lightsTexture = 0;
+
+        /// GL_RG32UI, an offset into the indices and a count per cluster
+        GLuint m_rangesBuffer = 0;
+        GLuint m_rangesTexture = 0;
+
+        /// GL_R16UI
+        GLuint m_indicesBuffer = 0;
+        GLuint m_indicesTexture = 0;
+
+        float m_near = 0.0f;
+        float m_far = 0.0f;
+        size_t m_count = 0;
+    public:
+        /// the texture units Apply binds the three buffer textures to, past the ones the materials use
+        static constexpr unsigned FIRST_UNIT = 4;
+
+        /// @param threads See Util::ClusterBuilder
+        explicit ClusteredLights(glm::uvec3 dimensions = {16, 9, 24}, size_t threads = 0);
+
+        ~ClusteredLights();
+
+        ClusteredLights(const ClusteredLights&) = delete;
+        ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+        /// Has to be called before the first Update and whenever the projection changes
+        void SetProjection(const glm::mat4& projection, float near, float far);
+
+        /// Bins point and spot lights for the camera at view and uploads the result
+        void Update(const std::vector<PointLight>& points, const std::vector<SpotLight>& spots, const glm::mat4& view);
+
+        /// Binds the buffer textures and sets the cluster uniforms of a program with the CLUSTERED define.
+        /// Leaves the program in use
+        void Apply(Program& program) const;
+
+        /// Lights binned by the last Update
+        size_t GetCount() const { return m_count; }
+
+        const Util::ClusterBuilder& GetBuilder() const { return m_builder; }
+    };
+}
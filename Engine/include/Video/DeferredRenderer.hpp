@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "glad/glad.h"
+
+#include "Video/LightBuffer.hpp"
+#include "Video/Program.hpp"
+
+namespace Engine::GL {
+    /// Shades the scene once per light that touches a pixel instead of once per light per draw. The geometry pass
+    /// writes a G-buffer with the DEFERRED variants of the mesh shaders, then the frame's light and ambient are added
+    /// in a full screen pass and every point light in a box around its sphere, without a depth test, each fragment
+    /// rebuilding its position from the G-buffer depth. Lighting goes to a half float target of its own, since the
+    /// G-buffer is single sampled and the window may not be
+    class DeferredRenderer {
+        Program m_ambientProgram;
+        Program m_lightProgram;
+        Program m_compositeProgram;
+
+        /// GL_RGBA8 albedo and specular intensity, GL_RG16F octahedral world space normal and depth
+        GLuint m_gbuffer = 0;
+        GLuint m_albedoSpec = 0;
+        GLuint m_octNormal = 0;
+        GLuint m_depth = 0;
+
+        /// GL_RGBA16F, in a framebuffer of its own so the lighting passes can sample the G-buffer depth
+        GLuint m_lightFramebuffer = 0;
+        GLuint m_light = 0;
+
+        /// the full screen passes make their triangle up in the vertex shader, but core GL still wants a vao bound
+        GLuint m_emptyVao = 0;
+
+        /// a [-1, 1] box instanced once per light, the instance attributes read straight from a LightBuffer
+        GLuint m_volumeVao = 0;
+        GLuint m_volumeVbo = 0;
+        GLuint m_volumeEbo = 0;
+
+        /// the buffer the instance attributes point at
+        GLuint m_volumeLights = 0;
+
+        int m_width = 0;
+        int m_height = 0;
+
+        void Resize(int width, int height);
+    public:
+        DeferredRenderer();
+
+        ~DeferredRenderer();
+
+        DeferredRenderer(const DeferredRenderer&) = delete;
+        DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+        /// Binds and clears the G-buffer, sized to the viewport. Everything drawn until Resolve has to use
+        /// DEFERRED shader variants, and can't blend
+        void BeginGeometry();
+
+        /// Lights the G-buffer with the frame uniforms' light and every light in lights, then writes the result to
+        /// the default framebuffer along with the G-buffer depth, so forward drawn objects can go on top. Leaves the
+        /// default framebuffer bound and the depth test on
+        /// @param invProjectionView inverse(projection * view), to rebuild positions from depth
+        void Resolve(const LightBuffer& lights, const glm::mat4& invProjectionView);
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include "Video/Program.hpp"
+
+namespace Engine::GL {
+    /// A copy of the window's depth buffer with a mip chain where each texel holds the farthest depth of the
+    /// texels under it, for testing bounds against a whole screen rectangle with a handful of fetches.
+    /// Built on the GPU with a compute shader (GL 4.3), nothing is read back
+    class DepthPyramid {
+        Program m_program;
+
+        /// single sampled copy of the depth buffer, the window's may be multisampled
+        GLuint m_depthTexture = 0;
+        GLuint m_framebuffer = 0;
+
+        /// GL_R32F, level 0 is the size of the viewport and each level below halves it, rounding down
+        GLuint m_pyramid = 0;
+
+        int m_width = 0;
+        int m_height = 0;
+        int m_levels = 0;
+
+        void Resize(int width, int height);
+    public:
+        DepthPyramid();
+
+        ~DepthPyramid();
+
+        DepthPyramid(const DepthPyramid&) = delete;
+        DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+        /// Copies the default framebuffer's depth over the current viewport and reduces it. Call once
+        /// everything is drawn, whatever gets culled against it next frame also needs this frame's matrices
+        void Build();
+
+        GLuint GetTexture() const { return m_pyramid; }
+
+        int GetWidth() const { return m_width; }
+
+        int GetHeight() const { return m_height; }
+
+        int GetLevelCount() const { return m_levels; }
+    };
+}
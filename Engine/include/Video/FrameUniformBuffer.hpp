@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "glad/glad.h"
+
+namespace Engine::GL {
+    /// The FrameData uniform block every shader declares, in std140 layout
+    struct FrameData {
+        glm::mat4 projection;
+        glm::mat4 view;
+
+        // std140 puts each vec3 at the start of its own 16 bytes
+        glm::vec3 viewPos;
+        float pad0;
+        glm::vec3 lightPos;
+        float pad1;
+        glm::vec3 lightColor;
+        float pad2;
+    };
+
+    /// Holds the FrameData block for every program at once. Program::Link points each program's block at
+    /// BINDING, so updating this buffer once a frame replaces setting the same uniforms on every program
+    class FrameUniformBuffer {
+        GLuint m_buffer = 0;
+    public:
+        static constexpr GLuint BINDING = 0;
+
+        FrameUniformBuffer();
+
+        ~FrameUniformBuffer();
+
+        FrameUniformBuffer(const FrameUniformBuffer&) = delete;
+        FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+
+        /// Uploads the frame's data and binds the buffer to BINDING
+        void Update(const FrameData& data);
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+
+#include "glad/glad.h"
+
+// glad is generated for 3.3 core, anything newer gets loaded by hand here and only used
+// after checking GetVersion or HasExtension
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+
+// the KHR and ARB parallel_shader_compile extensions share these
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+
+namespace Engine::GL::Ext {
+    /// What glDrawElementsIndirect and glMultiDrawElementsIndirect read from GL_DRAW_INDIRECT_BUFFER
+    struct DrawElementsIndirectCommand {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t baseInstance;
+    };
+
+    typedef void (APIENTRYP PFNMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+    typedef void (APIENTRYP PFNDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect);
+    typedef void (APIENTRYP PFNDISPATCHCOMPUTEPROC)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+    typedef void (APIENTRYP PFNMEMORYBARRIERPROC)(GLbitfield barriers);
+    typedef void (APIENTRYP PFNBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+    typedef void (APIENTRYP PFNGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP PFNPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP PFNPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+    typedef void (APIENTRYP PFNMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+    // all of these are null when the context doesn't have them
+
+    /// GL 4.3 / ARB_multi_draw_indirect
+    extern PFNMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+
+    /// GL 4.0 / ARB_draw_indirect
+    extern PFNDRAWELEMENTSINDIRECTPROC DrawElementsIndirect;
+
+    /// GL 4.3 / ARB_compute_shader
+    extern PFNDISPATCHCOMPUTEPROC DispatchCompute;
+
+    /// GL 4.2 / ARB_shader_image_load_store
+    extern PFNMEMORYBARRIERPROC MemoryBarrier;
+
+    /// GL 4.2 / ARB_shader_image_load_store
+    extern PFNBINDIMAGETEXTUREPROC BindImageTexture;
+
+    /// GL 4.1 / ARB_get_program_binary
+    extern PFNGETPROGRAMBINARYPROC GetProgramBinary;
+
+    /// GL 4.1 / ARB_get_program_binary
+    extern PFNPROGRAMBINARYPROC ProgramBinary;
+
+    /// GL 4.1 / ARB_get_program_binary
+    extern PFNPROGRAMPARAMETERIPROC ProgramParameteri;
+
+    /// KHR_parallel_shader_compile or ARB_parallel_shader_compile. When it's there, GL_COMPLETION_STATUS_KHR
+    /// can be queried on shaders and programs without waiting for them
+    extern PFNMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads;
+
+    /// Loads the entry points glad doesn't, has to run after gladLoadGLLoader with the context current
+    void Load(void* (*getProcAddress)(const char*));
+
+    /// The context version as major * 10 + minor, 43 for 4.3
+    int GetVersion();
+
+    bool HasExtension(const char* name);
+}
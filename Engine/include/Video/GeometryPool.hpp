@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "glad/glad.h"
+
+#include "Video/Mesh.hpp"
+#include "Video/StateCache.hpp"
+
+namespace Engine::GL {
+    /// Where a mesh ended up in a GeometryPool
+    struct PoolAllocation {
+        uint32_t bucket;
+
+        /// added to every index the mesh's draws fetch
+        int32_t baseVertex;
+
+        /// in indices, where the mesh's index buffer (all its LOD levels) starts in the bucket's
+        uint32_t firstIndex;
+    };
+
+    /// Copies meshes into a few shared vertex and index buffers, one pair per vertex layout and index type, so
+    /// any number of meshes can be drawn with a single vao bind. Meshes keep their indices relative to their
+    /// own vertices and get drawn with a base vertex, which is what lets 16-bit indexed meshes share a buffer
+    /// that holds far more than 65536 vertices.
+    /// Every bucket's vao also gets a per instance uint at DRAW_ID_LOCATION counting up from 0, for shaders
+    /// that can't read gl_DrawID and take the draw index from the base instance instead
+    class GeometryPool {
+        struct Bucket {
+            VertexLayout layout;
+            GLenum indexType;
+            size_t indexSize;
+
+            GLuint vao = 0;
+            GLuint vbo = 0;
+            GLuint ebo = 0;
+
+            size_t vertexCount = 0;
+            size_t vertexCapacity = 0;
+            size_t indexCount = 0;
+            size_t indexCapacity = 0;
+        };
+
+        std::vector<Bucket> m_buckets;
+        std::map<const Mesh*, PoolAllocation> m_allocations;
+
+        GLuint m_drawIdVbo = 0;
+
+        uint32_t FindBucket(const VertexLayout& layout, GLenum indexType);
+
+        /// Grows a buffer, keeping what's in it. Leaves the new buffer bound to target
+        static void Grow(GLuint& buffer, GLenum target, size_t oldSize, size_t newSize);
+    public:
+        static constexpr GLuint DRAW_ID_LOCATION = 10;
+
+        /// The draw ids only go this high, so a frame can't have more draws than this in the pool
+        static constexpr size_t MAX_DRAWS = 1 << 16;
+
+        GeometryPool();
+
+        ~GeometryPool();
+
+        GeometryPool(const GeometryPool&) = delete;
+        GeometryPool& operator=(const GeometryPool&) = delete;
+
+        /// Copies a mesh's buffers into the pool, GPU side. Meshes that are already in it are left alone
+        const PoolAllocation& Add(const Mesh& mesh);
+
+        /// @returns The mesh's allocation, null if it was never added
+        const PoolAllocation* Find(const Mesh& mesh) const;
+
+        void Bind(uint32_t bucket) const { StateCache::BindVertexArray(m_buckets[bucket].vao); }
+
+        GLenum GetIndexType(uint32_t bucket) const { return m_buckets[bucket].indexType; }
+
+        const VertexLayout& GetLayout(uint32_t bucket) const { return m_buckets[bucket].layout; }
+
+        /// The bucket's buffers, for shaders that fetch vertices themselves. Both are sized to whole 32-bit words
+        GLuint GetVertexBuffer(uint32_t bucket) const { return m_buckets[bucket].vbo; }
+
+        GLuint GetIndexBuffer(uint32_t bucket) const { return m_buckets[bucket].ebo; }
+
+        size_t GetBucketCount() const { return m_buckets.size(); }
+
+        /// Bytes of vertex and index data in use
+        size_t GetSize() const;
+    };
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "glad/glad.h"
+
+#include "Video/DepthPyramid.hpp"
+#include "Video/GLExt.hpp"
+#include "Video/Model.hpp"
+#include "Video/Program.hpp"
+
+namespace Engine::GL {
+    /// Culls the instances of a model with a compute shader. The instances' bounding spheres and transforms
+    /// live in shader storage buffers, each one is tested against the frustum and, optionally, last frame's
+    /// depth pyramid, and the survivors' transforms get appended to an instance buffer with an atomic counter.
+    /// The counter is the instance count of the indirect command for the model's first mesh, and gets copied
+    /// to the others on the GPU, so the draw count never comes back to the CPU
+    class GpuCuller {
+        Program m_program;
+
+        GLuint m_boundsBuffer = 0;
+        GLuint m_transformBuffer = 0;
+        GLuint m_instanceBuffer = 0;
+        GLuint m_commandBuffer = 0;
+
+        size_t m_count = 0;
+
+        std::vector<Ext::DrawElementsIndirectCommand> m_commands;
+    public:
+        GpuCuller();
+
+        ~GpuCuller();
+
+        GpuCuller(const GpuCuller&) = delete;
+        GpuCuller& operator=(const GpuCuller&) = delete;
+
+        /// Whether the context has compute shaders and indirect draws (GL 4.3)
+        static bool IsSupported();
+
+        /// Uploads the instances, they stay on the GPU until the next call
+        /// @param transforms The model matrix of each instance
+        /// @param center The model's bounding sphere, in object space
+        /// @param radius The model's bounding sphere, in object space
+        void SetInstances(const std::vector<glm::mat4>& transforms, const glm::vec3& center, float radius);
+
+        /// Fills the instance and command buffers with the instances that pass
+        /// @param model The model that is going to be drawn, one command is written per mesh at its current LOD
+        /// @param projectionView projection * view, for the frustum test
+        /// @param pyramid Last frame's depth, null to skip the occlusion test
+        /// @param previousProjectionView projection * view of the frame the pyramid was built from
+        void Cull(const Model& model, const glm::mat4& projectionView, const DepthPyramid* pyramid, const glm::mat4& previousProjectionView);
+
+        /// Per instance model matrices of the instances that passed, for attributes 6 to 9
+        GLuint GetInstanceBuffer() const { return m_instanceBuffer; }
+
+        /// One Ext::DrawElementsIndirectCommand per mesh
+        GLuint GetCommandBuffer() const { return m_commandBuffer; }
+
+        size_t GetInstanceCount() const { return m_count; }
+    };
+}
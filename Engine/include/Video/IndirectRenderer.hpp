@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Video/GeometryPool.hpp"
+#include "Video/GLExt.hpp"
+#include "Video/Mesh.hpp"
+#include "Video/Program.hpp"
+
+namespace Engine::GL {
+    /// What a frame's worth of IndirectRenderer::Execute calls cost
+    struct IndirectStats {
+        size_t draws = 0;
+
+        /// glMultiDrawElementsIndirect calls, one per program, material and pool bucket
+        size_t multiDraws = 0;
+    };
+
+    /// Draws through glMultiDrawElementsIndirect (GL 4.3). Meshes get copied into a GeometryPool, each Submit
+    /// becomes a DrawElementsIndirectCommand plus a DrawData entry in a shader storage buffer, and Execute
+    /// issues one multi draw per program, texture set and pool bucket instead of one draw per mesh.
+    /// The vertex shader finds its DrawData with drawBase + gl_DrawIDARB (ARB_shader_draw_parameters), or with
+    /// the pool's draw id attribute where that's missing, since every command's base instance is its DrawData
+    /// index. See GLSL/simple_mesh_mdi.vert
+    class IndirectRenderer {
+        /// std430 layout, matches the DrawData block in the shaders
+        struct DrawData {
+            glm::mat4 model;
+            glm::mat4 invModel;
+            glm::vec4 posBias;
+            glm::vec4 posScale;
+        };
+
+        struct Item {
+            Mesh* mesh;
+            Program* program;
+            uint32_t bucket;
+            glm::mat4 model;
+        };
+
+        GeometryPool m_pool;
+
+        std::vector<Item> m_items;
+        std::vector<uint32_t> m_order;
+
+        std::vector<DrawData> m_drawData;
+        std::vector<Ext::DrawElementsIndirectCommand> m_commands;
+
+        GLuint m_drawDataBuffer = 0;
+        GLuint m_commandBuffer = 0;
+    public:
+        static constexpr GLuint DRAW_DATA_BINDING = 0;
+
+        IndirectRenderer();
+
+        ~IndirectRenderer();
+
+        IndirectRenderer(const IndirectRenderer&) = delete;
+        IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+        /// Whether the context can run this path: 4.3 for the multi draw and vertex shader storage blocks
+        static bool IsSupported();
+
+        /// Drops the previous frame's draws
+        void Begin();
+
+        /// Queues the mesh at its current LOD level, copying it into the pool the first time it shows up
+        void Submit(Mesh& mesh, Program& program, const glm::mat4& model);
+
+        /// Uploads the frame's draws and issues them. Uniforms that are the same for a whole frame should be
+        /// set on each program before this, the renderer only sets "drawBase"
+        void Execute(IndirectStats& stats, DrawStats& drawStats);
+
+        const GeometryPool& GetPool() const { return m_pool; }
+    };
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "glad/glad.h"
+
+namespace Engine::GL {
+    /// One element of the PointLights block's array, in std140 layout
+    struct PointLight {
+        glm::vec3 position;
+
+        /// the light falls off to nothing here, so it doesn't touch anything farther away
+        float radius;
+
+        glm::vec3 color;
+        float pad0;
+    };
+
+    /// Holds the PointLights uniform block: the light count, then the lights. Program::Link points each program's
+    /// block at BINDING. The deferred renderer reads the same buffer as per instance attributes of its light volumes
+    class LightBuffer {
+        GLuint m_buffer = 0;
+        size_t m_count = 0;
+    public:
+        static constexpr GLuint BINDING = 1;
+
+        /// has to match MAX_POINT_LIGHTS in the shaders. The block stays under the 16 KiB every GL guarantees
+        static constexpr size_t MAX_LIGHTS = 256;
+
+        /// where the array starts, the count takes up the first 16 bytes
+        static constexpr size_t LIGHTS_OFFSET = 16;
+
+        LightBuffer();
+
+        ~LightBuffer();
+
+        LightBuffer(const LightBuffer&) = delete;
+        LightBuffer& operator=(const LightBuffer&) = delete;
+
+        /// Uploads up to MAX_LIGHTS lights and binds the buffer to BINDING
+        void Update(const std::vector<PointLight>& lights);
+
+        GLuint GetBuffer() const { return m_buffer; }
+
+        /// Lights uploaded by the last Update
+        size_t GetCount() const { return m_count; }
+    };
+}
@@ -1,24 +1,124 @@
 #pragma once
 
 #include "Video/Texture.hpp"
+#include "Util/Frustum.hpp"
+#include "Util/Meshlets.hpp"
+#include "Util/Simplifier.hpp"
 
+#include <algorithm>
+#include <array>
+#include <tuple>
 #include <vector>
 
 #include <glm/glm.hpp>
 #include "glad/glad.h"
 
 namespace Engine::GL {
+    /// How vertex attributes are stored in the vertex buffer
+    enum class VertexFormat {
+        /// 32-bit floats for everything, 56 bytes per vertex with all attributes present
+        Full,
+        /// 16-bit positions quantized to the mesh AABB, half float uvs and
+        /// octahedral normals/tangents in GL_INT_2_10_10_10_REV, 20 bytes per vertex
+        Compact
+    };
+
+    /// Which attributes a vertex buffer holds and how they're encoded
+    struct VertexLayout {
+        VertexFormat format;
+        bool hasUV;
+        bool hasNormal;
+        bool hasTangents;
+
+        /// Bytes per vertex
+        size_t GetStride() const;
+
+        /// Points attributes 0 to 3 of the bound vao at the bound array buffer
+        void Apply() const;
+
+        bool operator <(const VertexLayout& rhs) const
+        {
+            return std::tie(format, hasUV, hasNormal, hasTangents) < std::tie(rhs.format, rhs.hasUV, rhs.hasNormal, rhs.hasTangents);
+        }
+    };
+
+    /// Size and worst case encoding error of a mesh's vertex buffer
+    struct VertexStats {
+        size_t vertexCount = 0;
+
+        size_t stride = 0;
+
+        /// the stride VertexFormat::Full would have used for the same attributes
+        size_t fullStride = 0;
+
+        /// in object space units
+        float maxPositionError = 0.0f;
+
+        /// in degrees
+        float maxNormalError = 0.0f;
+
+        /// in degrees
+        float maxTangentError = 0.0f;
+
+        float maxUvError = 0.0f;
+    };
+
+    /// Triangles considered and actually submitted by culled draws
+    struct DrawStats {
+        size_t trianglesTotal = 0;
+        size_t trianglesDrawn = 0;
+    };
+
+    /// A detail level, as a range of the mesh's index buffer
+    struct LodRange {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+
+        /// in object space units
+        float error;
+    };
+
     class Mesh {
         GLuint m_vao;
         GLuint m_vbo;
         GLuint m_ebo;
 
+        /// positions alone, tightly packed in the same encoding as m_vbo, and a vao reading them with m_ebo
+        /// for the depth pre-pass
+        GLuint m_depthVao;
+        GLuint m_positionVbo;
+
         Texture* m_diffuse;
         Texture* m_specular;
         Texture* m_bumpmap;
         Texture* m_displacementMap;
 
         size_t m_drawCount;
+
+        /// GL_UNSIGNED_SHORT when every vertex is 16-bit addressable, GL_UNSIGNED_INT otherwise
+        GLenum m_indexType;
+        size_t m_indexSize;
+
+        VertexLayout m_layout;
+
+        glm::vec3 m_aabbMin;
+        glm::vec3 m_aabbMax;
+
+        /// centered on the AABB, but sized to the vertices so it's tighter than the box's corners
+        glm::vec3 m_sphereCenter;
+        float m_sphereRadius;
+
+        VertexStats m_vertexStats;
+
+        std::vector<Util::Meshlet> m_meshlets;
+
+        /// level 0 is the full detail mesh, the rest follow it in the index buffer
+        std::vector<LodRange> m_lods;
+        size_t m_lod = 0;
+
+        // reused between DrawCulled calls so culling doesn't allocate every frame
+        std::vector<GLsizei> m_culledCounts;
+        std::vector<const GLvoid*> m_culledOffsets;
     public:
         Mesh(
                   const std::vector<glm::vec3>& pos
@@ -30,6 +130,7 @@ namespace Engine::GL {
                 , Texture* specular
                 , Texture* bumpmap
                 , Texture* displacementMap
+                , VertexFormat format = VertexFormat::Full
         );
 
         Mesh(const Mesh&) = delete;
@@ -39,5 +140,93 @@ namespace Engine::GL {
 
         // This is a bad abstraction but I cba to build a better one
         void Draw();
+
+        /// Draws only the meshlets that are inside the frustum and not facing away from the camera.
+        /// Meshes without meshlets are drawn whole
+        /// @param frustum The view frustum, in object space
+        /// @param cameraPosition The camera position, in object space
+        /// @param stats Gets the triangle counts added to it
+        void DrawCulled(const Util::Frustum& frustum, const glm::vec3& cameraPosition, DrawStats& stats);
+
+        /// Binds the textures to units 0 to 3, null for the ones the mesh doesn't have
+        void BindMaterial();
+
+        /// Binds the vao and sets the attribute constants the vertex format needs
+        void BindGeometry();
+
+        /// BindGeometry, but with the position only vao. DrawBound and DrawCulledBound work with either,
+        /// they share the index buffer
+        void BindDepthGeometry();
+
+        /// Draw, with whatever BindMaterial and BindGeometry left bound. Leaves the vao bound
+        void DrawBound();
+
+        /// DrawCulled, with whatever BindMaterial and BindGeometry left bound. Leaves the vao bound
+        void DrawCulledBound(const Util::Frustum& frustum, const glm::vec3& cameraPosition, DrawStats& stats);
+
+        /// Points attributes 6 to 9 of the vao at a buffer of per instance model matrices
+        void SetInstanceBuffer(GLuint buffer);
+
+        /// DrawBound, for count instances. Needs SetInstanceBuffer to have been called
+        void DrawInstancedBound(GLsizei count);
+
+        /// DrawInstancedBound, with the index count and instance count read from the bound GL_DRAW_INDIRECT_BUFFER
+        /// @param commandOffset In bytes, where the mesh's Ext::DrawElementsIndirectCommand is
+        void DrawIndirectBound(size_t commandOffset);
+
+        /// The textures BindMaterial binds, meshes with the same ones can share a bind
+        std::array<const Texture*, 4> GetTextures() const { return {m_diffuse, m_specular, m_bumpmap, m_displacementMap}; }
+
+        void SetMeshlets(std::vector<Util::Meshlet> meshlets) { m_meshlets = std::move(meshlets); }
+
+        /// Replaces the index buffer with a LOD chain, level 0 has to be the indices the mesh was built with
+        void SetLods(const std::vector<Util::LodLevel>& levels);
+
+        /// Picks the level Draw and DrawCulled use, clamped to the levels the mesh has
+        void SetLod(size_t level) { m_lod = std::min(level, m_lods.size() - 1); }
+
+        size_t GetLodCount() const { return m_lods.size(); }
+
+        float GetLodError(size_t level) const { return m_lods[std::min(level, m_lods.size() - 1)].error; }
+
+        /// Triangles drawn at the current level
+        size_t GetTriangleCount() const { return m_lods[m_lod].indexCount / 3; }
+
+        const glm::vec3& GetAabbMin() const { return m_aabbMin; }
+
+        const glm::vec3& GetAabbMax() const { return m_aabbMax; }
+
+        const glm::vec3& GetSphereCenter() const { return m_sphereCenter; }
+
+        float GetSphereRadius() const { return m_sphereRadius; }
+
+        const VertexStats& GetVertexStats() const { return m_vertexStats; }
+
+        size_t GetIndexCount() const { return m_drawCount; }
+
+        size_t GetIndexSize() const { return m_indexSize; }
+
+        const VertexLayout& GetLayout() const { return m_layout; }
+
+        GLenum GetIndexType() const { return m_indexType; }
+
+        GLuint GetVertexBuffer() const { return m_vbo; }
+
+        /// Holds every LOD level back to back
+        GLuint GetIndexBuffer() const { return m_ebo; }
+
+        size_t GetVertexCount() const { return m_vertexStats.vertexCount; }
+
+        /// Indices in the index buffer, all levels included
+        size_t GetIndexBufferCount() const { return m_lods.back().firstIndex + m_lods.back().indexCount; }
+
+        /// The range Draw uses at the current level
+        const LodRange& GetCurrentLod() const { return m_lods[m_lod]; }
+
+        /// The constants BindGeometry puts in the position bias attribute
+        glm::vec4 GetPositionBias() const;
+
+        /// The constants BindGeometry puts in the position scale attribute
+        glm::vec4 GetPositionScale() const;
     };
-}
\ No newline at end of file
+}
@@ -1,14 +1,123 @@
 #pragma once
 
+#include "Video/IndirectRenderer.hpp"
 #include "Video/Mesh.hpp"
+#include "Video/RenderQueue.hpp"
+#include "Video/VisibilityRenderer.hpp"
+#include "Util/CullTable.hpp"
+#include "Util/OcclusionBuffer.hpp"
 #include <vector>
 
 namespace Engine::GL {
     class Model {
         std::vector<Mesh> m_meshes;
+
+        /// bounding box and sphere of every mesh, in object space
+        glm::vec3 m_aabbMin;
+        glm::vec3 m_aabbMax;
+        glm::vec3 m_center;
+        float m_radius;
+
+        /// the largest error any mesh has at each detail level
+        std::vector<float> m_lodErrors;
+        size_t m_lod = 0;
+
+        /// where the meshes' spheres start in the cull table the model was added to
+        size_t m_cullIndex = 0;
+
+        /// 0 for meshes the cull table culled, Draw and DrawCulled skip them
+        std::vector<uint8_t> m_meshVisible;
+
+        /// per instance model matrices for DrawInstanced, created on first use
+        GLuint m_instanceVbo = 0;
+
+        /// the buffer the meshes' instance attributes point at right now
+        GLuint m_meshInstanceBuffer = 0;
+
+        void SetInstanceBuffer(GLuint buffer);
     public:
         explicit Model(std::vector<Mesh> meshes);
 
         void Draw();
+
+        /// Draw, but adding the triangles drawn at the current detail level to stats
+        void Draw(DrawStats& stats);
+
+        /// Draws every mesh once per transform, one draw call per mesh. Needs a program with
+        /// an instanced vertex shader, which reads the model matrix from attributes 6 to 9
+        /// @param transforms The model matrix of each instance
+        /// @param count How many instances to draw
+        void DrawInstanced(const glm::mat4* transforms, size_t count);
+
+        /// Draws every mesh instanced, with the instances and the draw arguments already on the GPU
+        /// @param instanceBuffer Per instance model matrices, for attributes 6 to 9
+        /// @param commandBuffer One Ext::DrawElementsIndirectCommand per mesh, in order
+        void DrawInstancedIndirect(GLuint instanceBuffer, GLuint commandBuffer);
+
+        /// Like Draw, but culls each mesh's meshlets against the view first
+        /// @param projectionView projection * view
+        /// @param model The model matrix the model is going to be drawn with
+        /// @param cameraPosition The camera position, in world space
+        /// @param stats Gets the triangle counts added to it
+        void DrawCulled(const glm::mat4& projectionView, const glm::mat4& model, const glm::vec3& cameraPosition, DrawStats& stats);
+
+        /// Submits every mesh that isn't hidden to a render queue
+        /// @param model The model matrix the model is going to be drawn with
+        /// @param cullMeshlets Have the queue cull each mesh's meshlets, like DrawCulled
+        void Submit(RenderQueue& queue, Program& program, const glm::mat4& model, RenderPass pass = RenderPass::Opaque, bool cullMeshlets = false);
+
+        /// Submits every mesh that isn't hidden to an indirect renderer, the program needs a multi draw vertex shader
+        /// @param model The model matrix the model is going to be drawn with
+        void SubmitIndirect(IndirectRenderer& renderer, Program& program, const glm::mat4& model);
+
+        /// Submits every mesh that isn't hidden to a visibility buffer renderer
+        /// @param model The model matrix the model is going to be drawn with
+        void SubmitVisibility(VisibilityRenderer& renderer, const glm::mat4& model);
+
+        /// Picks the coarsest detail level whose error, projected on screen, stays under a threshold.
+        /// Switching to a coarser level needs the error to be a good bit under the threshold, so the
+        /// model doesn't pop back and forth when the camera hovers around a switching distance
+        /// @param projection The projection matrix
+        /// @param model The model matrix the model is going to be drawn with
+        /// @param cameraPosition The camera position, in world space
+        /// @param viewportHeight In pixels
+        /// @param pixelThreshold How many pixels of error are acceptable
+        void SelectLod(const glm::mat4& projection, const glm::mat4& model, const glm::vec3& cameraPosition, float viewportHeight, float pixelThreshold = 1.0f);
+
+        size_t GetLod() const { return m_lod; }
+
+        const std::vector<Mesh>& GetMeshes() const { return m_meshes; }
+
+        const glm::vec3& GetAabbMin() const { return m_aabbMin; }
+
+        const glm::vec3& GetAabbMax() const { return m_aabbMax; }
+
+        const glm::vec3& GetCenter() const { return m_center; }
+
+        float GetRadius() const { return m_radius; }
+
+        /// Adds a bounding sphere for each mesh to a cull table. Call UpdateCullTable whenever
+        /// the model matrix changes, and UpdateVisibility after every Cull
+        void AddToCullTable(Util::CullTable& table);
+
+        /// Moves the meshes' spheres in the table to world space
+        /// @param model The model matrix the model is going to be drawn with
+        void UpdateCullTable(Util::CullTable& table, const glm::mat4& model) const;
+
+        /// Picks up which meshes survived the table's last Cull
+        void UpdateVisibility(const Util::CullTable& table);
+
+        /// Hides the meshes whose bounds are behind the buffer's occluders, on top of what the cull table hid
+        /// @param clip projection * view * model for the model
+        /// @returns How many meshes got hidden
+        size_t ApplyOcclusion(const Util::OcclusionBuffer& buffer, const glm::mat4& clip);
+
+        /// Hides every mesh, until the next UpdateVisibility
+        void Hide() { std::fill(m_meshVisible.begin(), m_meshVisible.end(), 0); }
+
+        size_t GetTriangleCount() const;
+
+        /// Prints the vertex memory used by the model and the worst error the vertex encoding introduced
+        void PrintStats(const char* name) const;
     };
-}
\ No newline at end of file
+}
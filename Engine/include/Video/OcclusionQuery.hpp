@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+
+#include "glad/glad.h"
+
+namespace Engine::GL {
+    /// A double buffered GL_ANY_SAMPLES_PASSED query on a bounding box. Each frame one query gets issued
+    /// while the other one, issued the frame before, decides whether the object is drawn. The older
+    /// result is done (or close to it) by the time it's used, so neither the CPU nor the GPU waits on it,
+    /// at the cost of an object that comes into view showing up one frame late
+    class OcclusionQuery {
+        std::array<GLuint, 2> m_queries;
+
+        /// the query issued this frame, the other one is last frame's
+        size_t m_current = 0;
+
+        std::array<bool, 2> m_issued{};
+
+        /// last result that came back without waiting
+        bool m_visible = true;
+    public:
+        OcclusionQuery();
+
+        ~OcclusionQuery();
+
+        OcclusionQuery(const OcclusionQuery&) = delete;
+        OcclusionQuery& operator=(const OcclusionQuery&) = delete;
+
+        /// Draws a cube from (0, 0, 0) to (1, 1, 1) at attribute 0 inside this frame's query. The program in use
+        /// should stretch it over the bounds being tested, and color and depth writes should be off
+        void Issue();
+
+        /// Starts conditional rendering on last frame's query, the GPU skips the draws up to EndConditional
+        /// if the box was hidden. Draws go through unconditionally until there is a query from the last frame
+        void BeginConditional();
+
+        void EndConditional();
+
+        /// Swaps the two queries, call once per frame after the draws
+        void NextFrame();
+
+        /// Forgets the queries issued so far, for when the object was drawn without them for a while
+        /// and their results would be stale
+        void Reset()
+        {
+            m_issued = {};
+            m_visible = true;
+        }
+
+        /// @returns Whether the box was visible, as of the newest result that was ready
+        bool WasVisible() const { return m_visible; }
+    };
+}
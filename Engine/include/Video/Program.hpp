@@ -1,7 +1,10 @@
 #pragma once
 
-#include <string>
+#include <cstdint>
+#include <initializer_list>
 #include <map>
+#include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 
@@ -11,16 +14,173 @@ namespace Engine::GL {
     // this is non exhaustive, notably absent are geometry and tesselation shaders
     enum class ShaderType {
         Vertex,
-        Fragment
+        Fragment,
+        /// GL 4.3, a program with a compute shader can't have any other stage
+        Compute
+    };
+
+    /// #defines to compile a shader with, name to value. Ordered, so equal sets compare equal and can key a map
+    using ShaderDefines = std::map<std::string, std::string>;
+
+    /// A uniform name, hashed (32-bit FNV-1a) so looking it up in a program doesn't touch the string again.
+    /// Converting from a literal is constexpr, a handle declared constexpr or made with "name"_u in a constant
+    /// expression costs nothing at runtime.
+    /// The name's length and a second, unrelated hash (djb2) go along to tell apart names that share the first
+    struct UniformHandle {
+        uint32_t hash;
+        uint32_t check;
+        uint32_t length;
+
+        /// No name, what an empty slot in a program's table holds
+        constexpr UniformHandle() : hash(0), check(0), length(0)
+        {
+        }
+
+        constexpr UniformHandle(const char* name) : UniformHandle(name, Length(name))
+        {
+        }
+
+        constexpr UniformHandle(const char* name, size_t length)
+                : hash(Hash(name, length)), check(Check(name, length)), length(static_cast<uint32_t>(length))
+        {
+        }
+
+        UniformHandle(const std::string& name) : UniformHandle(name.data(), name.size())
+        {
+        }
+
+        constexpr bool operator==(const UniformHandle& other) const
+        {
+            return hash == other.hash && check == other.check && length == other.length;
+        }
+
+        static constexpr size_t Length(const char* name)
+        {
+            size_t length = 0;
+
+            while (name[length] != '\0') {
+                length++;
+            }
+
+            return length;
+        }
+
+        static constexpr uint32_t Hash(const char* name, size_t length)
+        {
+            uint32_t hash = 2166136261u;
+
+            for (size_t i = 0; i < length; ++i) {
+                hash = (hash ^ static_cast<uint8_t>(name[i])) * 16777619u;
+            }
+
+            // 0 marks an empty slot in the program's table
+            return hash != 0 ? hash : 1;
+        }
+
+        static constexpr uint32_t Check(const char* name, size_t length)
+        {
+            uint32_t hash = 5381;
+
+            for (size_t i = 0; i < length; ++i) {
+                hash = hash * 33 ^ static_cast<uint8_t>(name[i]);
+            }
+
+            return hash;
+        }
+    };
+
+    inline namespace Literals {
+        constexpr UniformHandle operator ""_u(const char* name, size_t length)
+        {
+            return UniformHandle(name, length);
+        }
+    }
+
+    /// glUniform* calls issued and skipped, summed over every program
+    struct UniformStats {
+        size_t uploads = 0;
+        size_t skipped = 0;
+    };
+
+    /// How the programs linked so far got built
+    struct ProgramCacheStats {
+        size_t loaded = 0;
+        size_t compiled = 0;
+
+        /// spent in BeginLink and FinishLink, either way. Compiles the driver runs on its own threads only show
+        /// up here if FinishLink has to wait for them
+        double milliseconds = 0.0;
     };
 
     class Program final {
     private:
+        struct UniformSlot {
+            /// the default, with a hash of 0, marks the slot empty
+            UniformHandle handle;
+            GLint location = -1;
+
+            /// where the uniform's last uploaded value is kept in m_shadow, and how many bytes it takes
+            uint32_t shadowOffset = 0;
+            uint32_t shadowSize = 0;
+
+            /// whether the whole uniform has been uploaded at least once, so the shadow copy can be trusted
+            bool valid = false;
+        };
+
+        struct ShaderSource {
+            ShaderType type;
+            std::string path;
+            std::string source;
+        };
+
         GLuint m_glid;
 
-        std::map<std::string, GLint> m_uniforms; // using ordered maps because r-b trees are generally better for memory and string search (I think)
+        /// what AttachShader read, compiled by BeginLink unless the binary cache has the program
+        std::vector<ShaderSource> m_sources;
+
+        /// one per source while a link is pending, attached but already flagged for deletion,
+        /// so they go away when FinishLink detaches them
+        std::vector<GLuint> m_shaders;
+
+        /// where FinishLink saves the binary, empty if it came from the cache or there's no cache
+        std::string m_cachePath;
+
+        bool m_linking = false;
+
+        /// open addressing, filled from the program's active uniforms when it's linked
+        std::vector<UniformSlot> m_uniforms;
+
+        /// a copy of every uniform value the program was given, so setting a uniform to the value it already has
+        /// doesn't reach GL
+        std::vector<uint8_t> m_shadow;
+
+        static UniformStats s_uniformStats;
+
+        static ProgramCacheStats s_cacheStats;
+        static std::string s_cacheDirectory;
 
-        GLint GetUniformLocation(const std::string& uniform);
+        /// Submits the compiles and the link without waiting on any of them, FinishLink checks how they went
+        void CompileAndLink();
+
+        /// Throws with whichever shader failed to compile, or the link log if they all compiled
+        void ThrowLinkError();
+
+        /// @returns Where the binary for these sources on this driver goes, empty if binaries aren't supported
+        std::string GetCachePath() const;
+
+        bool LoadBinary(const std::string& path);
+
+        void SaveBinary(const std::string& path) const;
+
+        void ReflectUniforms();
+
+        void AddUniform(const std::string& name, GLint location, size_t shadowOffset, size_t shadowSize);
+
+        UniformSlot* FindUniform(UniformHandle uniform);
+
+        /// Updates the shadow copy
+        /// @returns The location to upload the value to, -1 if the uniform doesn't exist or already has the value
+        GLint PrepareUpload(UniformHandle uniform, const void* value, size_t size);
     public:
         Program();
 
@@ -29,23 +189,64 @@ namespace Engine::GL {
         Program(const Program&) = delete;
         Program& operator=(const Program&) = delete;
 
+        /// Finishes a pending link first, waiting on it if it has to
         void Use();
 
-        void AttachShader(const char* path, ShaderType type);
+        /// Reads a shader's source, compiling it is left to Link
+        /// @param defines Get inserted as #defines right after the #version line
+        void AttachShader(const char* path, ShaderType type, const ShaderDefines& defines = {});
 
+        /// BeginLink and FinishLink, waiting for the compiler in between
         void Link();
 
-        void SetUniform(const std::string& uniform, const int value);
+        /// Loads the program from the binary cache if it has these exact sources for this driver (GL 4.1 or
+        /// ARB_get_program_binary), otherwise submits the compiles and the link. Drivers compile in the background
+        /// until something asks for the result, so begin every program before finishing any of them
+        void BeginLink();
+
+        /// Whether FinishLink can run without waiting. Always true without KHR_parallel_shader_compile, there's
+        /// no asking the driver without waiting for it then
+        bool IsReady() const;
+
+        /// Waits for the link BeginLink submitted, stores the binary in the cache and looks up the uniforms.
+        /// Throws with the compile or link log if it failed
+        void FinishLink();
+
+        /// Begins every program, then finishes every program, so the driver can compile them side by side
+        static void LinkAll(std::initializer_list<Program*> programs);
+
+        /// Runs a compute program on a grid of work groups. Binds the program, but doesn't add any barrier
+        /// for whatever reads the results, that's up to the caller
+        void Dispatch(GLuint groupsX, GLuint groupsY = 1, GLuint groupsZ = 1);
+
+        // uniforms the program doesn't have (or the compiler optimized out) are silently ignored, like GL does.
+        // Like glUniform*, these go to the program in use, which has to be this one
+
+        void SetUniform(UniformHandle uniform, const int value);
+
+        void SetUniform(UniformHandle uniform, const float value);
+
+        void SetUniform(UniformHandle uniform, const glm::vec2& vec);
+
+        void SetUniform(UniformHandle uniform, const glm::vec4& vec);
+
+        void SetUniform(UniformHandle uniform, const glm::vec3& vec);
+
+        void SetUniform(UniformHandle uniform, const glm::mat3& mat);
+
+        void SetUniform(UniformHandle uniform, const glm::mat4& mat);
 
-        void SetUniform(const std::string& uniform, const float value);
+        /// Sets count elements of an array, starting at the first one
+        void SetUniform(UniformHandle uniform, const glm::vec4* vecs, GLsizei count);
 
-        void SetUniform(const std::string& uniform, const glm::vec4& vec);
+        static const UniformStats& GetUniformStats() { return s_uniformStats; }
 
-        void SetUniform(const std::string& uniform, const glm::vec3& vec);
+        static void ResetUniformStats() { s_uniformStats = {}; }
 
-        void SetUniform(const std::string& uniform, const glm::mat3& mat);
+        static const ProgramCacheStats& GetCacheStats() { return s_cacheStats; }
 
-        void SetUniform(const std::string& uniform, const glm::mat4& mat);
+        /// Where Link keeps program binaries, "shadercache" by default. Empty disables the cache
+        static void SetCacheDirectory(std::string directory) { s_cacheDirectory = std::move(directory); }
     };
 
-}
\ No newline at end of file
+}
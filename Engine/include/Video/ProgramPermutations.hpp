@@ -0,0 +1,60 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Video/Program.hpp"
+
+namespace Engine::GL {
+    /// Variants of one program, compiled from the same shader files with different #defines, so choices that would
+    /// otherwise be uniform branches in the shader get compiled out. Variants are built the first time they're asked
+    /// for, and not on the spot: Find queues them and Update submits them to the driver and picks up the ones it's
+    /// done with, so a new combination costs a few frames of the fallback instead of a hitch
+    class ProgramPermutations {
+        struct Stage {
+            std::string path;
+            ShaderType type;
+        };
+
+        struct Variant {
+            /// null while the variant is queued
+            std::unique_ptr<Program> program;
+
+            /// linked and ready to draw with
+            bool ready = false;
+        };
+
+        std::vector<Stage> m_stages;
+
+        std::map<ShaderDefines, Variant> m_variants;
+        std::vector<ShaderDefines> m_queue;
+
+        size_t m_pending = 0;
+
+        /// Attaches the shaders and begins the link
+        void Submit(const ShaderDefines& defines, Variant& variant);
+    public:
+        /// Adds a shader file every variant is built from
+        void AttachShader(const char* path, ShaderType type);
+
+        /// The variant for a set of defines, built right away if it isn't yet. For the ones that have to be there
+        /// from the first frame, like the fallback
+        Program& Build(const ShaderDefines& defines);
+
+        /// The variant for a set of defines if it's built, null if it isn't, in which case it gets queued for Update
+        Program* Find(const ShaderDefines& defines);
+
+        /// Begins linking every queued variant, then finishes up to maxFinishes of the ones the driver reports done.
+        /// Without KHR_parallel_shader_compile the driver can't be asked, so every pending variant counts as done
+        /// and finishing one waits for its compile, which is what the limit is for
+        void Update(size_t maxFinishes = 1);
+
+        /// Variants built so far
+        size_t GetBuiltCount() const { return m_variants.size() - m_queue.size() - m_pending; }
+
+        /// Variants queued or compiling
+        size_t GetQueuedCount() const { return m_queue.size() + m_pending; }
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "glad/glad.h"
+
+namespace Engine::GL {
+    /// Sums a query's results over any number of Begin/End ranges a frame: samples that pass the depth test with
+    /// GL_SAMPLES_PASSED, so how much shading a frame does can be compared between techniques, or nanoseconds of
+    /// GPU time with GL_TIME_ELAPSED. Results are read FRAMES_IN_FLIGHT frames later, when the GPU is done with
+    /// them, instead of waiting on them right away.
+    /// Queries of one target can't overlap, so a GL_SAMPLES_PASSED range can't contain an OcclusionQuery::Issue
+    class QueryCounter {
+        static constexpr size_t FRAMES_IN_FLIGHT = 3;
+
+        GLenum m_target;
+
+        /// the queries each frame in flight issued
+        std::array<std::vector<GLuint>, FRAMES_IN_FLIGHT> m_issued;
+        std::vector<GLuint> m_free;
+
+        size_t m_frame = 0;
+
+        uint64_t m_total = 0;
+        size_t m_frames = 0;
+    public:
+        explicit QueryCounter(GLenum target) : m_target(target) {}
+
+        ~QueryCounter();
+
+        QueryCounter(const QueryCounter&) = delete;
+        QueryCounter& operator=(const QueryCounter&) = delete;
+
+        void Begin();
+
+        void End();
+
+        /// Call once per frame after the last range, collects the oldest frame in flight
+        void NextFrame();
+
+        /// Samples or nanoseconds counted per frame, over the frames collected since the last Reset
+        uint64_t GetAverage() const { return m_frames > 0 ? m_total / m_frames : 0; }
+
+        void Reset()
+        {
+            m_total = 0;
+            m_frames = 0;
+        }
+    };
+}
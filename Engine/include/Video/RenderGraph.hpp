@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "glad/glad.h"
+
+namespace Engine::GL {
+    /// A 2D texture for the graph to allocate, single sampled, linear filtered and clamped to the edge
+    struct RenderTextureDesc {
+        GLenum internalFormat;
+        int width;
+        int height;
+
+        bool operator==(const RenderTextureDesc& rhs) const
+        {
+            return internalFormat == rhs.internalFormat && width == rhs.width && height == rhs.height;
+        }
+    };
+
+    /// Names a texture or buffer declared on a RenderGraph, good until the graph's next Reset
+    struct RenderResource {
+        uint32_t index = ~0u;
+
+        bool IsValid() const { return index != ~0u; }
+    };
+
+    /// What the last frame's graph came to
+    struct RenderGraphStats {
+        size_t passes = 0;
+        size_t culledPasses = 0;
+
+        /// textures created by the graph, and the GL textures backing them once the ones with lifetimes that don't
+        /// overlap share
+        size_t transientTextures = 0;
+        size_t allocatedTextures = 0;
+
+        /// the transient textures' bytes if each had its own, and the bytes of the textures that backed them
+        size_t transientBytes = 0;
+        size_t allocatedBytes = 0;
+
+        /// everything the graph holds on to, textures kept around for the next frames included
+        size_t pooledBytes = 0;
+    };
+
+    class RenderGraph;
+
+    /// Handed to a pass's setup to declare what the pass touches
+    class RenderPassBuilder {
+        friend class RenderGraph;
+
+        RenderGraph& m_graph;
+        uint32_t m_pass;
+
+        RenderPassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+    public:
+        /// The pass samples, copies from or otherwise reads the resource
+        RenderResource Read(RenderResource resource);
+
+        /// The pass renders into the resource. Textures get attached to the framebuffer the graph binds for the
+        /// pass, color formats in the order they were written and depth formats to the depth attachment. Writing
+        /// the backbuffer has the pass render to the default framebuffer
+        RenderResource Write(RenderResource resource);
+
+        /// Keeps the pass even when nothing reads what it writes
+        void SetSideEffect();
+    };
+
+    /// Frame graph for a frame's passes, declared from scratch every frame. Each pass says what it reads and
+    /// writes; Compile orders the passes by those dependencies, culls the ones that don't lead to a side effect
+    /// (writing the backbuffer or an imported resource, or asking for one), and works out when each transient
+    /// texture is first and last used. Transient textures whose lifetimes don't overlap share a GL texture.
+    /// GL 3.3 has no way to put textures of different formats in the same memory, so only textures of the same
+    /// format and size share; the textures stay with the graph across frames and get dropped once unused for a
+    /// few. A read sees the last write declared before it; for transients, when there's none, the first one
+    /// declared after, so passes producing a texture don't have to be declared before the ones reading it
+    class RenderGraph {
+    public:
+        using SetupFunction = std::function<void(RenderPassBuilder&)>;
+        using ExecuteFunction = std::function<void(const RenderGraph&)>;
+    private:
+        friend class RenderPassBuilder;
+
+        enum class ResourceType {
+            Transient,
+            ImportedTexture,
+            ImportedBuffer,
+            Backbuffer
+        };
+
+        struct Resource {
+            std::string name;
+            ResourceType type;
+            RenderTextureDesc desc;
+
+            /// the GL object, for transients once Compile has assigned one
+            GLuint object = 0;
+
+            /// positions in the execution order of the first and last live pass touching it
+            size_t first = ~size_t(0);
+            size_t last = 0;
+        };
+
+        struct Access {
+            uint32_t pass;
+            bool write;
+        };
+
+        struct Pass {
+            std::string name;
+            ExecuteFunction execute;
+
+            std::vector<uint32_t> reads;
+            std::vector<uint32_t> writes;
+            std::vector<uint32_t> dependencies;
+            bool sideEffect = false;
+            bool live = false;
+        };
+
+        struct PooledTexture {
+            RenderTextureDesc desc;
+            GLuint texture;
+            size_t bytes;
+            uint64_t lastFrame;
+
+            /// position in the execution order of lastFrame past which it's free again
+            size_t busyUntil;
+        };
+
+        std::vector<Resource> m_resources;
+        std::vector<Pass> m_passes;
+        std::vector<uint32_t> m_order;
+
+        /// every access to a resource, in the order the passes were declared
+        std::vector<std::vector<Access>> m_accesses;
+
+        std::vector<PooledTexture> m_pool;
+
+        /// framebuffers by their attachments, color first then depth
+        std::map<std::vector<GLuint>, GLuint> m_framebuffers;
+
+        /// the textures imported by the last compiled frame, with the description they came with. GL hands a
+        /// deleted texture's name out again, so a framebuffer built on an import can't be trusted once the
+        /// import goes away or comes back different
+        std::map<GLuint, RenderTextureDesc> m_imports;
+
+        RenderGraphStats m_stats;
+        uint64_t m_frame = 0;
+        bool m_compiled = false;
+
+        uint32_t AddResource(const std::string& name, ResourceType type, const RenderTextureDesc& desc, GLuint object);
+
+        void AddAccess(uint32_t pass, RenderResource resource, bool write);
+
+        void Cull();
+
+        void Sort();
+
+        void AssignTextures();
+
+        void BindFramebuffer(const Pass& pass, const GLint* viewport);
+
+        /// Deletes the framebuffers the texture is attached to
+        void EvictFramebuffers(GLuint texture);
+
+        void UpdateImports();
+
+        void ReleaseUnused();
+    public:
+        /// frames a pooled texture survives without being used
+        static constexpr uint64_t POOL_FRAMES = 3;
+
+        RenderGraph() = default;
+
+        ~RenderGraph();
+
+        RenderGraph(const RenderGraph&) = delete;
+        RenderGraph& operator=(const RenderGraph&) = delete;
+
+        /// Drops the passes and resources of the previous frame, keeps its textures and framebuffers around
+        void Reset();
+
+        /// A texture that only lives for the passes that use it
+        RenderResource CreateTexture(const std::string& name, const RenderTextureDesc& desc);
+
+        /// A texture owned elsewhere, writing it counts as a side effect. Framebuffers built on it are kept while
+        /// every frame imports it with the same description, call ForgetTexture when it's reallocated in between
+        RenderResource ImportTexture(const std::string& name, GLuint texture, const RenderTextureDesc& desc);
+
+        /// Drops the framebuffers built on a texture imported before, for when its owner deletes or reallocates it
+        void ForgetTexture(GLuint texture);
+
+        /// A buffer owned elsewhere, only there for ordering, passes bind it themselves
+        RenderResource ImportBuffer(const std::string& name, GLuint buffer);
+
+        /// The default framebuffer, as it was when Execute got called
+        RenderResource ImportBackbuffer();
+
+        /// setup runs straight away, execute when Execute gets to the pass, with the pass's framebuffer bound and
+        /// the viewport set to its attachments' size
+        void AddPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute);
+
+        /// Culls, orders and assigns textures to the passes declared since Reset. Throws on cycles, on transient
+        /// textures read before anything writes them and on attachments of different sizes
+        void Compile();
+
+        /// Runs the live passes, compiling first if that hasn't happened yet. Leaves the default framebuffer bound
+        /// with the viewport it found
+        void Execute();
+
+        /// The GL texture behind a resource, only known for transients once the graph is compiled
+        GLuint GetTexture(RenderResource resource) const;
+
+        GLuint GetBuffer(RenderResource resource) const { return GetTexture(resource); }
+
+        /// The live passes, in the order Execute runs them
+        std::vector<std::string> GetExecutionOrder() const;
+
+        const RenderGraphStats& GetStats() const { return m_stats; }
+    };
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Video/Mesh.hpp"
+#include "Video/Program.hpp"
+
+namespace Engine::GL {
+    /// Passes run in this order, opaque items front to back and transparent ones back to front
+    enum class RenderPass : uint8_t {
+        /// depth only, with color writes off and the meshes' position only vertex streams. The program only needs
+        /// to transform positions, the same way (and invariant) as the program the item gets shaded with
+        Depth,
+        /// opaque items the Depth pass already laid down, drawn with GL_EQUAL and depth writes off so every pixel
+        /// is shaded once. Has to come with the same items, models and meshlet culling in Depth, and can't discard
+        OpaqueEqual,
+        Opaque,
+        Transparent
+    };
+
+    /// What a frame's worth of Execute calls cost in state changes
+    struct RenderStats {
+        size_t draws = 0;
+        size_t programChanges = 0;
+        size_t materialChanges = 0;
+        size_t geometryChanges = 0;
+
+        /// program, material and geometry changes the items would have needed in the order they were submitted
+        size_t unsortedChanges = 0;
+    };
+
+    /// Collects draws for a frame, sorts them by a packed 64-bit key and submits them, skipping binds the
+    /// previous item already made. Opaque keys are pass | program | material | depth, so items sharing a
+    /// program and textures end up next to each other and are drawn front to back within the group.
+    /// Transparent keys put depth before everything else, since blending needs back to front order.
+    /// Depth and OpaqueEqual keys are built like opaque ones, the Depth pass ignoring textures.
+    /// Camera and light come from the FrameUniformBuffer, other uniforms that are the same for a whole frame should
+    /// be set on each program before Execute, the queue only sets "model" and "invModel" per item
+    class RenderQueue {
+        struct Item {
+            Mesh* mesh;
+            Program* program;
+            uint32_t material;
+            RenderPass pass;
+            bool cullMeshlets;
+            glm::mat4 model;
+        };
+
+        struct SortEntry {
+            uint64_t key;
+            uint32_t item;
+        };
+
+        std::vector<Item> m_items;
+        std::vector<SortEntry> m_entries;
+        std::vector<SortEntry> m_scratch;
+
+        // ids for the key, handed out the first time a program or texture set shows up
+        std::map<const Program*, uint32_t> m_programIds;
+        std::map<std::array<const Texture*, 4>, uint32_t> m_materialIds;
+
+        glm::mat4 m_projectionView;
+        glm::vec3 m_cameraPosition;
+
+        void RadixSort();
+
+        /// Color and depth writes and the depth test a pass draws with, Opaque is GL's defaults and what
+        /// Execute leaves behind
+        static void ApplyPassState(RenderPass pass);
+    public:
+        /// Drops the previous frame's items
+        /// @param projectionView projection * view, for meshlet culling
+        /// @param cameraPosition In world space, for depth sorting and meshlet culling
+        void Begin(const glm::mat4& projectionView, const glm::vec3& cameraPosition);
+
+        /// @param cullMeshlets Draw the mesh with DrawCulled instead of Draw
+        void Submit(Mesh& mesh, Program& program, const glm::mat4& model, RenderPass pass = RenderPass::Opaque, bool cullMeshlets = false);
+
+        /// Sorts the items and draws them
+        /// @param stats Gets the state changes added to it
+        /// @param drawStats Gets the triangle counts added to it
+        void Execute(RenderStats& stats, DrawStats& drawStats);
+
+        size_t Size() const { return m_items.size(); }
+    };
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include "glad/glad.h"
+
+#include "Video/GLExt.hpp"
+
+namespace Engine::GL {
+    /// Calls of one kind a StateCache got, and how many of them it dropped
+    struct StateCounter {
+        size_t calls = 0;
+        size_t skipped = 0;
+
+        /// share of the calls that never reached GL
+        double HitRate() const { return calls > 0 ? static_cast<double>(skipped) / calls : 0.0; }
+    };
+
+    struct StateCacheStats {
+        StateCounter programs;
+        StateCounter vertexArrays;
+        StateCounter textures;
+        StateCounter buffers;
+        StateCounter capabilities;
+
+        /// every kind summed up
+        StateCounter Total() const
+        {
+            StateCounter total;
+
+            for (const auto& counter : {programs, vertexArrays, textures, buffers, capabilities}) {
+                total.calls += counter.calls;
+                total.skipped += counter.skipped;
+            }
+
+            return total;
+        }
+    };
+
+    /// Remembers what the context has bound so binding the same thing again doesn't reach the driver. It only
+    /// knows what goes through it: binding behind its back has to be followed by Invalidate, and objects have to
+    /// be deleted through it so a recycled name doesn't look bound already.
+    /// GL_ELEMENT_ARRAY_BUFFER isn't tracked, it's part of the bound vao and should be bound with glBindBuffer
+    class StateCache {
+    public:
+        static constexpr unsigned TEXTURE_UNITS = 16;
+
+    private:
+        /// texture targets tracked per unit, others get bound every time
+        static constexpr std::array<GLenum, 2> TEXTURE_TARGETS = {GL_TEXTURE_2D, GL_TEXTURE_BUFFER};
+
+        /// buffer targets tracked, others get bound every time
+        static constexpr std::array<GLenum, 7> BUFFER_TARGETS = {
+                GL_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_UNIFORM_BUFFER, GL_TEXTURE_BUFFER,
+                GL_DRAW_INDIRECT_BUFFER, GL_SHADER_STORAGE_BUFFER
+        };
+
+        /// for objects whose binding isn't known, Invalidate sets everything to it
+        static constexpr GLuint UNKNOWN = ~0u;
+
+        static GLuint s_program;
+        static GLuint s_vertexArray;
+        static unsigned s_activeUnit;
+        static std::array<std::array<GLuint, TEXTURE_TARGETS.size()>, TEXTURE_UNITS> s_textures;
+        static std::array<GLuint, BUFFER_TARGETS.size()> s_buffers;
+
+        /// capability and whether it's enabled, missing ones are unknown
+        static std::vector<std::pair<GLenum, bool>> s_capabilities;
+
+        static StateCacheStats s_stats;
+
+        static void SetCapability(GLenum capability, bool enabled);
+    public:
+        static void UseProgram(GLuint program);
+
+        static void BindVertexArray(GLuint vertexArray);
+
+        /// Switches the active unit only if the binding has to change
+        static void BindTexture(unsigned unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+
+        static void BindBuffer(GLenum target, GLuint buffer);
+
+        /// glBindBufferBase also binds the buffer to the generic target, this keeps that in sync. The indexed
+        /// binding itself isn't cached
+        static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+        static void Enable(GLenum capability);
+
+        static void Disable(GLenum capability);
+
+        // GL unbinds objects when they're deleted, so these forget them before deleting them
+
+        static void DeleteProgram(GLuint program);
+
+        static void DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+
+        static void DeleteTextures(GLsizei count, const GLuint* textures);
+
+        static void DeleteBuffers(GLsizei count, const GLuint* buffers);
+
+        /// Unbinds a texture from every unit it's bound to
+        static void UnbindTexture(GLuint texture);
+
+        /// Forgets everything, so the next call of each kind goes through. For after code that binds directly
+        static void Invalidate();
+
+        static const StateCacheStats& GetStats() { return s_stats; }
+
+        static void ResetStats() { s_stats = {}; }
+    };
+}
@@ -27,6 +27,7 @@ namespace Engine::GL {
 
         void Bind(unsigned unit);
 
+        /// Unbinds the texture from every unit it's bound to
         void Unbind();
 
         static void BindNull(unsigned unit);
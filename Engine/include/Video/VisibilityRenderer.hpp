@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "glad/glad.h"
+
+#include "Video/GeometryPool.hpp"
+#include "Video/GLExt.hpp"
+#include "Video/IndirectRenderer.hpp"
+#include "Video/Mesh.hpp"
+#include "Video/Program.hpp"
+
+namespace Engine::GL {
+    /// Shades every pixel once, however many triangles got rasterized over it. The geometry pass multi draws the
+    /// meshes out of a GeometryPool into a GL_RG32UI target holding nothing but the draw and the triangle that won
+    /// the depth test. A full screen pass then writes each pixel's material into a depth buffer of its own, and
+    /// each material gets a full screen pass at its depth with the test set to GL_EQUAL, so the early depth test
+    /// throws out the pixels of every other material. Those passes fetch the triangle's vertices from the pool's
+    /// buffers bound as storage blocks, work out perspective correct barycentrics and their screen space
+    /// derivatives, and run the bumpmapped shading, or relief parallax for materials with a displacement map.
+    /// Parallax can't discard there, the visibility was settled before it ran. Needs GL 4.3, like IndirectRenderer
+    class VisibilityRenderer {
+        /// std430 layout, matches the DrawData block in the visibility shaders
+        struct DrawData {
+            glm::mat4 model;
+            glm::mat4 invModel;
+            glm::vec4 posBias;
+            glm::vec4 posScale;
+
+            /// where the draw's first index is in its bucket, at its LOD level when it was submitted
+            uint32_t firstIndex;
+            int32_t baseVertex;
+            uint32_t material;
+            uint32_t pad0;
+        };
+
+        struct Item {
+            Mesh* mesh;
+            uint32_t bucket;
+            glm::mat4 model;
+        };
+
+        /// draws with the same textures out of the same bucket, shaded by one full screen pass
+        struct Material {
+            Mesh* mesh;
+            uint32_t bucket;
+        };
+
+        Program m_geometryProgram;
+        Program m_materialProgram;
+        Program m_shadeProgram;
+        Program m_parallaxProgram;
+        Program m_compositeProgram;
+
+        GeometryPool m_pool;
+
+        std::vector<Item> m_items;
+        std::vector<uint32_t> m_order;
+        std::vector<Material> m_materials;
+
+        std::vector<DrawData> m_drawData;
+        std::vector<Ext::DrawElementsIndirectCommand> m_commands;
+
+        GLuint m_drawDataBuffer = 0;
+        GLuint m_commandBuffer = 0;
+
+        /// GL_RG32UI draw index + 1 (0 where nothing was drawn) and triangle, and GL_DEPTH_COMPONENT32F depth
+        GLuint m_visibilityFramebuffer = 0;
+        GLuint m_visibility = 0;
+        GLuint m_depth = 0;
+
+        /// the shaded scene, and every pixel's material as a GL_DEPTH_COMPONENT32F depth
+        GLuint m_shadeFramebuffer = 0;
+        GLuint m_color = 0;
+        GLuint m_materialDepth = 0;
+
+        GLuint m_emptyVao = 0;
+
+        float m_heightScale = 0.1f;
+
+        int m_width = 0;
+        int m_height = 0;
+
+        void Resize(int width, int height);
+    public:
+        static constexpr GLuint DRAW_DATA_BINDING = 0;
+        static constexpr GLuint VERTEX_BINDING = 1;
+        static constexpr GLuint INDEX_BINDING = 2;
+
+        /// material depths are (material + 1) / MAX_MATERIALS, which a 32-bit float depth buffer holds exactly
+        static constexpr size_t MAX_MATERIALS = 4096;
+
+        /// the unit the shading passes read the visibility target from, after the material's 4
+        static constexpr unsigned VISIBILITY_UNIT = 4;
+
+        VisibilityRenderer();
+
+        ~VisibilityRenderer();
+
+        VisibilityRenderer(const VisibilityRenderer&) = delete;
+        VisibilityRenderer& operator=(const VisibilityRenderer&) = delete;
+
+        /// Whether the context can run this path: the same as IndirectRenderer
+        static bool IsSupported() { return IndirectRenderer::IsSupported(); }
+
+        /// Drops the previous frame's draws
+        void Begin();
+
+        /// Queues the mesh at its current LOD level, copying it into the pool the first time it shows up
+        void Submit(Mesh& mesh, const glm::mat4& model);
+
+        /// Draws the frame's meshes into the visibility target, shades them and writes the result to the default
+        /// framebuffer along with their depth, so forward drawn objects can go on top. Lit by the frame uniforms'
+        /// light and the PointLights block. Leaves the default framebuffer bound and the depth test on
+        void Execute(IndirectStats& stats, DrawStats& drawStats);
+
+        /// How deep the parallax materials' height maps go, like the forward shaders' heightScale
+        void SetHeightScale(float scale) { m_heightScale = scale; }
+
+        /// Full screen shading passes the last Execute ran
+        size_t GetMaterialCount() const { return m_materials.size(); }
+
+        const GeometryPool& GetPool() const { return m_pool; }
+    };
+}
@@ -23,5 +23,8 @@ namespace Engine::GL {
         Window& operator=(const Window&) = delete;
 
         void Present();
+
+        /// 0 turns vsync off, 1 turns it on and -1, what the window starts with, asks for adaptive vsync
+        void SetSwapInterval(int interval);
     };
 }
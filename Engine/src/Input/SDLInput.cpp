@@ -37,6 +37,9 @@ namespace Engine::Input {
                         case SDLK_d:
                             KeyState[Keys::D] = true;
                             break;
+                        case SDLK_b:
+                            KeyState[Keys::B] = true;
+                            break;
                         case SDLK_F1:
                             KeyState[Keys::F1] = true;
                             break;
@@ -46,6 +49,33 @@ namespace Engine::Input {
                         case SDLK_F3:
                             KeyState[Keys::F3] = true;
                             break;
+                        case SDLK_F4:
+                            KeyState[Keys::F4] = true;
+                            break;
+                        case SDLK_F5:
+                            KeyState[Keys::F5] = true;
+                            break;
+                        case SDLK_F6:
+                            KeyState[Keys::F6] = true;
+                            break;
+                        case SDLK_F7:
+                            KeyState[Keys::F7] = true;
+                            break;
+                        case SDLK_F8:
+                            KeyState[Keys::F8] = true;
+                            break;
+                        case SDLK_F9:
+                            KeyState[Keys::F9] = true;
+                            break;
+                        case SDLK_F10:
+                            KeyState[Keys::F10] = true;
+                            break;
+                        case SDLK_F11:
+                            KeyState[Keys::F11] = true;
+                            break;
+                        case SDLK_F12:
+                            KeyState[Keys::F12] = true;
+                            break;
                         default:
                             break;
                     }
@@ -64,6 +94,9 @@ namespace Engine::Input {
                         case SDLK_d:
                             KeyState[Keys::D] = false;
                             break;
+                        case SDLK_b:
+                            KeyState[Keys::B] = false;
+                            break;
                         case SDLK_F1:
                             KeyState[Keys::F1] = false;
                             break;
@@ -73,6 +106,33 @@ namespace Engine::Input {
                         case SDLK_F3:
                             KeyState[Keys::F3] = false;
                             break;
+                        case SDLK_F4:
+                            KeyState[Keys::F4] = false;
+                            break;
+                        case SDLK_F5:
+                            KeyState[Keys::F5] = false;
+                            break;
+                        case SDLK_F6:
+                            KeyState[Keys::F6] = false;
+                            break;
+                        case SDLK_F7:
+                            KeyState[Keys::F7] = false;
+                            break;
+                        case SDLK_F8:
+                            KeyState[Keys::F8] = false;
+                            break;
+                        case SDLK_F9:
+                            KeyState[Keys::F9] = false;
+                            break;
+                        case SDLK_F10:
+                            KeyState[Keys::F10] = false;
+                            break;
+                        case SDLK_F11:
+                            KeyState[Keys::F11] = false;
+                            break;
+                        case SDLK_F12:
+                            KeyState[Keys::F12] = false;
+                            break;
                         default:
                             break;
                     }
@@ -1,5 +1,10 @@
 #include "Util/AssimpLoader.hpp"
+#include "Util/MeshData.hpp"
+#include "Util/IndexOptimizer.hpp"
+#include "Util/Meshlets.hpp"
+#include "Util/Simplifier.hpp"
 
+#include <cstdio>
 #include <stdexcept>
 #include <unordered_map>
 
@@ -25,35 +30,37 @@ namespace Engine::Util::AssimpLoader {
         }
     }
 
-    static Mesh ProcessMesh(const aiScene *scene, aiMesh* mesh)
-    {
-        std::vector<glm::vec3> vertices;
-        std::vector<glm::vec2> uvs;
-        std::vector<glm::vec3> normals;
-        std::vector<glm::vec3> tangents;
+    /// Everything the node walk needs to carry around
+    struct LoadState {
+        const aiScene* scene;
+        LoadOptions options;
 
-        std::vector<unsigned> indices;
+        std::vector<Mesh> meshes;
 
-        Texture* diffuseMap = nullptr;
-        Texture* specularMap = nullptr;
-        Texture* normalMap = nullptr;
-        Texture* displacementMap = nullptr;
+        // vertex shader invocations before and after index optimization, for the report
+        double missesBefore = 0.0, missesAfter = 0.0;
+        size_t triangles = 0, vertices = 0;
+    };
+
+    static MeshData ReadMeshData(const aiMesh* mesh)
+    {
+        MeshData data;
 
         for (size_t i = 0; i < mesh->mNumVertices; ++i) {
             auto vertex = mesh->mVertices[i];
-            vertices.emplace_back(vertex.x, vertex.y, vertex.z);
+            data.positions.emplace_back(vertex.x, vertex.y, vertex.z);
 
             auto normal = mesh->mNormals[i];
-            normals.emplace_back(normal.x, normal.y, normal.z);
+            data.normals.emplace_back(normal.x, normal.y, normal.z);
 
             if (mesh->mTextureCoords[0] != nullptr) {
                 auto uv = mesh->mTextureCoords[0][i];
-                uvs.emplace_back(uv.x, uv.y);
+                data.uvs.emplace_back(uv.x, uv.y);
             }
 
             if (mesh->mTangents != nullptr) {
                 auto tangent = mesh->mTangents[i];
-                tangents.emplace_back(tangent.x, tangent.y, tangent.z);
+                data.tangents.emplace_back(tangent.x, tangent.y, tangent.z);
             }
         }
 
@@ -61,10 +68,24 @@ namespace Engine::Util::AssimpLoader {
             aiFace face = mesh->mFaces[i];
 
             for (size_t j = 0; j < face.mNumIndices; ++j) {
-                indices.emplace_back(face.mIndices[j]);
+                data.indices.emplace_back(face.mIndices[j]);
             }
         }
 
+        return data;
+    }
+
+    static void ProcessMesh(LoadState& state, aiMesh* mesh)
+    {
+        auto scene = state.scene;
+
+        MeshData data = ReadMeshData(mesh);
+
+        Texture* diffuseMap = nullptr;
+        Texture* specularMap = nullptr;
+        Texture* normalMap = nullptr;
+        Texture* displacementMap = nullptr;
+
         if (mesh->mMaterialIndex >= 0) {
             aiMaterial* mtl = scene->mMaterials[mesh->mMaterialIndex];
 
@@ -93,29 +114,55 @@ namespace Engine::Util::AssimpLoader {
             }
         }
 
-        return Mesh(vertices, uvs, normals, tangents, indices, diffuseMap, specularMap, normalMap, displacementMap);
+        IndexOptimizer::CacheStats before, after;
+        IndexOptimizer::Optimize(data, &before, &after);
+
+        size_t triangles = data.indices.size() / 3;
+        state.missesBefore += before.acmr * triangles;
+        state.missesAfter += after.acmr * triangles;
+        state.triangles += triangles;
+        state.vertices += data.positions.size();
+
+        // meshes too big for 16-bit indices get cut into pieces that aren't
+        for (const auto& chunk : SplitMesh(data)) {
+            auto& uploaded = state.meshes.emplace_back(
+                    chunk.positions, chunk.uvs, chunk.normals, chunk.tangents, chunk.indices,
+                    diffuseMap, specularMap, normalMap, displacementMap, state.options.vertexFormat
+            );
+
+            if (state.options.buildMeshlets) {
+                uploaded.SetMeshlets(BuildMeshlets(chunk));
+            }
+
+            if (state.options.lodLevels > 1) {
+                uploaded.SetLods(BuildLodChain(chunk, state.options.lodLevels));
+            }
+        }
     }
 
-    static void ProcessNode(const aiScene* scene, aiNode* node, std::vector<Mesh>& meshes)
+    static void ProcessNode(LoadState& state, aiNode* node)
     {
         for (size_t i = 0; i < node->mNumMeshes; ++i) {
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.emplace_back(ProcessMesh(scene, mesh));
+            aiMesh* mesh = state.scene->mMeshes[node->mMeshes[i]];
+            ProcessMesh(state, mesh);
         }
 
         for (size_t i = 0; i < node->mNumChildren; ++i) {
             aiNode* child = node->mChildren[i];
-            ProcessNode(scene, child, meshes);
+            ProcessNode(state, child);
         }
     }
 
-    Model LoadModel(const char* path)
+    Model LoadModel(const char* path, const LoadOptions& options)
     {
-        std::vector<Mesh> meshes;
         Assimp::Importer importer;
+
+        // without joining identical vertices the obj importer hands out one vertex per face corner,
+        // which leaves nothing for the post-transform cache to reuse
         const aiScene* scene = importer.ReadFile(
                 path,
                 aiProcess_Triangulate |
+                aiProcess_JoinIdenticalVertices |
                 aiProcess_GenSmoothNormals |
                 aiProcess_CalcTangentSpace |
                 aiProcess_FlipUVs
@@ -125,8 +172,43 @@ namespace Engine::Util::AssimpLoader {
             throw std::runtime_error("assimp import failed");
         }
 
-        ProcessNode(scene, scene->mRootNode, meshes);
+        LoadState state{scene, options};
+        ProcessNode(state, scene->mRootNode);
+
+        if (state.triangles > 0) {
+            printf("%s: post-transform cache ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+                   path,
+                   state.missesBefore / state.triangles, state.missesAfter / state.triangles,
+                   state.missesBefore / state.vertices, state.missesAfter / state.vertices);
+        }
+
+        return Model{std::move(state.meshes)};
+    }
+
+    MeshData LoadMeshData(const char* path)
+    {
+        Assimp::Importer importer;
+
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals);
+
+        if (scene == nullptr) {
+            throw std::runtime_error("assimp import failed");
+        }
+
+        MeshData merged;
+
+        for (size_t i = 0; i < scene->mNumMeshes; ++i) {
+            auto data = ReadMeshData(scene->mMeshes[i]);
+            auto base = static_cast<uint32_t>(merged.positions.size());
+
+            merged.positions.insert(merged.positions.end(), data.positions.begin(), data.positions.end());
+            merged.normals.insert(merged.normals.end(), data.normals.begin(), data.normals.end());
+
+            for (auto index : data.indices) {
+                merged.indices.push_back(base + index);
+            }
+        }
 
-        return Model{std::move(meshes)};
+        return merged;
     }
-}
\ No newline at end of file
+}
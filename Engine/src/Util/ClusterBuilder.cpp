@@ -0,0 +1,360 @@
+/// @file
+/// Light to cluster assignment for clustered shading
+
+#include "Util/ClusterBuilder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ENGINE_CLUSTER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace Engine::Util {
+    namespace {
+        /// One slice of the cluster bounds, padded to a multiple of 8 clusters
+        struct SliceBounds {
+            const float* minX;
+            const float* minY;
+            const float* minZ;
+            const float* maxX;
+            const float* maxY;
+            const float* maxZ;
+            size_t count;
+        };
+
+        /// Writes a byte per 8 clusters, with a bit set for each cluster the sphere touches
+        using SphereTest = void (*)(const SliceBounds& bounds, const glm::vec4& sphere, uint8_t* masks);
+    }
+
+    static void TestSphereScalar(const SliceBounds& bounds, const glm::vec4& sphere, uint8_t* masks)
+    {
+        for (size_t i = 0; i < bounds.count; i += 8) {
+            uint8_t mask = 0;
+
+            for (size_t lane = 0; lane < 8; ++lane) {
+                auto c = i + lane;
+                auto dx = std::max({bounds.minX[c] - sphere.x, sphere.x - bounds.maxX[c], 0.0f});
+                auto dy = std::max({bounds.minY[c] - sphere.y, sphere.y - bounds.maxY[c], 0.0f});
+                auto dz = std::max({bounds.minZ[c] - sphere.z, sphere.z - bounds.maxZ[c], 0.0f});
+
+                if (dx * dx + dy * dy + dz * dz <= sphere.w * sphere.w) {
+                    mask |= 1 << lane;
+                }
+            }
+
+            masks[i / 8] = mask;
+        }
+    }
+
+#ifdef ENGINE_CLUSTER_AVX2
+    __attribute__((target("avx2")))
+    static void TestSphereAvx2(const SliceBounds& bounds, const glm::vec4& sphere, uint8_t* masks)
+    {
+        auto px = _mm256_set1_ps(sphere.x);
+        auto py = _mm256_set1_ps(sphere.y);
+        auto pz = _mm256_set1_ps(sphere.z);
+        auto radius2 = _mm256_set1_ps(sphere.w * sphere.w);
+        auto zero = _mm256_setzero_ps();
+
+        for (size_t i = 0; i < bounds.count; i += 8) {
+            // distance from the sphere's center to the box along each axis, 0 inside the box's extent
+            auto dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(bounds.minX + i), px),
+                                                  _mm256_sub_ps(px, _mm256_loadu_ps(bounds.maxX + i))), zero);
+            auto dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(bounds.minY + i), py),
+                                                  _mm256_sub_ps(py, _mm256_loadu_ps(bounds.maxY + i))), zero);
+            auto dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(bounds.minZ + i), pz),
+                                                  _mm256_sub_ps(pz, _mm256_loadu_ps(bounds.maxZ + i))), zero);
+
+            auto distance2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+            masks[i / 8] = static_cast<uint8_t>(_mm256_movemask_ps(_mm256_cmp_ps(distance2, radius2, _CMP_LE_OQ)));
+        }
+    }
+#endif
+
+    static SphereTest PickSphereTest()
+    {
+#ifdef ENGINE_CLUSTER_AVX2
+        if (__builtin_cpu_supports("avx2")) {
+            return TestSphereAvx2;
+        }
+#endif
+
+        return TestSphereScalar;
+    }
+
+    /// False only when the sphere is entirely outside the cone (Wronski's test): off to the side of it,
+    /// past its range or behind its apex
+    static bool ConeTouchesSphere(const ClusterLight& light, const glm::vec4& sphere)
+    {
+        auto v = glm::vec3(sphere) - light.position;
+        auto along = glm::dot(v, light.direction);
+        auto across = std::sqrt(std::max(glm::dot(v, v) - along * along, 0.0f));
+        auto sinAngle = std::sqrt(std::max(1.0f - light.cosAngle * light.cosAngle, 0.0f));
+
+        auto closest = light.cosAngle * across - along * sinAngle;
+
+        return closest <= sphere.w && along <= sphere.w + light.radius && along >= -sphere.w;
+    }
+
+    ClusterBuilder::ClusterBuilder(glm::uvec3 dimensions, size_t threads)
+        : m_dimensions(dimensions)
+    {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // threads get whole slices, any more than that would sit idle
+        threads = std::min<size_t>(threads, dimensions.z);
+
+        for (size_t i = 1; i < threads; ++i) {
+            m_threads.emplace_back(&ClusterBuilder::Work, this, i);
+        }
+    }
+
+    ClusterBuilder::~ClusterBuilder()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_wake.notify_all();
+
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void ClusterBuilder::SetProjection(const glm::mat4& projection, float near, float far)
+    {
+        m_near = near;
+        m_far = far;
+
+        m_sliceDepths.resize(m_dimensions.z + 1);
+
+        for (size_t k = 0; k <= m_dimensions.z; ++k) {
+            m_sliceDepths[k] = near * std::pow(far / near, static_cast<float>(k) / m_dimensions.z);
+        }
+
+        size_t tiles = m_dimensions.x * m_dimensions.y;
+        m_sliceStride = (tiles + 7) / 8 * 8;
+
+        auto total = m_sliceStride * m_dimensions.z;
+
+        // padding gets boxes inside out at infinity, which nothing touches
+        constexpr auto farAway = std::numeric_limits<float>::max();
+
+        m_minX.assign(total, farAway);
+        m_minY.assign(total, farAway);
+        m_minZ.assign(total, farAway);
+        m_maxX.assign(total, -farAway);
+        m_maxY.assign(total, -farAway);
+        m_maxZ.assign(total, -farAway);
+        m_spheres.assign(total, glm::vec4(0.0f));
+        m_lists.resize(total);
+
+        auto inverse = glm::inverse(projection);
+
+        for (size_t z = 0; z < m_dimensions.z; ++z) {
+            for (size_t y = 0; y < m_dimensions.y; ++y) {
+                for (size_t x = 0; x < m_dimensions.x; ++x) {
+                    glm::vec3 lo(farAway), hi(-farAway);
+
+                    // the tile's corner rays, cut at the slice's near and far depths. The first slice reaches back to
+                    // the camera, so whatever's in front of near still lands in a cluster
+                    for (size_t corner = 0; corner < 4; ++corner) {
+                        auto ndcX = -1.0f + 2.0f * (x + (corner & 1)) / m_dimensions.x;
+                        auto ndcY = -1.0f + 2.0f * (y + (corner >> 1)) / m_dimensions.y;
+
+                        auto onNear = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+                        auto ray = glm::vec3(onNear) / onNear.w;
+
+                        for (auto depth : {z == 0 ? 0.0f : m_sliceDepths[z], m_sliceDepths[z + 1]}) {
+                            auto point = ray * (depth / -ray.z);
+
+                            lo = glm::min(lo, point);
+                            hi = glm::max(hi, point);
+                        }
+                    }
+
+                    auto i = z * m_sliceStride + y * m_dimensions.x + x;
+
+                    m_minX[i] = lo.x;
+                    m_minY[i] = lo.y;
+                    m_minZ[i] = lo.z;
+                    m_maxX[i] = hi.x;
+                    m_maxY[i] = hi.y;
+                    m_maxZ[i] = hi.z;
+                    m_spheres[i] = glm::vec4((lo + hi) * 0.5f, glm::length(hi - lo) * 0.5f);
+                }
+            }
+        }
+    }
+
+    void ClusterBuilder::Work(size_t worker)
+    {
+        uint64_t seen = 0;
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+
+                if (m_stop) {
+                    return;
+                }
+
+                seen = m_generation;
+            }
+
+            BinSlices(worker);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                if (--m_running == 0) {
+                    m_done.notify_one();
+                }
+            }
+        }
+    }
+
+    void ClusterBuilder::BinSlices(size_t worker)
+    {
+        static const auto testSphere = PickSphereTest();
+
+        std::vector<uint8_t> masks(m_sliceStride / 8);
+
+        for (size_t slice = worker; slice < m_dimensions.z; slice += GetThreadCount()) {
+            auto base = slice * m_sliceStride;
+
+            for (size_t i = base; i < base + m_sliceStride; ++i) {
+                m_lists[i].clear();
+            }
+
+            SliceBounds bounds{
+                    &m_minX[base], &m_minY[base], &m_minZ[base],
+                    &m_maxX[base], &m_maxY[base], &m_maxZ[base],
+                    m_sliceStride
+            };
+
+            // the first slice reaches back to the camera, like its clusters' bounds
+            auto sliceNear = slice == 0 ? 0.0f : m_sliceDepths[slice];
+            auto sliceFar = m_sliceDepths[slice + 1];
+
+            for (size_t l = 0; l < m_viewLights.size(); ++l) {
+                const auto& light = m_viewLights[l];
+                auto depth = -light.position.z;
+
+                if (depth + light.radius < sliceNear || depth - light.radius > sliceFar) {
+                    continue;
+                }
+
+                testSphere(bounds, glm::vec4(light.position, light.radius), masks.data());
+
+                for (size_t group = 0; group < masks.size(); ++group) {
+                    if (masks[group] == 0) {
+                        continue;
+                    }
+
+                    for (size_t lane = 0; lane < 8; ++lane) {
+                        auto cluster = base + group * 8 + lane;
+
+                        if (!(masks[group] >> lane & 1)) {
+                            continue;
+                        }
+
+                        if (light.cosAngle > -1.0f && !ConeTouchesSphere(light, m_spheres[cluster])) {
+                            continue;
+                        }
+
+                        m_lists[cluster].push_back(static_cast<uint16_t>(l));
+                    }
+                }
+            }
+        }
+    }
+
+    void ClusterBuilder::Build(const std::vector<ClusterLight>& lights, const glm::mat4& view)
+    {
+        if (lights.size() > std::numeric_limits<uint16_t>::max() + size_t(1)) {
+            throw std::runtime_error("too many lights for 16-bit cluster indices");
+        }
+
+        if (m_sliceDepths.empty()) {
+            throw std::runtime_error("cluster bounds missing, SetProjection has to come before Build");
+        }
+
+        auto rotation = glm::mat3(view);
+        m_viewLights.resize(lights.size());
+
+        for (size_t i = 0; i < lights.size(); ++i) {
+            const auto& light = lights[i];
+            m_viewLights[i] = {glm::vec3(view * glm::vec4(light.position, 1.0f)), light.radius, rotation * light.direction, light.cosAngle};
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = m_threads.size();
+            m_generation++;
+        }
+
+        m_wake.notify_all();
+
+        BinSlices(0);
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_running == 0; });
+        }
+
+        // one list after the other in cluster order, leaving the padding out
+        m_ranges.clear();
+        m_indices.clear();
+
+        for (size_t z = 0; z < m_dimensions.z; ++z) {
+            for (size_t tile = 0; tile < m_dimensions.x * m_dimensions.y; ++tile) {
+                const auto& list = m_lists[z * m_sliceStride + tile];
+
+                m_ranges.push_back(static_cast<uint32_t>(m_indices.size()));
+                m_ranges.push_back(static_cast<uint32_t>(list.size()));
+                m_indices.insert(m_indices.end(), list.begin(), list.end());
+            }
+        }
+    }
+
+    size_t ClusterBuilder::GetCluster(const glm::vec2& ndc, float depth) const
+    {
+        if (depth < 0.0f || depth >= m_far || std::abs(ndc.x) > 1.0f || std::abs(ndc.y) > 1.0f) {
+            return static_cast<size_t>(-1);
+        }
+
+        auto slice = depth > m_near ? static_cast<size_t>(std::log(depth / m_near) / std::log(m_far / m_near) * m_dimensions.z) : 0;
+        auto x = static_cast<size_t>((ndc.x + 1.0f) * 0.5f * m_dimensions.x);
+        auto y = static_cast<size_t>((ndc.y + 1.0f) * 0.5f * m_dimensions.y);
+
+        slice = std::min<size_t>(slice, m_dimensions.z - 1);
+        x = std::min<size_t>(x, m_dimensions.x - 1);
+        y = std::min<size_t>(y, m_dimensions.y - 1);
+
+        return x + m_dimensions.x * (y + m_dimensions.y * slice);
+    }
+
+    ClusterStats ClusterBuilder::GetStats() const
+    {
+        ClusterStats stats;
+        stats.references = m_indices.size();
+
+        for (size_t i = 1; i < m_ranges.size(); i += 2) {
+            stats.nonEmpty += m_ranges[i] != 0;
+            stats.maxLights = std::max<size_t>(stats.maxLights, m_ranges[i]);
+        }
+
+        return stats;
+    }
+}
@@ -0,0 +1,118 @@
+/// @file
+/// Frustum culling over a table of bounding spheres
+
+#include "Util/CullTable.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ENGINE_CULL_AVX2
+#include <immintrin.h>
+#endif
+
+namespace Engine::Util {
+    size_t CullTable::Add(const glm::vec3& center, float radius)
+    {
+        if (m_count == m_x.size()) {
+            auto padded = m_x.size() + 8;
+
+            m_x.resize(padded, 0.0f);
+            m_y.resize(padded, 0.0f);
+            m_z.resize(padded, 0.0f);
+            m_radius.resize(padded, 0.0f);
+            m_visible.resize(padded, 0);
+        }
+
+        Set(m_count, center, radius);
+        m_visible[m_count] = 1;
+
+        return m_count++;
+    }
+
+    static size_t CullScalar(const float* x, const float* y, const float* z, const float* radius, size_t count, const Frustum& frustum, uint8_t* visible)
+    {
+        size_t survivors = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+            visible[i] = frustum.TestSphere({x[i], y[i], z[i]}, radius[i]);
+            survivors += visible[i];
+        }
+
+        return survivors;
+    }
+
+#ifdef ENGINE_CULL_AVX2
+    __attribute__((target("avx2")))
+    static size_t CullAvx2(const float* x, const float* y, const float* z, const float* radius, size_t count, const Frustum& frustum, uint8_t* visible)
+    {
+        // movemask -> 8 bytes of 0/1, so a whole block of results is stored with one write
+        static const auto expand = [] {
+            std::array<uint64_t, 256> table{};
+
+            for (size_t mask = 0; mask < 256; ++mask) {
+                for (size_t lane = 0; lane < 8; ++lane) {
+                    table[mask] |= static_cast<uint64_t>((mask >> lane) & 1) << (lane * 8);
+                }
+            }
+
+            return table;
+        }();
+
+        const auto& planes = frustum.GetPlanes();
+        __m256 px[6], py[6], pz[6], pw[6];
+
+        for (size_t p = 0; p < 6; ++p) {
+            px[p] = _mm256_set1_ps(planes[p].x);
+            py[p] = _mm256_set1_ps(planes[p].y);
+            pz[p] = _mm256_set1_ps(planes[p].z);
+            pw[p] = _mm256_set1_ps(planes[p].w);
+        }
+
+        size_t survivors = 0;
+
+        for (size_t i = 0; i < count; i += 8) {
+            auto cx = _mm256_loadu_ps(x + i);
+            auto cy = _mm256_loadu_ps(y + i);
+            auto cz = _mm256_loadu_ps(z + i);
+            auto negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+
+            auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            for (size_t p = 0; p < 6; ++p) {
+                auto distance = _mm256_add_ps(
+                        _mm256_add_ps(_mm256_mul_ps(px[p], cx), _mm256_mul_ps(py[p], cy)),
+                        _mm256_add_ps(_mm256_mul_ps(pz[p], cz), pw[p])
+                );
+
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+
+            auto mask = static_cast<unsigned>(_mm256_movemask_ps(inside));
+
+            // lanes past the end are padding
+            if (count - i < 8) {
+                mask &= (1u << (count - i)) - 1;
+            }
+
+            std::memcpy(visible + i, &expand[mask], sizeof(uint64_t));
+            survivors += __builtin_popcount(mask);
+        }
+
+        return survivors;
+    }
+#endif
+
+    size_t CullTable::Cull(const Frustum& frustum)
+    {
+#ifdef ENGINE_CULL_AVX2
+        static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+
+        if (hasAvx2) {
+            return CullAvx2(m_x.data(), m_y.data(), m_z.data(), m_radius.data(), m_count, frustum, m_visible.data());
+        }
+#endif
+
+        return CullScalar(m_x.data(), m_y.data(), m_z.data(), m_radius.data(), m_count, frustum, m_visible.data());
+    }
+}
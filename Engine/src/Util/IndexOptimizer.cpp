@@ -0,0 +1,333 @@
+/// @file
+/// Triangle and vertex reordering passes run on meshes before they are uploaded
+
+#include "Util/IndexOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Engine::Util::IndexOptimizer {
+    CacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize)
+    {
+        CacheStats stats;
+
+        if (indices.empty() || vertexCount == 0) {
+            return stats;
+        }
+
+        // a vertex is in the cache if it was pushed less than cacheSize misses ago
+        std::vector<size_t> pushedAt(vertexCount, 0);
+        size_t misses = 0;
+
+        for (auto index : indices) {
+            if (misses - pushedAt[index] >= cacheSize || pushedAt[index] == 0) {
+                misses++;
+                pushedAt[index] = misses;
+            }
+        }
+
+        stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+        stats.atvr = static_cast<float>(misses) / vertexCount;
+
+        return stats;
+    }
+
+    // tuning values from Forsyth's paper
+    static constexpr size_t CACHE_SIZE = 32;
+    static constexpr float CACHE_DECAY_POWER = 1.5f;
+    static constexpr float LAST_TRI_SCORE = 0.75f;
+    static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    static float VertexScore(int cachePosition, size_t remainingTriangles)
+    {
+        if (remainingTriangles == 0) {
+            // nothing left to draw with this vertex
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // the previous triangle used it, favouring it here would just make strips
+                score = LAST_TRI_SCORE;
+            } else {
+                float scaler = 1.0f / (CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        // finish off vertices with few triangles left, so they don't end up as lone stragglers later
+        score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+
+        return score;
+    }
+
+    void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+    {
+        size_t triangleCount = indices.size() / 3;
+
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // vertex -> triangles adjacency, as offsets into a flat array
+        std::vector<uint32_t> remaining(vertexCount, 0);
+
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            remaining[indices[i]]++;
+        }
+
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+
+        for (size_t v = 0; v < vertexCount; ++v) {
+            vertexScore[v] = VertexScore(-1, remaining[v]);
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+
+        // LRU cache, with room for the 3 vertices of the triangle that pushes others out
+        std::vector<uint32_t> cache, nextCache;
+        cache.reserve(CACHE_SIZE + 3);
+        nextCache.reserve(CACHE_SIZE + 3);
+
+        size_t scanPosition = 0;
+        auto best = static_cast<size_t>(-1);
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+            if (best == static_cast<size_t>(-1)) {
+                // nothing in the cache has triangles left, take the next one in input order
+                while (emitted[scanPosition]) {
+                    scanPosition++;
+                }
+
+                best = scanPosition;
+            }
+
+            emitted[best] = true;
+
+            nextCache.clear();
+
+            for (size_t j = 0; j < 3; ++j) {
+                auto vertex = indices[best * 3 + j];
+                output.push_back(vertex);
+                nextCache.push_back(vertex);
+
+                // unlink the triangle from its vertices
+                auto begin = adjacency.begin() + offsets[vertex];
+                auto end = begin + remaining[vertex];
+                std::iter_swap(std::find(begin, end, static_cast<uint32_t>(best)), end - 1);
+                remaining[vertex]--;
+            }
+
+            for (auto vertex : cache) {
+                if (vertex != nextCache[0] && vertex != nextCache[1] && vertex != nextCache[2]) {
+                    nextCache.push_back(vertex);
+                }
+            }
+
+            // vertices pushed out of the cache lose their cache bonus
+            for (size_t i = CACHE_SIZE; i < nextCache.size(); ++i) {
+                cachePosition[nextCache[i]] = -1;
+                vertexScore[nextCache[i]] = VertexScore(-1, remaining[nextCache[i]]);
+            }
+
+            nextCache.resize(std::min(nextCache.size(), CACHE_SIZE));
+            std::swap(cache, nextCache);
+
+            for (size_t i = 0; i < cache.size(); ++i) {
+                cachePosition[cache[i]] = static_cast<int>(i);
+                vertexScore[cache[i]] = VertexScore(static_cast<int>(i), remaining[cache[i]]);
+            }
+
+            // only triangles touching the cache changed score, pick the best among them
+            best = static_cast<size_t>(-1);
+            float bestScore = -1.0f;
+
+            for (auto vertex : cache) {
+                for (size_t i = 0; i < remaining[vertex]; ++i) {
+                    auto triangle = adjacency[offsets[vertex] + i];
+
+                    float score = vertexScore[indices[triangle * 3]] +
+                                  vertexScore[indices[triangle * 3 + 1]] +
+                                  vertexScore[indices[triangle * 3 + 2]];
+
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = triangle;
+                    }
+                }
+            }
+        }
+
+        indices = std::move(output);
+    }
+
+    static constexpr size_t OVERDRAW_CACHE_SIZE = 16;
+
+    void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold)
+    {
+        size_t triangleCount = indices.size() / 3;
+
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // hard boundaries are where the cache order already jumps to a disconnected spot (all 3 vertices miss),
+        // soft boundaries get added in between as long as a cluster starting with a cold cache stays within
+        // threshold of the ACMR of the whole mesh
+        auto meshAcmr = AnalyzeVertexCache(indices, positions.size(), OVERDRAW_CACHE_SIZE).acmr;
+
+        std::vector<size_t> clusters;
+        std::vector<size_t> pushedAt(positions.size(), 0);
+        size_t misses = 0, clusterMisses = 0, clusterStart = 0;
+
+        for (size_t t = 0; t < triangleCount; ++t) {
+            bool soft = t - clusterStart >= 8 &&
+                        static_cast<float>(clusterMisses) / (t - clusterStart) <= meshAcmr * threshold;
+
+            if (soft) {
+                // flush the simulated cache, the cluster may end up anywhere after sorting
+                misses += OVERDRAW_CACHE_SIZE;
+            }
+
+            size_t triangleMisses = 0;
+
+            for (size_t j = 0; j < 3; ++j) {
+                auto index = indices[t * 3 + j];
+
+                if (pushedAt[index] == 0 || misses - pushedAt[index] >= OVERDRAW_CACHE_SIZE) {
+                    misses++;
+                    triangleMisses++;
+                    pushedAt[index] = misses;
+                }
+            }
+
+            if (t == 0 || soft || triangleMisses == 3) {
+                clusters.push_back(t);
+                clusterStart = t;
+                clusterMisses = 0;
+            }
+
+            clusterMisses += triangleMisses;
+        }
+
+        clusters.push_back(triangleCount);
+
+        glm::vec3 meshCentroid(0.0f);
+        for (const auto& position : positions) {
+            meshCentroid += position;
+        }
+        meshCentroid /= static_cast<float>(std::max<size_t>(positions.size(), 1));
+
+        // clusters that face away from the center sit on the outside of the mesh, so they are the likely occluders
+        std::vector<float> sortKey(clusters.size() - 1);
+
+        for (size_t c = 0; c + 1 < clusters.size(); ++c) {
+            glm::vec3 centroid(0.0f), normal(0.0f);
+            float area = 0.0f;
+
+            for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+                auto& p0 = positions[indices[t * 3]];
+                auto& p1 = positions[indices[t * 3 + 1]];
+                auto& p2 = positions[indices[t * 3 + 2]];
+
+                // cross product length is twice the area, the factor cancels out in the weighting
+                auto cross = glm::cross(p1 - p0, p2 - p0);
+                auto triangleArea = glm::length(cross);
+
+                centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+                normal += cross;
+                area += triangleArea;
+            }
+
+            if (area > 0.0f) {
+                centroid /= area;
+            }
+
+            auto normalLength = glm::length(normal);
+            sortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+        }
+
+        std::vector<size_t> order(sortKey.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&sortKey](size_t a, size_t b) {
+            return sortKey[a] > sortKey[b];
+        });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        for (auto c : order) {
+            output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+        }
+
+        indices = std::move(output);
+    }
+
+    void OptimizeVertexFetch(MeshData& mesh)
+    {
+        std::vector<uint32_t> remap(mesh.positions.size(), ~0u);
+        uint32_t next = 0;
+
+        for (auto& index : mesh.indices) {
+            if (remap[index] == ~0u) {
+                remap[index] = next++;
+            }
+
+            index = remap[index];
+        }
+
+        auto reorder = [&remap, next](auto& attribute) {
+            if (attribute.empty()) {
+                return;
+            }
+
+            std::remove_reference_t<decltype(attribute)> reordered(next);
+
+            for (size_t i = 0; i < attribute.size(); ++i) {
+                if (remap[i] != ~0u) {
+                    reordered[remap[i]] = attribute[i];
+                }
+            }
+
+            attribute = std::move(reordered);
+        };
+
+        reorder(mesh.positions);
+        reorder(mesh.uvs);
+        reorder(mesh.normals);
+        reorder(mesh.tangents);
+    }
+
+    void Optimize(MeshData& mesh, CacheStats* before, CacheStats* after)
+    {
+        if (before != nullptr) {
+            *before = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+        }
+
+        OptimizeVertexCache(mesh.indices, mesh.positions.size());
+        OptimizeOverdraw(mesh.indices, mesh.positions);
+        OptimizeVertexFetch(mesh);
+
+        if (after != nullptr) {
+            *after = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+        }
+    }
+}
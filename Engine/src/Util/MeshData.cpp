@@ -0,0 +1,91 @@
+#include "Util/MeshData.hpp"
+
+namespace Engine::Util {
+    std::vector<MeshData> SplitMesh(const MeshData& mesh, size_t maxVertices)
+    {
+        if (mesh.positions.size() <= maxVertices) {
+            return {mesh};
+        }
+
+        std::vector<MeshData> chunks;
+
+        // remap[i] is the index of source vertex i in the current chunk, or ~0u if it isn't in it yet
+        std::vector<uint32_t> remap(mesh.positions.size(), ~0u);
+        std::vector<uint32_t> touched;
+
+        auto startChunk = [&] {
+            for (auto vertex : touched) {
+                remap[vertex] = ~0u;
+            }
+
+            touched.clear();
+            chunks.emplace_back();
+        };
+
+        startChunk();
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            size_t missing = 0;
+
+            for (size_t j = 0; j < 3; ++j) {
+                missing += remap[mesh.indices[i + j]] == ~0u;
+            }
+
+            // triangles are never split across chunks, vertices on the seam get duplicated instead
+            if (touched.size() + missing > maxVertices) {
+                startChunk();
+            }
+
+            auto& chunk = chunks.back();
+
+            for (size_t j = 0; j < 3; ++j) {
+                auto vertex = mesh.indices[i + j];
+
+                if (remap[vertex] == ~0u) {
+                    remap[vertex] = static_cast<uint32_t>(chunk.positions.size());
+                    touched.push_back(vertex);
+
+                    chunk.positions.push_back(mesh.positions[vertex]);
+
+                    if (!mesh.uvs.empty()) {
+                        chunk.uvs.push_back(mesh.uvs[vertex]);
+                    }
+
+                    if (!mesh.normals.empty()) {
+                        chunk.normals.push_back(mesh.normals[vertex]);
+                    }
+
+                    if (!mesh.tangents.empty()) {
+                        chunk.tangents.push_back(mesh.tangents[vertex]);
+                    }
+                }
+
+                chunk.indices.push_back(remap[vertex]);
+            }
+        }
+
+        return chunks;
+    }
+
+    MeshData MakeBox(const glm::vec3& min, const glm::vec3& max)
+    {
+        MeshData box;
+
+        // corner i takes x from max when bit 0 is set, y when bit 1 is and z when bit 2 is
+        for (uint32_t i = 0; i < 8; ++i) {
+            box.positions.emplace_back(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+        }
+
+        // counter clockwise seen from outside
+        box.indices = {
+                0, 2, 3,  0, 3, 1, // -z
+                4, 5, 7,  4, 7, 6, // +z
+                0, 1, 5,  0, 5, 4, // -y
+                2, 6, 7,  2, 7, 3, // +y
+                0, 4, 6,  0, 6, 2, // -x
+                1, 3, 7,  1, 7, 5, // +x
+        };
+
+        return box;
+    }
+}
@@ -0,0 +1,135 @@
+#include "Util/Meshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Engine::Util {
+    /// Fills in the bounding sphere (Ritter's algorithm) and normal cone of a meshlet
+    static void ComputeBounds(const MeshData& mesh, Meshlet& meshlet)
+    {
+        auto begin = mesh.indices.begin() + meshlet.firstIndex;
+        auto end = begin + meshlet.indexCount;
+
+        auto farthestFrom = [&](const glm::vec3& point) {
+            glm::vec3 farthest = point;
+            float distance = -1.0f;
+
+            for (auto it = begin; it != end; ++it) {
+                auto& candidate = mesh.positions[*it];
+                auto d = glm::distance(candidate, point);
+
+                if (d > distance) {
+                    distance = d;
+                    farthest = candidate;
+                }
+            }
+
+            return farthest;
+        };
+
+        auto a = farthestFrom(mesh.positions[*begin]);
+        auto b = farthestFrom(a);
+
+        meshlet.center = (a + b) * 0.5f;
+        meshlet.radius = glm::distance(a, b) * 0.5f;
+
+        // grow the sphere until it holds every vertex
+        for (auto it = begin; it != end; ++it) {
+            auto& point = mesh.positions[*it];
+            auto d = glm::distance(point, meshlet.center);
+
+            if (d > meshlet.radius) {
+                float grown = (meshlet.radius + d) * 0.5f;
+                meshlet.center += (point - meshlet.center) * ((grown - meshlet.radius) / d);
+                meshlet.radius = grown;
+            }
+        }
+
+        std::vector<glm::vec3> normals;
+        glm::vec3 axis(0.0f);
+
+        for (auto it = begin; it != end; it += 3) {
+            auto& p0 = mesh.positions[*it];
+            auto& p1 = mesh.positions[*(it + 1)];
+            auto& p2 = mesh.positions[*(it + 2)];
+
+            auto normal = glm::cross(p1 - p0, p2 - p0);
+            auto length = glm::length(normal);
+
+            // degenerate triangles are never visible anyway
+            if (length > 0.0f) {
+                normals.push_back(normal / length);
+                axis += normal / length;
+            }
+        }
+
+        auto axisLength = glm::length(axis);
+        meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+
+        if (normals.empty() || axisLength == 0.0f) {
+            return;
+        }
+
+        float minDot = 1.0f;
+        for (const auto& normal : normals) {
+            minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+        }
+
+        // a cone wider than a hemisphere can't be used for culling
+        if (minDot > 0.0f) {
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    std::vector<Meshlet> BuildMeshlets(const MeshData& mesh, size_t maxVertices, size_t maxTriangles)
+    {
+        std::vector<Meshlet> meshlets;
+
+        // which meshlet last referenced each vertex, so unique vertices can be counted without a set
+        std::vector<size_t> lastUse(mesh.positions.size(), static_cast<size_t>(-1));
+        size_t vertexCount = 0;
+
+        auto finish = [&] {
+            if (!meshlets.empty() && meshlets.back().indexCount > 0) {
+                ComputeBounds(mesh, meshlets.back());
+            }
+        };
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            size_t current = meshlets.size() - 1;
+            size_t missing = 0;
+
+            if (!meshlets.empty()) {
+                for (size_t j = 0; j < 3; ++j) {
+                    missing += lastUse[mesh.indices[i + j]] != current;
+                }
+            }
+
+            if (meshlets.empty() ||
+                vertexCount + missing > maxVertices ||
+                meshlets.back().indexCount / 3 + 1 > maxTriangles) {
+                finish();
+
+                meshlets.push_back({static_cast<uint32_t>(i), 0});
+                current = meshlets.size() - 1;
+                vertexCount = 0;
+            }
+
+            for (size_t j = 0; j < 3; ++j) {
+                auto vertex = mesh.indices[i + j];
+
+                if (lastUse[vertex] != current) {
+                    lastUse[vertex] = current;
+                    vertexCount++;
+                }
+            }
+
+            meshlets.back().indexCount += 3;
+        }
+
+        finish();
+
+        return meshlets;
+    }
+}
@@ -4,6 +4,7 @@
 
 #include "Util/ObjLoader.hpp"
 #include "Util/FS.hpp"
+#include "Util/IndexOptimizer.hpp"
 
 #include "Video/Texture.hpp"
 
@@ -195,11 +196,12 @@ namespace Engine::Util::ObjLoader {
         }
 
         size_t idx = 0;
-        std::vector<glm::vec3> vertices;
-        std::vector<glm::vec3> normals;
-        std::vector<glm::vec2> uvs;
+        MeshData data;
+        auto& vertices = data.positions;
+        auto& normals = data.normals;
+        auto& uvs = data.uvs;
 
-        std::vector<unsigned> indices;
+        auto& indices = data.indices;
 
         auto hasher = [] (const Index& idx) {
             using std::hash;
@@ -234,6 +236,9 @@ namespace Engine::Util::ObjLoader {
             }
         }
 
+        // faces come in file order, which is rarely kind to the post-transform cache
+        IndexOptimizer::Optimize(data);
+
         std::vector<glm::vec3> fakeTangents;
         return Engine::GL::Mesh(vertices, uvs, normals, fakeTangents, indices, diffuse, specular, bump, nullptr);
     }
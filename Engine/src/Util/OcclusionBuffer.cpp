@@ -0,0 +1,309 @@
+/// @file
+/// CPU rasterized depth buffer for occlusion culling
+
+#include "Util/OcclusionBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define ENGINE_OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Engine::Util {
+    /// vertices closer to the eye than this (in clip space w) are treated as crossing the near plane
+    static constexpr float NEAR_W = 1e-4f;
+
+    OcclusionBuffer::OcclusionBuffer(size_t width, size_t height) :
+        m_width((width + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE),
+        m_height((height + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE),
+        m_tilesX(m_width / TILE_SIZE),
+        m_depth(m_width * m_height, 1.0f)
+    {
+        size_t levelWidth = m_tilesX;
+        size_t levelHeight = m_height / TILE_SIZE;
+
+        while (true) {
+            m_levels.push_back({levelWidth, levelHeight,
+                                std::vector<float>(levelWidth * levelHeight, 1.0f),
+                                std::vector<float>(levelWidth * levelHeight, 1.0f)});
+
+            if (levelWidth == 1 && levelHeight == 1) {
+                break;
+            }
+
+            levelWidth = (levelWidth + 1) / 2;
+            levelHeight = (levelHeight + 1) / 2;
+        }
+    }
+
+    void OcclusionBuffer::Clear()
+    {
+        std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+    }
+
+    void OcclusionBuffer::RasterizeOccluder(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const glm::mat4& clip)
+    {
+        m_projected.resize(positions.size());
+
+        for (size_t i = 0; i < positions.size(); ++i) {
+            auto p = clip * glm::vec4(positions[i], 1.0f);
+
+            if (p.w < NEAR_W) {
+                // w = 0 marks the vertex as unusable
+                m_projected[i] = glm::vec4(0.0f);
+                continue;
+            }
+
+            m_projected[i] = glm::vec4(
+                    (p.x / p.w * 0.5f + 0.5f) * m_width,
+                    (p.y / p.w * 0.5f + 0.5f) * m_height,
+                    p.z / p.w * 0.5f + 0.5f,
+                    1.0f
+            );
+        }
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const auto& a = m_projected[indices[i]];
+            const auto& b = m_projected[indices[i + 1]];
+            const auto& c = m_projected[indices[i + 2]];
+
+            if (a.w == 0.0f || b.w == 0.0f || c.w == 0.0f) {
+                continue;
+            }
+
+            RasterizeTriangle(glm::vec3(a), glm::vec3(b), glm::vec3(c));
+        }
+    }
+
+    void OcclusionBuffer::RasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+    {
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+
+        if (std::abs(area) < 1e-6f) {
+            return;
+        }
+
+        // occluders are two sided, flip clockwise triangles so the inside is always positive
+        if (area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        auto minX = std::max(std::floor(std::min({v0.x, v1.x, v2.x})), 0.0f);
+        auto minY = std::max(std::floor(std::min({v0.y, v1.y, v2.y})), 0.0f);
+        auto maxX = std::min(std::ceil(std::max({v0.x, v1.x, v2.x})), m_width - 1.0f);
+        auto maxY = std::min(std::ceil(std::max({v0.y, v1.y, v2.y})), m_height - 1.0f);
+
+        if (minX > maxX || minY > maxY) {
+            return;
+        }
+
+        // edge functions a * x + b * y + c, positive on the inside of each edge
+        struct Edge {
+            float a, b, c;
+        };
+
+        auto edge = [](const glm::vec3& from, const glm::vec3& to) {
+            Edge e{from.y - to.y, to.x - from.x, 0.0f};
+            e.c = -(e.a * from.x + e.b * from.y);
+            return e;
+        };
+
+        Edge e0 = edge(v1, v2), e1 = edge(v2, v0), e2 = edge(v0, v1);
+
+        // depth is linear in screen space, so it's a plane through the three vertices
+        Edge z{
+                (e0.a * v0.z + e1.a * v1.z + e2.a * v2.z) / area,
+                (e0.b * v0.z + e1.b * v1.z + e2.b * v2.z) / area,
+                (e0.c * v0.z + e1.c * v1.z + e2.c * v2.z) / area
+        };
+
+        auto x0 = static_cast<size_t>(minX) & ~size_t(3);
+        auto x1 = static_cast<size_t>(maxX);
+        auto y0 = static_cast<size_t>(minY);
+        auto y1 = static_cast<size_t>(maxY);
+
+#ifdef ENGINE_OCCLUSION_SSE
+        auto offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        auto zero = _mm_setzero_ps();
+
+        for (size_t y = y0; y <= y1; ++y) {
+            float py = y + 0.5f;
+
+            auto r0 = _mm_set1_ps(e0.b * py + e0.c);
+            auto r1 = _mm_set1_ps(e1.b * py + e1.c);
+            auto r2 = _mm_set1_ps(e2.b * py + e2.c);
+            auto rz = _mm_set1_ps(z.b * py + z.c);
+
+            // 4 pixels at a time, groups of 4 never straddle a tile
+            for (size_t x = x0; x <= x1; x += 4) {
+                auto px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+
+                auto w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e0.a), px), r0);
+                auto w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e1.a), px), r1);
+                auto w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e2.a), px), r2);
+
+                auto inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+
+                auto row = Row(x, y);
+                auto depth = _mm_loadu_ps(row);
+                auto pixelZ = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(z.a), px), rz);
+
+                auto write = _mm_and_ps(inside, _mm_cmplt_ps(pixelZ, depth));
+                _mm_storeu_ps(row, _mm_or_ps(_mm_and_ps(write, pixelZ), _mm_andnot_ps(write, depth)));
+            }
+        }
+#else
+        for (size_t y = y0; y <= y1; ++y) {
+            float py = y + 0.5f;
+
+            for (size_t x = x0; x <= x1; x += 4) {
+                auto row = Row(x, y);
+
+                for (size_t i = 0; i < 4; ++i) {
+                    float px = x + i + 0.5f;
+
+                    if (e0.a * px + e0.b * py + e0.c < 0.0f ||
+                        e1.a * px + e1.b * py + e1.c < 0.0f ||
+                        e2.a * px + e2.b * py + e2.c < 0.0f) {
+                        continue;
+                    }
+
+                    row[i] = std::min(row[i], z.a * px + z.b * py + z.c);
+                }
+            }
+        }
+#endif
+    }
+
+    void OcclusionBuffer::BuildHierarchy()
+    {
+        auto& tiles = m_levels[0];
+
+        for (size_t tile = 0; tile < tiles.min.size(); ++tile) {
+            auto begin = m_depth.begin() + tile * TILE_SIZE * TILE_SIZE;
+            auto [min, max] = std::minmax_element(begin, begin + TILE_SIZE * TILE_SIZE);
+
+            tiles.min[tile] = *min;
+            tiles.max[tile] = *max;
+        }
+
+        for (size_t level = 1; level < m_levels.size(); ++level) {
+            const auto& below = m_levels[level - 1];
+            auto& current = m_levels[level];
+
+            for (size_t y = 0; y < current.height; ++y) {
+                for (size_t x = 0; x < current.width; ++x) {
+                    float min = 1.0f, max = 0.0f;
+
+                    // odd sized levels leave the last row or column with missing children
+                    for (size_t cy = y * 2; cy < std::min(y * 2 + 2, below.height); ++cy) {
+                        for (size_t cx = x * 2; cx < std::min(x * 2 + 2, below.width); ++cx) {
+                            min = std::min(min, below.min[cy * below.width + cx]);
+                            max = std::max(max, below.max[cy * below.width + cx]);
+                        }
+                    }
+
+                    current.min[y * current.width + x] = min;
+                    current.max[y * current.width + x] = max;
+                }
+            }
+        }
+    }
+
+    bool OcclusionBuffer::TestNode(size_t level, size_t x, size_t y, const glm::ivec4& rect, float depth) const
+    {
+        const auto& node = m_levels[level];
+
+        if (x >= node.width || y >= node.height) {
+            return false;
+        }
+
+        int size = static_cast<int>(TILE_SIZE << level);
+        int nodeX = static_cast<int>(x) * size, nodeY = static_cast<int>(y) * size;
+
+        if (nodeX > rect.z || nodeY > rect.w || nodeX + size <= rect.x || nodeY + size <= rect.y) {
+            return false;
+        }
+
+        // everything under the node is in front of the box
+        if (node.max[y * node.width + x] < depth) {
+            return false;
+        }
+
+        // nothing under the node is, and the node overlaps the box
+        if (node.min[y * node.width + x] >= depth) {
+            return true;
+        }
+
+        if (level == 0) {
+            for (int py = std::max(nodeY, rect.y); py <= std::min(nodeY + size - 1, rect.w); ++py) {
+                for (int px = std::max(nodeX, rect.x); px <= std::min(nodeX + size - 1, rect.z); ++px) {
+                    if (*Row(px, py) >= depth) {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        return TestNode(level - 1, x * 2, y * 2, rect, depth) ||
+               TestNode(level - 1, x * 2 + 1, y * 2, rect, depth) ||
+               TestNode(level - 1, x * 2, y * 2 + 1, rect, depth) ||
+               TestNode(level - 1, x * 2 + 1, y * 2 + 1, rect, depth);
+    }
+
+    bool OcclusionBuffer::TestAabb(const glm::vec3& min, const glm::vec3& max, const glm::mat4& clip) const
+    {
+        glm::vec2 screenMin(INFINITY), screenMax(-INFINITY);
+        float nearest = INFINITY;
+
+        for (int corner = 0; corner < 8; ++corner) {
+            glm::vec3 position(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+            auto p = clip * glm::vec4(position, 1.0f);
+
+            // the box reaches behind the camera, its screen rectangle is unbounded
+            if (p.w < NEAR_W) {
+                return true;
+            }
+
+            glm::vec2 screen((p.x / p.w * 0.5f + 0.5f) * m_width, (p.y / p.w * 0.5f + 0.5f) * m_height);
+
+            screenMin = glm::min(screenMin, screen);
+            screenMax = glm::max(screenMax, screen);
+            nearest = std::min(nearest, p.z / p.w * 0.5f + 0.5f);
+        }
+
+        // every pixel the box touches, even partially
+        glm::ivec4 rect(
+                static_cast<int>(std::max(std::floor(screenMin.x), 0.0f)),
+                static_cast<int>(std::max(std::floor(screenMin.y), 0.0f)),
+                static_cast<int>(std::min(std::floor(screenMax.x), m_width - 1.0f)),
+                static_cast<int>(std::min(std::floor(screenMax.y), m_height - 1.0f))
+        );
+
+        // off screen, which is for frustum culling to decide
+        if (rect.x > rect.z || rect.y > rect.w) {
+            return true;
+        }
+
+        const auto& top = m_levels.back();
+
+        for (size_t y = 0; y < top.height; ++y) {
+            for (size_t x = 0; x < top.width; ++x) {
+                if (TestNode(m_levels.size() - 1, x, y, rect, nearest)) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+}
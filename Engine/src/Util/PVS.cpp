@@ -0,0 +1,486 @@
+/// @file
+/// Potentially visible set baking and lookup
+
+#include "Util/PVS.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace Engine::Util {
+    namespace {
+        struct Triangle {
+            glm::vec3 v0, e1, e2;
+            uint32_t object;
+        };
+
+        struct BvhNode {
+            glm::vec3 min, max;
+
+            /// first triangle for leaves, right child for inner nodes (the left one follows the node itself)
+            uint32_t index;
+            uint32_t count;
+        };
+
+        /// Bounding volume hierarchy over every triangle in the scene, for the bake's ray casts
+        class Bvh {
+            std::vector<Triangle> m_triangles;
+            std::vector<BvhNode> m_nodes;
+
+            static constexpr size_t LEAF_SIZE = 4;
+
+            uint32_t Build(size_t first, size_t count, std::vector<glm::vec3>& centroids)
+            {
+                auto nodeIndex = static_cast<uint32_t>(m_nodes.size());
+                m_nodes.emplace_back();
+
+                glm::vec3 min(INFINITY), max(-INFINITY), centroidMin(INFINITY), centroidMax(-INFINITY);
+
+                for (size_t i = first; i < first + count; ++i) {
+                    const auto& t = m_triangles[i];
+
+                    for (const auto& v : {t.v0, t.v0 + t.e1, t.v0 + t.e2}) {
+                        min = glm::min(min, v);
+                        max = glm::max(max, v);
+                    }
+
+                    centroidMin = glm::min(centroidMin, centroids[i]);
+                    centroidMax = glm::max(centroidMax, centroids[i]);
+                }
+
+                m_nodes[nodeIndex].min = min;
+                m_nodes[nodeIndex].max = max;
+
+                auto extent = centroidMax - centroidMin;
+                int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+                if (count <= LEAF_SIZE || extent[axis] == 0.0f) {
+                    m_nodes[nodeIndex].index = static_cast<uint32_t>(first);
+                    m_nodes[nodeIndex].count = static_cast<uint32_t>(count);
+                    return nodeIndex;
+                }
+
+                // median split, triangles and their centroids are sorted together through an index permutation
+                std::vector<uint32_t> order(count);
+                std::iota(order.begin(), order.end(), static_cast<uint32_t>(first));
+
+                auto middle = order.begin() + count / 2;
+                std::nth_element(order.begin(), middle, order.end(), [&centroids, axis](uint32_t a, uint32_t b) {
+                    return centroids[a][axis] < centroids[b][axis];
+                });
+
+                std::vector<Triangle> triangles(count);
+                std::vector<glm::vec3> sortedCentroids(count);
+
+                for (size_t i = 0; i < count; ++i) {
+                    triangles[i] = m_triangles[order[i]];
+                    sortedCentroids[i] = centroids[order[i]];
+                }
+
+                std::copy(triangles.begin(), triangles.end(), m_triangles.begin() + first);
+                std::copy(sortedCentroids.begin(), sortedCentroids.end(), centroids.begin() + first);
+
+                Build(first, count / 2, centroids);
+                auto right = Build(first + count / 2, count - count / 2, centroids);
+
+                m_nodes[nodeIndex].index = right;
+                m_nodes[nodeIndex].count = 0;
+
+                return nodeIndex;
+            }
+
+            static bool HitsBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxT)
+            {
+                auto t0 = (node.min - origin) * inverseDirection;
+                auto t1 = (node.max - origin) * inverseDirection;
+
+                auto near = glm::min(t0, t1);
+                auto far = glm::max(t0, t1);
+
+                float enter = std::max({near.x, near.y, near.z, 0.0f});
+                float exit = std::min({far.x, far.y, far.z, maxT});
+
+                return enter <= exit;
+            }
+        public:
+            explicit Bvh(const std::vector<MeshData>& objects)
+            {
+                std::vector<glm::vec3> centroids;
+
+                for (size_t o = 0; o < objects.size(); ++o) {
+                    const auto& mesh = objects[o];
+
+                    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                        const auto& a = mesh.positions[mesh.indices[i]];
+                        const auto& b = mesh.positions[mesh.indices[i + 1]];
+                        const auto& c = mesh.positions[mesh.indices[i + 2]];
+
+                        m_triangles.push_back({a, b - a, c - a, static_cast<uint32_t>(o)});
+                        centroids.push_back((a + b + c) / 3.0f);
+                    }
+                }
+
+                if (!m_triangles.empty()) {
+                    Build(0, m_triangles.size(), centroids);
+                }
+            }
+
+            /// @returns The object the closest hit closer than maxT belongs to, or -1 if nothing was hit
+            uint32_t Cast(const glm::vec3& origin, const glm::vec3& direction, float maxT) const
+            {
+                if (m_nodes.empty()) {
+                    return ~0u;
+                }
+
+                auto inverseDirection = 1.0f / direction;
+                uint32_t hitObject = ~0u;
+
+                uint32_t stack[64];
+                size_t stackSize = 0;
+                stack[stackSize++] = 0;
+
+                while (stackSize > 0) {
+                    auto nodeIndex = stack[--stackSize];
+                    const auto& node = m_nodes[nodeIndex];
+
+                    if (!HitsBox(node, origin, inverseDirection, maxT)) {
+                        continue;
+                    }
+
+                    if (node.count == 0) {
+                        stack[stackSize++] = node.index;
+                        stack[stackSize++] = nodeIndex + 1;
+                        continue;
+                    }
+
+                    // Moller-Trumbore
+                    for (auto i = node.index; i < node.index + node.count; ++i) {
+                        const auto& t = m_triangles[i];
+
+                        auto p = glm::cross(direction, t.e2);
+                        float det = glm::dot(t.e1, p);
+
+                        if (std::abs(det) < 1e-12f) {
+                            continue;
+                        }
+
+                        float invDet = 1.0f / det;
+                        auto s = origin - t.v0;
+                        float u = glm::dot(s, p) * invDet;
+
+                        if (u < 0.0f || u > 1.0f) {
+                            continue;
+                        }
+
+                        auto q = glm::cross(s, t.e1);
+                        float v = glm::dot(direction, q) * invDet;
+
+                        if (v < 0.0f || u + v > 1.0f) {
+                            continue;
+                        }
+
+                        float distance = glm::dot(t.e2, q) * invDet;
+
+                        if (distance > 0.0f && distance < maxT) {
+                            maxT = distance;
+                            hitObject = t.object;
+                        }
+                    }
+                }
+
+                return hitObject;
+            }
+        };
+
+        /// Zero bytes become a zero followed by how many of them there are (up to 255), anything else is copied
+        void Compress(const std::vector<uint8_t>& bits, std::vector<uint8_t>& out)
+        {
+            for (size_t i = 0; i < bits.size();) {
+                if (bits[i] != 0) {
+                    out.push_back(bits[i++]);
+                    continue;
+                }
+
+                uint8_t run = 0;
+
+                while (i < bits.size() && bits[i] == 0 && run < 255) {
+                    run++;
+                    i++;
+                }
+
+                out.push_back(0);
+                out.push_back(run);
+            }
+        }
+    }
+
+    PVS PVS::Bake(const std::vector<MeshData>& objects, const PvsBakeSettings& settings)
+    {
+        PVS pvs;
+        pvs.m_objectCount = objects.size();
+        pvs.m_cellSize = settings.cellSize;
+        pvs.m_everything.assign(objects.size(), true);
+
+        glm::vec3 min(INFINITY), max(-INFINITY);
+
+        for (const auto& mesh : objects) {
+            for (const auto& p : mesh.positions) {
+                min = glm::min(min, p);
+                max = glm::max(max, p);
+            }
+        }
+
+        if (min.x > max.x) {
+            min = max = glm::vec3(0.0f);
+        }
+
+        pvs.m_min = min;
+        pvs.m_cells = glm::uvec3(
+                std::max(1.0f, std::ceil((max.x - min.x) / settings.cellSize)),
+                std::max(1.0f, std::ceil((max.y - min.y) / settings.cellSize)),
+                std::max(1.0f, std::ceil((max.z - min.z) / settings.cellSize))
+        );
+
+        size_t cellCount = static_cast<size_t>(pvs.m_cells.x) * pvs.m_cells.y * pvs.m_cells.z;
+
+        Bvh bvh(objects);
+
+        // cumulative triangle areas, so target points can be picked with a binary search
+        std::vector<std::vector<float>> triangleAreas(objects.size());
+
+        for (size_t o = 0; o < objects.size(); ++o) {
+            const auto& mesh = objects[o];
+            float total = 0.0f;
+
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                const auto& a = mesh.positions[mesh.indices[i]];
+                total += glm::length(glm::cross(mesh.positions[mesh.indices[i + 1]] - a, mesh.positions[mesh.indices[i + 2]] - a));
+                triangleAreas[o].push_back(total);
+            }
+        }
+
+        std::vector<std::vector<uint8_t>> compressed(cellCount);
+        std::atomic<size_t> nextCell{0};
+
+        auto worker = [&] {
+            std::vector<uint8_t> bits((objects.size() + 7) / 8);
+
+            for (size_t cell; (cell = nextCell++) < cellCount;) {
+                std::fill(bits.begin(), bits.end(), 0);
+
+                // same cell, same samples, however the cells end up spread over the threads
+                std::mt19937 rng(static_cast<uint32_t>(cell));
+                std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+                glm::vec3 cellMin = pvs.m_min + settings.cellSize * glm::vec3(
+                        cell % pvs.m_cells.x,
+                        cell / pvs.m_cells.x % pvs.m_cells.y,
+                        cell / (pvs.m_cells.x * pvs.m_cells.y)
+                );
+
+                std::vector<glm::vec3> viewpoints(settings.samplesPerCell);
+
+                for (auto& viewpoint : viewpoints) {
+                    viewpoint = cellMin + settings.cellSize * glm::vec3(unit(rng), unit(rng), unit(rng));
+                }
+
+                for (size_t o = 0; o < objects.size(); ++o) {
+                    const auto& mesh = objects[o];
+                    const auto& areas = triangleAreas[o];
+
+                    if (areas.empty() || areas.back() == 0.0f) {
+                        continue;
+                    }
+
+                    bool visible = false;
+
+                    for (size_t s = 0; s < viewpoints.size() && !visible; ++s) {
+                        for (size_t r = 0; r < settings.raysPerObject && !visible; ++r) {
+                            // a uniformly distributed point on the object's surface
+                            auto triangle = std::lower_bound(areas.begin(), areas.end(), unit(rng) * areas.back()) - areas.begin();
+                            triangle = std::min<ptrdiff_t>(triangle, areas.size() - 1);
+
+                            float u = unit(rng), v = unit(rng);
+                            if (u + v > 1.0f) {
+                                u = 1.0f - u;
+                                v = 1.0f - v;
+                            }
+
+                            const auto& a = mesh.positions[mesh.indices[triangle * 3]];
+                            const auto& b = mesh.positions[mesh.indices[triangle * 3 + 1]];
+                            const auto& c = mesh.positions[mesh.indices[triangle * 3 + 2]];
+                            auto target = a + (b - a) * u + (c - a) * v;
+
+                            auto toTarget = target - viewpoints[s];
+                            float distance = glm::length(toTarget);
+
+                            if (distance < 1e-5f) {
+                                visible = true;
+                                break;
+                            }
+
+                            // stopping just short of the target, so it doesn't hit itself on the way in.
+                            // Hitting any part of the object first means the object is visible anyway
+                            auto hit = bvh.Cast(viewpoints[s], toTarget / distance, distance * 0.999f);
+                            visible = hit == ~0u || hit == o;
+                        }
+                    }
+
+                    if (visible) {
+                        bits[o / 8] |= 1 << (o % 8);
+                    }
+                }
+
+                Compress(bits, compressed[cell]);
+            }
+        };
+
+        size_t threadCount = settings.threads != 0 ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::thread> threads;
+
+        for (size_t i = 0; i < threadCount; ++i) {
+            threads.emplace_back(worker);
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        pvs.m_offsets.push_back(0);
+
+        for (const auto& cell : compressed) {
+            pvs.m_data.insert(pvs.m_data.end(), cell.begin(), cell.end());
+            pvs.m_offsets.push_back(static_cast<uint32_t>(pvs.m_data.size()));
+        }
+
+        return pvs;
+    }
+
+    static constexpr char PVS_MAGIC[4] = {'P', 'V', 'S', '1'};
+
+    void PVS::Save(const char* path) const
+    {
+        std::ofstream stream(path, std::ios::binary);
+
+        if (!stream) {
+            throw std::runtime_error(std::string("couldn't open ") + path + " for writing");
+        }
+
+        uint32_t header[5] = {
+                m_cells.x, m_cells.y, m_cells.z,
+                static_cast<uint32_t>(m_objectCount),
+                static_cast<uint32_t>(m_data.size())
+        };
+
+        stream.write(PVS_MAGIC, sizeof(PVS_MAGIC));
+        stream.write(reinterpret_cast<const char*>(&m_min), sizeof(m_min));
+        stream.write(reinterpret_cast<const char*>(&m_cellSize), sizeof(m_cellSize));
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(m_offsets.data()), m_offsets.size() * sizeof(uint32_t));
+        stream.write(reinterpret_cast<const char*>(m_data.data()), m_data.size());
+
+        if (!stream) {
+            throw std::runtime_error(std::string("couldn't write ") + path);
+        }
+    }
+
+    PVS PVS::Load(const char* path)
+    {
+        std::ifstream stream(path, std::ios::binary);
+
+        char magic[4];
+        uint32_t header[5];
+
+        PVS pvs;
+
+        stream.read(magic, sizeof(magic));
+        stream.read(reinterpret_cast<char*>(&pvs.m_min), sizeof(pvs.m_min));
+        stream.read(reinterpret_cast<char*>(&pvs.m_cellSize), sizeof(pvs.m_cellSize));
+        stream.read(reinterpret_cast<char*>(header), sizeof(header));
+
+        if (!stream || std::memcmp(magic, PVS_MAGIC, sizeof(magic)) != 0) {
+            throw std::runtime_error(std::string(path) + " isn't a baked PVS");
+        }
+
+        pvs.m_cells = glm::uvec3(header[0], header[1], header[2]);
+        pvs.m_objectCount = header[3];
+        pvs.m_everything.assign(pvs.m_objectCount, true);
+
+        pvs.m_offsets.resize(static_cast<size_t>(header[0]) * header[1] * header[2] + 1);
+        pvs.m_data.resize(header[4]);
+
+        stream.read(reinterpret_cast<char*>(pvs.m_offsets.data()), pvs.m_offsets.size() * sizeof(uint32_t));
+        stream.read(reinterpret_cast<char*>(pvs.m_data.data()), pvs.m_data.size());
+
+        if (!stream) {
+            throw std::runtime_error(std::string(path) + " is truncated");
+        }
+
+        // Lookup trusts the offsets to stay inside m_data, so a corrupt file has to stop here
+        for (size_t i = 0; i + 1 < pvs.m_offsets.size(); ++i) {
+            if (pvs.m_offsets[i] > pvs.m_offsets[i + 1]) {
+                throw std::runtime_error(std::string(path) + " has cell offsets out of order");
+            }
+        }
+
+        if (pvs.m_offsets.back() > pvs.m_data.size()) {
+            throw std::runtime_error(std::string(path) + " has cell offsets past the end of its data");
+        }
+
+        return pvs;
+    }
+
+    size_t PVS::GetCell(const glm::vec3& position) const
+    {
+        auto cell = glm::floor((position - m_min) / m_cellSize);
+
+        if (cell.x < 0.0f || cell.y < 0.0f || cell.z < 0.0f ||
+            cell.x >= m_cells.x || cell.y >= m_cells.y || cell.z >= m_cells.z) {
+            return static_cast<size_t>(-1);
+        }
+
+        return (static_cast<size_t>(cell.z) * m_cells.y + static_cast<size_t>(cell.y)) * m_cells.x + static_cast<size_t>(cell.x);
+    }
+
+    const std::vector<bool>& PVS::Lookup(const glm::vec3& position)
+    {
+        auto cell = GetCell(position);
+
+        if (cell == static_cast<size_t>(-1)) {
+            return m_everything;
+        }
+
+        if (cell == m_visibleCell) {
+            return m_visible;
+        }
+
+        m_visible.assign(m_objectCount, false);
+        size_t object = 0;
+
+        for (auto i = m_offsets[cell]; i < m_offsets[cell + 1] && object < m_objectCount; ++i) {
+            if (m_data[i] == 0) {
+                // a run with its count cut off by the cell's end marks nothing more as visible
+                if (i + 1 >= m_offsets[cell + 1]) {
+                    break;
+                }
+
+                object += m_data[++i] * 8;
+                continue;
+            }
+
+            for (size_t bit = 0; bit < 8 && object < m_objectCount; ++bit, ++object) {
+                m_visible[object] = (m_data[i] >> bit) & 1;
+            }
+        }
+
+        m_visibleCell = cell;
+
+        return m_visible;
+    }
+}
@@ -0,0 +1,330 @@
+/// @file
+/// Quadric error metric mesh simplification, used to build LOD chains at load time
+
+#include "Util/Simplifier.hpp"
+#include "Util/IndexOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Engine::Util {
+    namespace {
+        /// Symmetric 4x4 matrix measuring the summed squared distance from a point to a set of planes
+        struct Quadric {
+            double a2 = 0, ab = 0, ac = 0, ad = 0;
+            double b2 = 0, bc = 0, bd = 0;
+            double c2 = 0, cd = 0;
+            double d2 = 0;
+
+            static Quadric FromPlane(const glm::vec3& n, float d)
+            {
+                Quadric q;
+                q.a2 = n.x * n.x; q.ab = n.x * n.y; q.ac = n.x * n.z; q.ad = n.x * d;
+                q.b2 = n.y * n.y; q.bc = n.y * n.z; q.bd = n.y * d;
+                q.c2 = n.z * n.z; q.cd = n.z * d;
+                q.d2 = d * d;
+
+                return q;
+            }
+
+            Quadric& operator +=(const Quadric& rhs)
+            {
+                a2 += rhs.a2; ab += rhs.ab; ac += rhs.ac; ad += rhs.ad;
+                b2 += rhs.b2; bc += rhs.bc; bd += rhs.bd;
+                c2 += rhs.c2; cd += rhs.cd;
+                d2 += rhs.d2;
+
+                return *this;
+            }
+
+            double Evaluate(const glm::vec3& p) const
+            {
+                double x = p.x, y = p.y, z = p.z;
+
+                return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                       + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                       + c2 * z * z + 2 * cd * z
+                       + d2;
+            }
+        };
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+    }
+
+    /// Maps every vertex to the lowest index vertex sharing its position
+    static std::vector<uint32_t> PositionRemap(const std::vector<glm::vec3>& positions)
+    {
+        std::vector<uint32_t> order(positions.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        auto less = [&positions](uint32_t a, uint32_t b) {
+            const auto& pa = positions[a];
+            const auto& pb = positions[b];
+
+            if (pa.x != pb.x) return pa.x < pb.x;
+            if (pa.y != pb.y) return pa.y < pb.y;
+            if (pa.z != pb.z) return pa.z < pb.z;
+            return a < b;
+        };
+
+        std::sort(order.begin(), order.end(), less);
+
+        std::vector<uint32_t> remap(positions.size());
+
+        for (size_t i = 0; i < order.size(); ++i) {
+            bool same = i > 0 && positions[order[i]] == positions[order[i - 1]];
+            remap[order[i]] = same ? remap[order[i - 1]] : order[i];
+        }
+
+        return remap;
+    }
+
+    std::vector<uint32_t> Simplify(const MeshData& mesh, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error)
+    {
+        const auto& positions = mesh.positions;
+        size_t vertexCount = positions.size();
+
+        error = 0.0f;
+
+        auto remap = PositionRemap(positions);
+
+        // a position is locked if it has more than one vertex (a uv or normal seam runs through it),
+        // or if any of its edges isn't shared by exactly two triangles (open border or non-manifold)
+        std::vector<bool> locked(vertexCount, false);
+        std::vector<uint32_t> referencedWedge(vertexCount, ~0u);
+
+        for (auto index : indices) {
+            auto& wedge = referencedWedge[remap[index]];
+
+            if (wedge != ~0u && wedge != index) {
+                locked[remap[index]] = true;
+            }
+
+            wedge = index;
+        }
+
+        std::vector<uint64_t> edges;
+        edges.reserve(indices.size());
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            for (size_t j = 0; j < 3; ++j) {
+                uint64_t a = remap[indices[i + j]];
+                uint64_t b = remap[indices[i + (j + 1) % 3]];
+
+                edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i]) {
+                j++;
+            }
+
+            if (j - i != 2) {
+                locked[edges[i] >> 32] = true;
+                locked[edges[i] & 0xffffffffu] = true;
+            }
+
+            i = j;
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const auto& p0 = positions[indices[i]];
+            const auto& p1 = positions[indices[i + 1]];
+            const auto& p2 = positions[indices[i + 2]];
+
+            auto normal = glm::cross(p1 - p0, p2 - p0);
+            auto length = glm::length(normal);
+
+            if (length == 0.0f) {
+                continue;
+            }
+
+            normal /= length;
+            auto plane = Quadric::FromPlane(normal, -glm::dot(normal, p0));
+
+            for (size_t j = 0; j < 3; ++j) {
+                quadrics[remap[indices[i + j]]] += plane;
+            }
+        }
+
+        std::vector<uint32_t> result = indices;
+        std::vector<uint32_t> collapseTo(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::vector<uint32_t> offsets(vertexCount + 1), adjacency;
+        std::vector<Collapse> candidates;
+
+        auto hasNormals = mesh.normals.size() == vertexCount;
+
+        // collapses are done in passes: rank every edge, apply the cheapest ones that don't touch each other, repeat
+        while (result.size() > targetIndexCount) {
+            std::fill(offsets.begin(), offsets.end(), 0);
+
+            for (auto index : result) {
+                offsets[index + 1]++;
+            }
+
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            adjacency.resize(result.size());
+            std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+
+            for (size_t i = 0; i < result.size(); ++i) {
+                adjacency[filled[result[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+
+            candidates.clear();
+
+            for (size_t i = 0; i + 2 < result.size(); i += 3) {
+                for (size_t j = 0; j < 3; ++j) {
+                    for (size_t k = 1; k < 3; ++k) {
+                        auto from = result[i + j];
+                        auto to = result[i + (j + k) % 3];
+
+                        if (locked[remap[from]] || remap[from] == remap[to]) {
+                            continue;
+                        }
+
+                        auto merged = quadrics[remap[from]];
+                        merged += quadrics[remap[to]];
+
+                        double cost = std::max(merged.Evaluate(positions[to]), 0.0);
+
+                        // folding together vertices whose normals disagree smears the shading, charge for it
+                        // in distance units so it weighs against the geometric error
+                        if (hasNormals) {
+                            auto length2 = glm::dot(positions[to] - positions[from], positions[to] - positions[from]);
+                            cost += (1.0 - glm::dot(mesh.normals[from], mesh.normals[to])) * length2;
+                        }
+
+                        candidates.push_back({from, to, cost});
+                    }
+                }
+            }
+
+            std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) {
+                return a.cost < b.cost;
+            });
+
+            std::iota(collapseTo.begin(), collapseTo.end(), 0);
+            std::fill(touched.begin(), touched.end(), false);
+
+            size_t triangles = result.size() / 3;
+            size_t collapses = 0;
+
+            for (const auto& candidate : candidates) {
+                if (triangles * 3 <= targetIndexCount) {
+                    break;
+                }
+
+                if (touched[remap[candidate.from]] || touched[remap[candidate.to]]) {
+                    continue;
+                }
+
+                // reject collapses that would flip any of the triangles that survive them
+                bool flips = false;
+                size_t removed = 0;
+
+                for (auto t = offsets[candidate.from]; t < offsets[candidate.from + 1] && !flips; ++t) {
+                    auto triangle = &result[adjacency[t] * 3];
+
+                    if (remap[triangle[0]] == remap[candidate.to] ||
+                        remap[triangle[1]] == remap[candidate.to] ||
+                        remap[triangle[2]] == remap[candidate.to]) {
+                        removed++;
+                        continue;
+                    }
+
+                    glm::vec3 before[3], after[3];
+
+                    for (size_t j = 0; j < 3; ++j) {
+                        before[j] = positions[triangle[j]];
+                        after[j] = triangle[j] == candidate.from ? positions[candidate.to] : before[j];
+                    }
+
+                    auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+                    flips = glm::dot(n0, n1) <= 0.0f;
+                }
+
+                if (flips) {
+                    continue;
+                }
+
+                collapseTo[candidate.from] = candidate.to;
+                quadrics[remap[candidate.to]] += quadrics[remap[candidate.from]];
+                error = std::max(error, static_cast<float>(std::sqrt(candidate.cost)));
+
+                // the one-ring changed shape, so anything that ranked it is stale until the next pass
+                for (auto t = offsets[candidate.from]; t < offsets[candidate.from + 1]; ++t) {
+                    for (size_t j = 0; j < 3; ++j) {
+                        touched[remap[result[adjacency[t] * 3 + j]]] = true;
+                    }
+                }
+
+                triangles -= removed;
+                collapses++;
+            }
+
+            if (collapses == 0) {
+                break;
+            }
+
+            size_t write = 0;
+
+            for (size_t i = 0; i + 2 < result.size(); i += 3) {
+                auto a = collapseTo[result[i]], b = collapseTo[result[i + 1]], c = collapseTo[result[i + 2]];
+
+                if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) {
+                    continue;
+                }
+
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+
+            result.resize(write);
+        }
+
+        return result;
+    }
+
+    std::vector<LodLevel> BuildLodChain(const MeshData& mesh, size_t levels)
+    {
+        std::vector<LodLevel> chain;
+        chain.push_back({mesh.indices, 0.0f});
+
+        for (size_t i = 1; i < levels; ++i) {
+            const auto& previous = chain.back();
+
+            auto target = previous.indices.size() / 6 * 3;
+            float error;
+
+            auto indices = Simplify(mesh, previous.indices, target, error);
+
+            // locked borders and seams can stall the simplifier, a level that barely shrank isn't worth keeping
+            if (indices.size() > previous.indices.size() * 3 / 4) {
+                break;
+            }
+
+            IndexOptimizer::OptimizeVertexCache(indices, mesh.positions.size());
+
+            // each level is simplified from the previous one, so the errors stack up
+            chain.push_back({std::move(indices), previous.error + error});
+        }
+
+        return chain;
+    }
+}
@@ -0,0 +1,123 @@
+#include "Video/Bloom.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+namespace Engine::GL {
+    Bloom::Bloom()
+    {
+        m_brightProgram.AttachShader("GLSL/deferred_fullscreen.vert", ShaderType::Vertex);
+        m_brightProgram.AttachShader("GLSL/bloom_bright.frag", ShaderType::Fragment);
+
+        m_blurProgram.AttachShader("GLSL/deferred_fullscreen.vert", ShaderType::Vertex);
+        m_blurProgram.AttachShader("GLSL/bloom_blur.frag", ShaderType::Fragment);
+
+        m_compositeProgram.AttachShader("GLSL/deferred_fullscreen.vert", ShaderType::Vertex);
+        m_compositeProgram.AttachShader("GLSL/bloom_composite.frag", ShaderType::Fragment);
+
+        Program::LinkAll({&m_brightProgram, &m_blurProgram, &m_compositeProgram});
+
+        glGenVertexArrays(1, &m_emptyVao);
+
+        GLint alphaSize = 0;
+        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_BACK_LEFT, GL_FRAMEBUFFER_ATTACHMENT_ALPHA_SIZE, &alphaSize);
+
+        m_sceneFormat = alphaSize > 0 ? GL_RGBA8 : GL_RGB8;
+    }
+
+    Bloom::~Bloom()
+    {
+        StateCache::DeleteVertexArrays(1, &m_emptyVao);
+    }
+
+    RenderResource Bloom::AddPasses(RenderGraph& graph, RenderResource backbuffer, int width, int height)
+    {
+        RenderTextureDesc half{GL_RGBA16F, std::max(width / 2, 1), std::max(height / 2, 1)};
+
+        auto scene = graph.CreateTexture("bloom scene", {m_sceneFormat, width, height});
+        auto bright = graph.CreateTexture("bloom bright", half);
+        auto blurred = graph.CreateTexture("bloom blur horizontal", half);
+        auto bloom = graph.CreateTexture("bloom blur vertical", half);
+
+        auto blur = [this](const RenderGraph& graph, RenderResource source, glm::vec2 direction) {
+            StateCache::BindTexture(0, graph.GetTexture(source));
+
+            m_blurProgram.Use();
+            m_blurProgram.SetUniform("sourceMap", 0);
+            m_blurProgram.SetUniform("direction", direction);
+
+            StateCache::BindVertexArray(m_emptyVao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        };
+
+        graph.AddPass("bloom resolve", [&](RenderPassBuilder& pass) {
+            pass.Read(backbuffer);
+            pass.Write(scene);
+        }, [width, height](const RenderGraph&) {
+            // resolves the samples too, the draw framebuffer is the scene texture's
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        });
+
+        graph.AddPass("bloom bright", [&](RenderPassBuilder& pass) {
+            pass.Read(scene);
+            pass.Write(bright);
+        }, [this, scene](const RenderGraph& graph) {
+            // the depth test can stay on, the graph's framebuffers here have no depth attachment to fail it
+            StateCache::BindTexture(0, graph.GetTexture(scene));
+
+            m_brightProgram.Use();
+            m_brightProgram.SetUniform("sceneMap", 0);
+            m_brightProgram.SetUniform("threshold", m_threshold);
+
+            StateCache::BindVertexArray(m_emptyVao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        });
+
+        graph.AddPass("bloom blur horizontal", [&](RenderPassBuilder& pass) {
+            pass.Read(bright);
+            pass.Write(blurred);
+        }, [blur, bright, half](const RenderGraph& graph) {
+            blur(graph, bright, {1.0f / half.width, 0.0f});
+        });
+
+        graph.AddPass("bloom blur vertical", [&](RenderPassBuilder& pass) {
+            pass.Read(blurred);
+            pass.Write(bloom);
+        }, [blur, blurred, half](const RenderGraph& graph) {
+            blur(graph, blurred, {0.0f, 1.0f / half.height});
+        });
+
+        return bloom;
+    }
+
+    void Bloom::AddComposite(RenderGraph& graph, RenderResource bloom, RenderResource backbuffer)
+    {
+        graph.AddPass("bloom composite", [&](RenderPassBuilder& pass) {
+            pass.Read(bloom);
+            pass.Write(backbuffer);
+        }, [this, bloom](const RenderGraph& graph) {
+            GLint viewport[4];
+            glGetIntegerv(GL_VIEWPORT, viewport);
+
+            StateCache::Disable(GL_DEPTH_TEST);
+            StateCache::Enable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+
+            StateCache::BindTexture(0, graph.GetTexture(bloom));
+
+            m_compositeProgram.Use();
+            m_compositeProgram.SetUniform("bloomMap", 0);
+            m_compositeProgram.SetUniform("intensity", m_intensity);
+            m_compositeProgram.SetUniform("viewport", glm::vec4(viewport[0], viewport[1], viewport[2], viewport[3]));
+
+            StateCache::BindVertexArray(m_emptyVao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            StateCache::Disable(GL_BLEND);
+            StateCache::Enable(GL_DEPTH_TEST);
+        });
+    }
+}
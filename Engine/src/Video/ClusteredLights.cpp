@@ -0,0 +1,111 @@
+#include "Video/ClusteredLights.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace Engine::GL {
+    static void CreateBufferTexture(GLuint& buffer, GLuint& texture, GLenum internalFormat)
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+
+        StateCache::BindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+        StateCache::BindTexture(0, texture, GL_TEXTURE_BUFFER);
+        glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+    }
+
+    /// Orphans the buffer and fills it, never leaving it empty, a buffer texture over no storage is incomplete.
+    /// The texture keeps pointing at the buffer through the reallocation
+    static void Upload(GLuint buffer, const void* data, size_t size)
+    {
+        StateCache::BindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(std::max<size_t>(size, 16)), nullptr, GL_STREAM_DRAW);
+
+        if (size > 0) {
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+        }
+    }
+
+    ClusteredLights::ClusteredLights(glm::uvec3 dimensions, size_t threads) : m_builder(dimensions, threads)
+    {
+        CreateBufferTexture(m_lightsBuffer, m_lightsTexture, GL_RGBA32F);
+        CreateBufferTexture(m_rangesBuffer, m_rangesTexture, GL_RG32UI);
+        CreateBufferTexture(m_indicesBuffer, m_indicesTexture, GL_R16UI);
+    }
+
+    ClusteredLights::~ClusteredLights()
+    {
+        StateCache::DeleteTextures(1, &m_lightsTexture);
+        StateCache::DeleteTextures(1, &m_rangesTexture);
+        StateCache::DeleteTextures(1, &m_indicesTexture);
+        StateCache::DeleteBuffers(1, &m_lightsBuffer);
+        StateCache::DeleteBuffers(1, &m_rangesBuffer);
+        StateCache::DeleteBuffers(1, &m_indicesBuffer);
+    }
+
+    void ClusteredLights::SetProjection(const glm::mat4& projection, float near, float far)
+    {
+        m_builder.SetProjection(projection, near, far);
+        m_near = near;
+        m_far = far;
+    }
+
+    void ClusteredLights::Update(const std::vector<PointLight>& points, const std::vector<SpotLight>& spots,
+                                 const glm::mat4& view)
+    {
+        m_clusterLights.clear();
+        m_texels.clear();
+
+        for (const auto& light : points) {
+            m_clusterLights.push_back({light.position, light.radius, glm::vec3(0.0f), -1.0f});
+            m_texels.emplace_back(light.position, light.radius);
+            m_texels.emplace_back(light.color, 0.0f);
+            m_texels.emplace_back(0.0f, 0.0f, 0.0f, -1.0f);
+        }
+
+        for (const auto& light : spots) {
+            m_clusterLights.push_back({light.position, light.radius, light.direction, light.cosAngle});
+            m_texels.emplace_back(light.position, light.radius);
+            m_texels.emplace_back(light.color, 0.0f);
+            m_texels.emplace_back(light.direction, light.cosAngle);
+        }
+
+        m_builder.Build(m_clusterLights, view);
+        m_count = m_clusterLights.size();
+
+        const auto& ranges = m_builder.GetRanges();
+        const auto& indices = m_builder.GetIndices();
+
+        Upload(m_lightsBuffer, m_texels.data(), m_texels.size() * sizeof(glm::vec4));
+        Upload(m_rangesBuffer, ranges.data(), ranges.size() * sizeof(uint32_t));
+        Upload(m_indicesBuffer, indices.data(), indices.size() * sizeof(uint16_t));
+    }
+
+    void ClusteredLights::Apply(Program& program) const
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        const auto& dimensions = m_builder.GetDimensions();
+
+        // slice = log(depth) * scale + bias, the inverse of near * (far / near)^(slice / slices)
+        auto depthScale = static_cast<float>(dimensions.z) / std::log(m_far / m_near);
+        auto depthBias = -std::log(m_near) * depthScale;
+
+        StateCache::BindTexture(FIRST_UNIT, m_lightsTexture, GL_TEXTURE_BUFFER);
+        StateCache::BindTexture(FIRST_UNIT + 1, m_rangesTexture, GL_TEXTURE_BUFFER);
+        StateCache::BindTexture(FIRST_UNIT + 2, m_indicesTexture, GL_TEXTURE_BUFFER);
+
+        program.Use();
+        program.SetUniform("clusterLights", static_cast<int>(FIRST_UNIT));
+        program.SetUniform("clusterRanges", static_cast<int>(FIRST_UNIT + 1));
+        program.SetUniform("clusterIndices", static_cast<int>(FIRST_UNIT + 2));
+        program.SetUniform("clusterGrid", glm::vec4(dimensions.x, dimensions.y, dimensions.z, 0.0f));
+        program.SetUniform("clusterDepth", glm::vec2(depthScale, depthBias));
+        program.SetUniform("screenSize", glm::vec2(viewport[2], viewport[3]));
+    }
+}
@@ -0,0 +1,219 @@
+#include "Video/DeferredRenderer.hpp"
+#include "Video/StateCache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace Engine::GL {
+    static GLuint CreateTarget(GLenum internalFormat, GLenum format, GLenum type, int width, int height)
+    {
+        GLuint texture;
+
+        glGenTextures(1, &texture);
+        StateCache::BindTexture(0, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        return texture;
+    }
+
+    DeferredRenderer::DeferredRenderer()
+    {
+        m_ambientProgram.AttachShader("GLSL/deferred_fullscreen.vert", ShaderType::Vertex);
+        m_ambientProgram.AttachShader("GLSL/deferred_ambient.frag", ShaderType::Fragment);
+
+        m_lightProgram.AttachShader("GLSL/deferred_light.vert", ShaderType::Vertex);
+        m_lightProgram.AttachShader("GLSL/deferred_light.frag", ShaderType::Fragment);
+
+        m_compositeProgram.AttachShader("GLSL/deferred_fullscreen.vert", ShaderType::Vertex);
+        m_compositeProgram.AttachShader("GLSL/deferred_composite.frag", ShaderType::Fragment);
+
+        Program::LinkAll({&m_ambientProgram, &m_lightProgram, &m_compositeProgram});
+
+        glGenFramebuffers(1, &m_gbuffer);
+        glGenFramebuffers(1, &m_lightFramebuffer);
+        glGenVertexArrays(1, &m_emptyVao);
+
+        static const float corners[] = {
+                -1, -1, -1,   1, -1, -1,  -1,  1, -1,   1,  1, -1,
+                -1, -1,  1,   1, -1,  1,  -1,  1,  1,   1,  1,  1,
+        };
+
+        // counter clockwise seen from outside, the lighting pass culls the front faces
+        static const uint8_t faces[] = {
+                0, 2, 3,  0, 3, 1, // -z
+                4, 5, 7,  4, 7, 6, // +z
+                0, 1, 5,  0, 5, 4, // -y
+                2, 6, 7,  2, 7, 3, // +y
+                0, 4, 6,  0, 6, 2, // -x
+                1, 3, 7,  1, 7, 5, // +x
+        };
+
+        glGenVertexArrays(1, &m_volumeVao);
+        glGenBuffers(1, &m_volumeVbo);
+        glGenBuffers(1, &m_volumeEbo);
+
+        StateCache::BindVertexArray(m_volumeVao);
+
+        StateCache::BindBuffer(GL_ARRAY_BUFFER, m_volumeVbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_volumeEbo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+
+        // pointed at a LightBuffer by Resolve
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(1, 1);
+        glVertexAttribDivisor(2, 1);
+
+        StateCache::BindVertexArray(0);
+    }
+
+    DeferredRenderer::~DeferredRenderer()
+    {
+        glDeleteFramebuffers(1, &m_gbuffer);
+        glDeleteFramebuffers(1, &m_lightFramebuffer);
+        StateCache::DeleteTextures(1, &m_albedoSpec);
+        StateCache::DeleteTextures(1, &m_octNormal);
+        StateCache::DeleteTextures(1, &m_depth);
+        StateCache::DeleteTextures(1, &m_light);
+        StateCache::DeleteVertexArrays(1, &m_emptyVao);
+        StateCache::DeleteVertexArrays(1, &m_volumeVao);
+        StateCache::DeleteBuffers(1, &m_volumeVbo);
+        StateCache::DeleteBuffers(1, &m_volumeEbo);
+    }
+
+    void DeferredRenderer::Resize(int width, int height)
+    {
+        StateCache::DeleteTextures(1, &m_albedoSpec);
+        StateCache::DeleteTextures(1, &m_octNormal);
+        StateCache::DeleteTextures(1, &m_depth);
+        StateCache::DeleteTextures(1, &m_light);
+
+        m_width = width;
+        m_height = height;
+
+        // 12 bytes a pixel before lighting: specular intensity only gets a channel, the exponent is the same
+        // everywhere, and the normal takes two halves instead of three floats
+        m_albedoSpec = CreateTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+        m_octNormal = CreateTarget(GL_RG16F, GL_RG, GL_HALF_FLOAT, width, height);
+        m_depth = CreateTarget(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, width, height);
+        m_light = CreateTarget(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, width, height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_gbuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedoSpec, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_octNormal, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+
+        static const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, drawBuffers);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("G-buffer incomplete");
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_lightFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_light, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("light accumulation buffer incomplete");
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void DeferredRenderer::BeginGeometry()
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        if (viewport[2] != m_width || viewport[3] != m_height) {
+            Resize(viewport[2], viewport[3]);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_gbuffer);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    void DeferredRenderer::Resolve(const LightBuffer& lights, const glm::mat4& invProjectionView)
+    {
+        auto screenSize = glm::vec2(m_width, m_height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_lightFramebuffer);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        StateCache::Disable(GL_DEPTH_TEST);
+        StateCache::Enable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        StateCache::BindTexture(0, m_albedoSpec);
+        StateCache::BindTexture(1, m_octNormal);
+        StateCache::BindTexture(2, m_depth);
+
+        m_ambientProgram.Use();
+        m_ambientProgram.SetUniform("albedoSpecMap", 0);
+        m_ambientProgram.SetUniform("octNormalMap", 1);
+        m_ambientProgram.SetUniform("depthMap", 2);
+        m_ambientProgram.SetUniform("invProjectionView", invProjectionView);
+        m_ambientProgram.SetUniform("screenSize", screenSize);
+
+        StateCache::BindVertexArray(m_emptyVao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        if (lights.GetCount() > 0) {
+            m_lightProgram.Use();
+            m_lightProgram.SetUniform("albedoSpecMap", 0);
+            m_lightProgram.SetUniform("octNormalMap", 1);
+            m_lightProgram.SetUniform("depthMap", 2);
+            m_lightProgram.SetUniform("invProjectionView", invProjectionView);
+            m_lightProgram.SetUniform("screenSize", screenSize);
+
+            StateCache::BindVertexArray(m_volumeVao);
+
+            if (m_volumeLights != lights.GetBuffer()) {
+                m_volumeLights = lights.GetBuffer();
+
+                StateCache::BindBuffer(GL_ARRAY_BUFFER, m_volumeLights);
+                glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PointLight),
+                                      reinterpret_cast<const GLvoid*>(LightBuffer::LIGHTS_OFFSET));
+                glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(PointLight),
+                                      reinterpret_cast<const GLvoid*>(LightBuffer::LIGHTS_OFFSET + offsetof(PointLight, color)));
+            }
+
+            // back faces, so the box still gets drawn from inside it, where its front faces are behind the camera
+            StateCache::Enable(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+
+            glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, nullptr, static_cast<GLsizei>(lights.GetCount()));
+
+            glCullFace(GL_BACK);
+            StateCache::Disable(GL_CULL_FACE);
+        }
+
+        StateCache::Disable(GL_BLEND);
+
+        // the depth test has to be on for gl_FragDepth to get written, it just can't throw anything out
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        StateCache::Enable(GL_DEPTH_TEST);
+        glDepthFunc(GL_ALWAYS);
+
+        StateCache::BindTexture(0, m_light);
+        StateCache::BindTexture(1, m_depth);
+
+        m_compositeProgram.Use();
+        m_compositeProgram.SetUniform("lightMap", 0);
+        m_compositeProgram.SetUniform("depthMap", 1);
+
+        StateCache::BindVertexArray(m_emptyVao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glDepthFunc(GL_LESS);
+    }
+}
@@ -0,0 +1,108 @@
+#include "Video/DepthPyramid.hpp"
+#include "Video/GLExt.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+
+namespace Engine::GL {
+    DepthPyramid::DepthPyramid()
+    {
+        m_program.AttachShader("GLSL/depth_pyramid.comp", ShaderType::Compute);
+        m_program.Link();
+
+        glGenFramebuffers(1, &m_framebuffer);
+    }
+
+    DepthPyramid::~DepthPyramid()
+    {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        StateCache::DeleteTextures(1, &m_depthTexture);
+        StateCache::DeleteTextures(1, &m_pyramid);
+    }
+
+    void DepthPyramid::Resize(int width, int height)
+    {
+        StateCache::DeleteTextures(1, &m_depthTexture);
+        StateCache::DeleteTextures(1, &m_pyramid);
+
+        m_width = width;
+        m_height = height;
+
+        glGenTextures(1, &m_depthTexture);
+        StateCache::BindTexture(0, m_depthTexture);
+        // depth blits need matching formats, this is the one Window asks for
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenTextures(1, &m_pyramid);
+        StateCache::BindTexture(0, m_pyramid);
+
+        m_levels = 0;
+
+        for (int w = width, h = height; ; w = std::max(w / 2, 1), h = std::max(h / 2, 1)) {
+            glTexImage2D(GL_TEXTURE_2D, m_levels++, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, nullptr);
+
+            if (w == 1 && h == 1) {
+                break;
+            }
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    void DepthPyramid::Build()
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        if (viewport[2] != m_width || viewport[3] != m_height) {
+            Resize(viewport[2], viewport[3]);
+        }
+
+        // resolves the samples too, when the window is multisampled
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+        glBlitFramebuffer(
+                viewport[0], viewport[1], viewport[0] + m_width, viewport[1] + m_height,
+                0, 0, m_width, m_height,
+                GL_DEPTH_BUFFER_BIT, GL_NEAREST
+        );
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        m_program.Use();
+        m_program.SetUniform("source", 0);
+
+        int w = m_width, h = m_height;
+
+        for (int level = 0; level < m_levels; ++level) {
+            // level 0 copies the depth texture, the rest reduce the level above them
+            if (level == 0) {
+                StateCache::BindTexture(0, m_depthTexture);
+                m_program.SetUniform("sourceLevel", 0);
+            } else {
+                StateCache::BindTexture(0, m_pyramid);
+                m_program.SetUniform("sourceLevel", level - 1);
+            }
+
+            Ext::BindImageTexture(0, m_pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+            m_program.SetUniform("copy", level == 0 ? 1 : 0);
+            m_program.Dispatch((w + 7) / 8, (h + 7) / 8);
+
+            // the next level reads this one through the sampler
+            Ext::MemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+            w = std::max(w / 2, 1);
+            h = std::max(h / 2, 1);
+        }
+    }
+}
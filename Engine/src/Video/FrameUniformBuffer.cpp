@@ -0,0 +1,24 @@
+#include "Video/FrameUniformBuffer.hpp"
+#include "Video/StateCache.hpp"
+
+namespace Engine::GL {
+    static_assert(sizeof(FrameData) == 176, "FrameData has to match the std140 layout of the block");
+
+    FrameUniformBuffer::FrameUniformBuffer()
+    {
+        glGenBuffers(1, &m_buffer);
+    }
+
+    FrameUniformBuffer::~FrameUniformBuffer()
+    {
+        StateCache::DeleteBuffers(1, &m_buffer);
+    }
+
+    void FrameUniformBuffer::Update(const FrameData& data)
+    {
+        // respecifying the whole buffer orphans last frame's storage instead of waiting for the GPU to finish with it
+        StateCache::BindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &data, GL_STREAM_DRAW);
+        StateCache::BindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_buffer);
+    }
+}
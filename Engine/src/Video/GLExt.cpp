@@ -0,0 +1,78 @@
+#include "Video/GLExt.hpp"
+
+#include <cstring>
+
+namespace Engine::GL::Ext {
+    PFNMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = nullptr;
+    PFNDRAWELEMENTSINDIRECTPROC DrawElementsIndirect = nullptr;
+    PFNDISPATCHCOMPUTEPROC DispatchCompute = nullptr;
+    PFNMEMORYBARRIERPROC MemoryBarrier = nullptr;
+    PFNBINDIMAGETEXTUREPROC BindImageTexture = nullptr;
+    PFNGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+    PFNPROGRAMBINARYPROC ProgramBinary = nullptr;
+    PFNPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+    PFNMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads = nullptr;
+
+    static int __version = 0;
+
+    void Load(void* (*getProcAddress)(const char*))
+    {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+        __version = major * 10 + minor;
+
+        // drivers happily hand out pointers for functions the context can't call, so only take them when it can
+        if (__version >= 40 || HasExtension("GL_ARB_draw_indirect")) {
+            DrawElementsIndirect = reinterpret_cast<PFNDRAWELEMENTSINDIRECTPROC>(getProcAddress("glDrawElementsIndirect"));
+        }
+
+        if (__version >= 41 || HasExtension("GL_ARB_get_program_binary")) {
+            GetProgramBinary = reinterpret_cast<PFNGETPROGRAMBINARYPROC>(getProcAddress("glGetProgramBinary"));
+            ProgramBinary = reinterpret_cast<PFNPROGRAMBINARYPROC>(getProcAddress("glProgramBinary"));
+            ProgramParameteri = reinterpret_cast<PFNPROGRAMPARAMETERIPROC>(getProcAddress("glProgramParameteri"));
+        }
+
+        if (__version >= 42 || HasExtension("GL_ARB_shader_image_load_store")) {
+            MemoryBarrier = reinterpret_cast<PFNMEMORYBARRIERPROC>(getProcAddress("glMemoryBarrier"));
+            BindImageTexture = reinterpret_cast<PFNBINDIMAGETEXTUREPROC>(getProcAddress("glBindImageTexture"));
+        }
+
+        if (__version >= 43 || HasExtension("GL_ARB_multi_draw_indirect")) {
+            MultiDrawElementsIndirect = reinterpret_cast<PFNMULTIDRAWELEMENTSINDIRECTPROC>(getProcAddress("glMultiDrawElementsIndirect"));
+        }
+
+        if (__version >= 43 || HasExtension("GL_ARB_compute_shader")) {
+            DispatchCompute = reinterpret_cast<PFNDISPATCHCOMPUTEPROC>(getProcAddress("glDispatchCompute"));
+        }
+
+        // not in any core version
+        if (HasExtension("GL_KHR_parallel_shader_compile")) {
+            MaxShaderCompilerThreads = reinterpret_cast<PFNMAXSHADERCOMPILERTHREADSPROC>(getProcAddress("glMaxShaderCompilerThreadsKHR"));
+        } else if (HasExtension("GL_ARB_parallel_shader_compile")) {
+            MaxShaderCompilerThreads = reinterpret_cast<PFNMAXSHADERCOMPILERTHREADSPROC>(getProcAddress("glMaxShaderCompilerThreadsARB"));
+        }
+    }
+
+    int GetVersion()
+    {
+        return __version;
+    }
+
+    bool HasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+        for (GLint i = 0; i < count; ++i) {
+            auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+
+            if (std::strcmp(extension, name) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,147 @@
+#include "Video/GeometryPool.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Engine::GL {
+    GeometryPool::GeometryPool()
+    {
+        std::vector<uint32_t> ids(MAX_DRAWS);
+        std::iota(ids.begin(), ids.end(), 0);
+
+        glGenBuffers(1, &m_drawIdVbo);
+        StateCache::BindBuffer(GL_ARRAY_BUFFER, m_drawIdVbo);
+        glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(uint32_t), ids.data(), GL_STATIC_DRAW);
+    }
+
+    GeometryPool::~GeometryPool()
+    {
+        for (auto& bucket : m_buckets) {
+            StateCache::DeleteVertexArrays(1, &bucket.vao);
+            StateCache::DeleteBuffers(1, &bucket.vbo);
+            StateCache::DeleteBuffers(1, &bucket.ebo);
+        }
+
+        StateCache::DeleteBuffers(1, &m_drawIdVbo);
+    }
+
+    uint32_t GeometryPool::FindBucket(const VertexLayout& layout, GLenum indexType)
+    {
+        for (size_t i = 0; i < m_buckets.size(); ++i) {
+            const auto& bucket = m_buckets[i];
+
+            if (!(bucket.layout < layout) && !(layout < bucket.layout) && bucket.indexType == indexType) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+
+        auto& bucket = m_buckets.emplace_back();
+        bucket.layout = layout;
+        bucket.indexType = indexType;
+        bucket.indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        glGenVertexArrays(1, &bucket.vao);
+        StateCache::BindVertexArray(bucket.vao);
+
+        StateCache::BindBuffer(GL_ARRAY_BUFFER, m_drawIdVbo);
+        glEnableVertexAttribArray(DRAW_ID_LOCATION);
+        glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(uint32_t), nullptr);
+        glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+
+        StateCache::BindVertexArray(0);
+
+        return static_cast<uint32_t>(m_buckets.size() - 1);
+    }
+
+    void GeometryPool::Grow(GLuint& buffer, GLenum target, size_t oldSize, size_t newSize)
+    {
+        GLuint grown;
+        glGenBuffers(1, &grown);
+
+        // rounded up to a whole word, storage blocks can only read 16-bit indices two at a time
+        newSize = (newSize + 3) / 4 * 4;
+
+        StateCache::BindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+
+        if (buffer != 0) {
+            StateCache::BindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+            StateCache::DeleteBuffers(1, &buffer);
+        }
+
+        buffer = grown;
+        StateCache::BindBuffer(target, buffer);
+    }
+
+    const PoolAllocation& GeometryPool::Add(const Mesh& mesh)
+    {
+        if (auto search = m_allocations.find(&mesh); search != m_allocations.end()) {
+            return search->second;
+        }
+
+        auto bucketIndex = FindBucket(mesh.GetLayout(), mesh.GetIndexType());
+        auto& bucket = m_buckets[bucketIndex];
+
+        auto stride = bucket.layout.GetStride();
+        auto vertexCount = mesh.GetVertexCount();
+        auto indexCount = mesh.GetIndexBufferCount();
+
+        // both buffers are vao state, the element binding directly and the array one through the attribute pointers
+        StateCache::BindVertexArray(bucket.vao);
+
+        if (bucket.vertexCount + vertexCount > bucket.vertexCapacity) {
+            auto capacity = std::max(bucket.vertexCapacity * 2, bucket.vertexCount + vertexCount);
+
+            Grow(bucket.vbo, GL_ARRAY_BUFFER, bucket.vertexCount * stride, capacity * stride);
+            bucket.layout.Apply();
+
+            bucket.vertexCapacity = capacity;
+        }
+
+        if (bucket.indexCount + indexCount > bucket.indexCapacity) {
+            auto capacity = std::max(bucket.indexCapacity * 2, bucket.indexCount + indexCount);
+
+            Grow(bucket.ebo, GL_ELEMENT_ARRAY_BUFFER, bucket.indexCount * bucket.indexSize, capacity * bucket.indexSize);
+
+            bucket.indexCapacity = capacity;
+        }
+
+        StateCache::BindVertexArray(0);
+
+        // straight buffer to buffer copies, nothing comes back to the CPU
+        StateCache::BindBuffer(GL_COPY_READ_BUFFER, mesh.GetVertexBuffer());
+        StateCache::BindBuffer(GL_COPY_WRITE_BUFFER, bucket.vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, bucket.vertexCount * stride, vertexCount * stride);
+
+        StateCache::BindBuffer(GL_COPY_READ_BUFFER, mesh.GetIndexBuffer());
+        StateCache::BindBuffer(GL_COPY_WRITE_BUFFER, bucket.ebo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, bucket.indexCount * bucket.indexSize, indexCount * bucket.indexSize);
+
+        PoolAllocation allocation{bucketIndex, static_cast<int32_t>(bucket.vertexCount), static_cast<uint32_t>(bucket.indexCount)};
+
+        bucket.vertexCount += vertexCount;
+        bucket.indexCount += indexCount;
+
+        return m_allocations.emplace(&mesh, allocation).first->second;
+    }
+
+    const PoolAllocation* GeometryPool::Find(const Mesh& mesh) const
+    {
+        auto search = m_allocations.find(&mesh);
+
+        return search != m_allocations.end() ? &search->second : nullptr;
+    }
+
+    size_t GeometryPool::GetSize() const
+    {
+        size_t size = 0;
+
+        for (const auto& bucket : m_buckets) {
+            size += bucket.vertexCount * bucket.layout.GetStride() + bucket.indexCount * bucket.indexSize;
+        }
+
+        return size;
+    }
+}
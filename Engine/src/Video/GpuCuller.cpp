@@ -0,0 +1,116 @@
+#include "Video/GpuCuller.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace Engine::GL {
+    static constexpr GLuint WORK_GROUP_SIZE = 64;
+
+    GpuCuller::GpuCuller()
+    {
+        m_program.AttachShader("GLSL/cull_instances.comp", ShaderType::Compute);
+        m_program.Link();
+
+        glGenBuffers(1, &m_boundsBuffer);
+        glGenBuffers(1, &m_transformBuffer);
+        glGenBuffers(1, &m_instanceBuffer);
+        glGenBuffers(1, &m_commandBuffer);
+    }
+
+    GpuCuller::~GpuCuller()
+    {
+        StateCache::DeleteBuffers(1, &m_boundsBuffer);
+        StateCache::DeleteBuffers(1, &m_transformBuffer);
+        StateCache::DeleteBuffers(1, &m_instanceBuffer);
+        StateCache::DeleteBuffers(1, &m_commandBuffer);
+    }
+
+    bool GpuCuller::IsSupported()
+    {
+        return Ext::DispatchCompute != nullptr && Ext::MemoryBarrier != nullptr &&
+               Ext::BindImageTexture != nullptr && Ext::DrawElementsIndirect != nullptr;
+    }
+
+    void GpuCuller::SetInstances(const std::vector<glm::mat4>& transforms, const glm::vec3& center, float radius)
+    {
+        m_count = transforms.size();
+
+        // world space spheres, scaled by the largest axis so non uniform scales stay conservative
+        std::vector<glm::vec4> bounds;
+        bounds.reserve(transforms.size());
+
+        for (const auto& transform : transforms) {
+            auto scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+            bounds.emplace_back(glm::vec3(transform * glm::vec4(center, 1.0f)), radius * scale);
+        }
+
+        StateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bounds.size() * sizeof(glm::vec4), bounds.data(), GL_STATIC_DRAW);
+
+        StateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_transformBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_STATIC_DRAW);
+
+        // sized for every instance passing, the shader never writes past the count that did
+        StateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, transforms.size() * sizeof(glm::mat4), nullptr, GL_DYNAMIC_COPY);
+
+        StateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    void GpuCuller::Cull(const Model& model, const glm::mat4& projectionView, const DepthPyramid* pyramid, const glm::mat4& previousProjectionView)
+    {
+        // instance counts start at 0, the shader counts the survivors into the first command
+        m_commands.clear();
+
+        for (const auto& mesh : model.GetMeshes()) {
+            const auto& lod = mesh.GetCurrentLod();
+            m_commands.push_back({lod.indexCount, 0, lod.firstIndex, 0, 0});
+        }
+
+        if (m_commands.empty()) {
+            return;
+        }
+
+        StateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(Ext::DrawElementsIndirectCommand), m_commands.data(), GL_STREAM_DRAW);
+
+        StateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_boundsBuffer);
+        StateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_transformBuffer);
+        StateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_instanceBuffer);
+        StateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_commandBuffer);
+
+        m_program.Use();
+        m_program.SetUniform("instanceCount", static_cast<int>(m_count));
+
+        const auto& planes = Util::Frustum(projectionView).GetPlanes();
+
+        m_program.SetUniform("planes", planes.data(), static_cast<GLsizei>(planes.size()));
+
+        m_program.SetUniform("useDepthPyramid", pyramid != nullptr ? 1 : 0);
+
+        if (pyramid != nullptr) {
+            StateCache::BindTexture(0, pyramid->GetTexture());
+
+            m_program.SetUniform("depthPyramid", 0);
+            m_program.SetUniform("previousProjectionView", previousProjectionView);
+            m_program.SetUniform("pyramidLevels", pyramid->GetLevelCount());
+        }
+
+        m_program.Dispatch(static_cast<GLuint>((m_count + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE));
+
+        // the copies below and the draws read what the shader wrote, as commands and as vertex attributes
+        Ext::MemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+        // every mesh draws the same instances
+        auto countOffset = offsetof(Ext::DrawElementsIndirectCommand, instanceCount);
+
+        StateCache::BindBuffer(GL_COPY_READ_BUFFER, m_commandBuffer);
+        StateCache::BindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+
+        for (size_t i = 1; i < m_commands.size(); ++i) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, countOffset,
+                                i * sizeof(Ext::DrawElementsIndirectCommand) + countOffset, sizeof(uint32_t));
+        }
+    }
+}
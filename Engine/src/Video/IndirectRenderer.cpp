@@ -0,0 +1,149 @@
+#include "Video/IndirectRenderer.hpp"
+#include "Video/GLExt.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#ifndef GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS
+#define GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS 0x90D6
+#endif
+
+namespace Engine::GL {
+    static constexpr UniformHandle DRAW_BASE_UNIFORM = "drawBase"_u;
+
+    IndirectRenderer::IndirectRenderer()
+    {
+        glGenBuffers(1, &m_drawDataBuffer);
+        glGenBuffers(1, &m_commandBuffer);
+    }
+
+    IndirectRenderer::~IndirectRenderer()
+    {
+        StateCache::DeleteBuffers(1, &m_drawDataBuffer);
+        StateCache::DeleteBuffers(1, &m_commandBuffer);
+    }
+
+    bool IndirectRenderer::IsSupported()
+    {
+        if (Ext::GetVersion() < 43 || Ext::MultiDrawElementsIndirect == nullptr) {
+            return false;
+        }
+
+        // 4.3 only requires storage blocks in compute shaders, vertex shaders are allowed to have none
+        GLint blocks = 0;
+        glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &blocks);
+
+        return blocks > 0;
+    }
+
+    void IndirectRenderer::Begin()
+    {
+        m_items.clear();
+    }
+
+    void IndirectRenderer::Submit(Mesh& mesh, Program& program, const glm::mat4& model)
+    {
+        if (m_items.size() == GeometryPool::MAX_DRAWS) {
+            return;
+        }
+
+        auto& allocation = m_pool.Add(mesh);
+        m_items.push_back({&mesh, &program, allocation.bucket, model});
+    }
+
+    void IndirectRenderer::Execute(IndirectStats& stats, DrawStats& drawStats)
+    {
+        if (m_items.empty()) {
+            return;
+        }
+
+        // group the draws that can share a multi draw, the pool bucket goes last since switching it is the cheapest
+        m_order.resize(m_items.size());
+        std::iota(m_order.begin(), m_order.end(), 0);
+
+        auto groupKey = [this](uint32_t i) {
+            const auto& item = m_items[i];
+            return std::make_tuple(item.program, item.mesh->GetTextures(), item.bucket);
+        };
+
+        std::stable_sort(m_order.begin(), m_order.end(), [&groupKey](uint32_t a, uint32_t b) {
+            return groupKey(a) < groupKey(b);
+        });
+
+        m_drawData.clear();
+        m_commands.clear();
+
+        for (auto i : m_order) {
+            const auto& item = m_items[i];
+            const auto& allocation = *m_pool.Find(*item.mesh);
+            const auto& lod = item.mesh->GetCurrentLod();
+
+            m_drawData.push_back({
+                    item.model,
+                    glm::mat4(glm::inverseTranspose(glm::mat3(item.model))),
+                    item.mesh->GetPositionBias(),
+                    item.mesh->GetPositionScale()
+            });
+
+            auto drawIndex = static_cast<uint32_t>(m_commands.size());
+            m_commands.push_back({lod.indexCount, 1, allocation.firstIndex + lod.firstIndex, allocation.baseVertex, drawIndex});
+
+            drawStats.trianglesTotal += item.mesh->GetIndexCount() / 3;
+            drawStats.trianglesDrawn += lod.indexCount / 3;
+        }
+
+        // respecifying the buffers orphans last frame's storage instead of waiting for the GPU to finish with it
+        StateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_drawData.size() * sizeof(DrawData), m_drawData.data(), GL_STREAM_DRAW);
+        StateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, m_drawDataBuffer);
+
+        StateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(Ext::DrawElementsIndirectCommand), m_commands.data(), GL_STREAM_DRAW);
+
+        Program* program = nullptr;
+        auto bucket = ~0u;
+
+        for (size_t first = 0; first < m_order.size();) {
+            auto last = first + 1;
+
+            while (last < m_order.size() && groupKey(m_order[last]) == groupKey(m_order[first])) {
+                last++;
+            }
+
+            auto& item = m_items[m_order[first]];
+
+            if (item.program != program) {
+                program = item.program;
+                program->Use();
+            }
+
+            if (item.bucket != bucket) {
+                bucket = item.bucket;
+                m_pool.Bind(bucket);
+            }
+
+            // textures still split the draws, there's no bindless to put them in DrawData
+            item.mesh->BindMaterial();
+
+            // gl_DrawIDARB restarts at 0 for every multi draw
+            program->SetUniform(DRAW_BASE_UNIFORM, static_cast<int>(first));
+
+            Ext::MultiDrawElementsIndirect(
+                    GL_TRIANGLES,
+                    m_pool.GetIndexType(bucket),
+                    reinterpret_cast<const void*>(first * sizeof(Ext::DrawElementsIndirectCommand)),
+                    static_cast<GLsizei>(last - first),
+                    0
+            );
+
+            stats.multiDraws++;
+            stats.draws += last - first;
+
+            first = last;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#include "Video/LightBuffer.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Engine::GL {
+    static_assert(sizeof(PointLight) == 32, "PointLight has to match the std140 layout of the block");
+
+    LightBuffer::LightBuffer()
+    {
+        glGenBuffers(1, &m_buffer);
+    }
+
+    LightBuffer::~LightBuffer()
+    {
+        StateCache::DeleteBuffers(1, &m_buffer);
+    }
+
+    void LightBuffer::Update(const std::vector<PointLight>& lights)
+    {
+        m_count = std::min(lights.size(), MAX_LIGHTS);
+
+        // the buffer has to be as big as the block the shaders declare, however few lights there are
+        auto size = LIGHTS_OFFSET + MAX_LIGHTS * sizeof(PointLight);
+        auto count = static_cast<int32_t>(m_count);
+
+        // orphaned like the frame uniforms, last frame's lights may still be in use
+        StateCache::BindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(count), &count);
+        glBufferSubData(GL_UNIFORM_BUFFER, LIGHTS_OFFSET, m_count * sizeof(PointLight), lights.data());
+        StateCache::BindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_buffer);
+    }
+}
@@ -1,8 +1,79 @@
 #include "Video/Mesh.hpp"
+#include "Video/GLExt.hpp"
+#include "Video/StateCache.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <optional>
 
+#include <glm/gtc/packing.hpp>
+
 namespace Engine::GL {
+    // generic attribute locations the mesh shaders read the position dequantization constants from
+    static constexpr GLuint POS_BIAS_LOCATION = 4;
+    static constexpr GLuint POS_SCALE_LOCATION = 5;
+
+    // where the instanced mesh shaders read the per instance model matrix from
+    static constexpr GLuint INSTANCE_MODEL_LOCATION = 6;
+
+    /// Maps a unit vector to the [-1, 1] square of an octahedron unfolded onto the z = 0 plane
+    static glm::vec2 OctEncode(glm::vec3 n)
+    {
+        n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+
+        glm::vec2 p{n.x, n.y};
+
+        if (n.z < 0.0f) {
+            p = {
+                    (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                    (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+            };
+        }
+
+        return p;
+    }
+
+    /// Inverse of OctEncode, mirrors octDecode in the mesh vertex shaders
+    static glm::vec3 OctDecode(glm::vec2 p)
+    {
+        glm::vec3 n{p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y)};
+
+        float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+
+        return glm::normalize(n);
+    }
+
+    /// Packs a direction into a GL_INT_2_10_10_10_REV word, returning the angle it got bent by (in degrees)
+    static float PackDirection(const glm::vec3& dir, uint32_t& packed)
+    {
+        if (glm::dot(dir, dir) == 0.0f) {
+            // degenerate (assimp does this for tangents on meshes without uvs), nothing to preserve
+            packed = 0;
+            return 0.0f;
+        }
+
+        auto unit = glm::normalize(dir);
+        auto oct = OctEncode(unit);
+        packed = glm::packSnorm3x10_1x2(glm::vec4(oct.x, oct.y, 0.0f, 0.0f));
+
+        auto unpacked = glm::unpackSnorm3x10_1x2(packed);
+        auto decoded = OctDecode({unpacked.x, unpacked.y});
+
+        float cosine = std::clamp(glm::dot(unit, decoded), -1.0f, 1.0f);
+        return glm::degrees(std::acos(cosine));
+    }
+
+    template <typename T>
+    static void Append(std::vector<uint8_t>& data, const T& value)
+    {
+        auto offset = data.size();
+        data.resize(offset + sizeof(T));
+        std::memcpy(data.data() + offset, &value, sizeof(T));
+    }
+
     Mesh::Mesh(
               const std::vector<glm::vec3>& pos
             , const std::vector<glm::vec2>& uv
@@ -13,107 +84,251 @@ namespace Engine::GL {
             , Texture* specular
             , Texture* bumpmap
             , Texture* displacementMap
+            , VertexFormat format
     ) : m_drawCount(index.size())
         , m_diffuse(diffuse)
         , m_specular(specular)
         , m_bumpmap(bumpmap)
         , m_displacementMap(displacementMap)
+        , m_indexType(pos.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT)
+        , m_indexSize(pos.size() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t))
+        , m_layout{format, !uv.empty(), !normal.empty(), !tangents.empty()}
+        , m_aabbMin(0.0f)
+        , m_aabbMax(0.0f)
+        , m_sphereCenter(0.0f)
+        , m_sphereRadius(0.0f)
+        , m_lods{{0, static_cast<uint32_t>(index.size()), 0.0f}}
     {
         // TODO: std::optional<std::vector<glm::vec3>>> ?
         bool hasUV = !uv.empty();
         bool hasNormal = !normal.empty();
         bool hasTangents = !tangents.empty();
 
+        if (!pos.empty()) {
+            m_aabbMin = m_aabbMax = pos[0];
+
+            for (const auto& p : pos) {
+                m_aabbMin = glm::min(m_aabbMin, p);
+                m_aabbMax = glm::max(m_aabbMax, p);
+            }
+
+            m_sphereCenter = (m_aabbMin + m_aabbMax) * 0.5f;
+
+            for (const auto& p : pos) {
+                m_sphereRadius = std::max(m_sphereRadius, glm::distance(m_sphereCenter, p));
+            }
+        }
+
         // generate the vao and the vertex and index buffers
         glGenVertexArrays(1, &m_vao);
         glGenBuffers(1, &m_vbo);
         glGenBuffers(1, &m_ebo);
+        glGenVertexArrays(1, &m_depthVao);
+        glGenBuffers(1, &m_positionVbo);
+
+        // how many bytes to skip between each vertex
+        size_t stride = m_layout.GetStride();
+
+        m_vertexStats.vertexCount = pos.size();
+        m_vertexStats.stride = stride;
+        m_vertexStats.fullStride = VertexLayout{VertexFormat::Full, hasUV, hasNormal, hasTangents}.GetStride();
 
         // interleave the vertex data
-        std::vector<float> vertexData;
+        std::vector<uint8_t> vertexData;
+        vertexData.reserve(pos.size() * stride);
+
+        // and the positions again on their own
+        VertexLayout positionLayout{format, false, false, false};
+
+        std::vector<uint8_t> positionData;
+        positionData.reserve(pos.size() * positionLayout.GetStride());
 
-        // reserve enough for pos, uv, normal (each has at least 3 floats)
-        vertexData.reserve(pos.size() * 3 * 3 * 3 * sizeof(float));
+        // a flat axis would divide by zero, any scale works for it
+        auto extent = m_aabbMax - m_aabbMin;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (extent[axis] == 0.0f) {
+                extent[axis] = 1.0f;
+            }
+        }
 
         for (size_t i = 0; i < pos.size(); ++i) {
-            vertexData.push_back(pos[i].x);
-            vertexData.push_back(pos[i].y);
-            vertexData.push_back(pos[i].z);
+            if (format == VertexFormat::Full) {
+                Append(vertexData, pos[i]);
+                Append(positionData, pos[i]);
+
+                // uv (gl calls this st for whatever reason)
+                if (hasUV) {
+                    Append(vertexData, uv[i]);
+                }
+
+                // normals
+                if (hasNormal) {
+                    Append(vertexData, normal[i]);
+                }
+
+                if (hasTangents) {
+                    Append(vertexData, tangents[i]);
+                }
+
+                continue;
+            }
+
+            auto unit = (pos[i] - m_aabbMin) / extent;
+            uint16_t quantized[4] = {0, 0, 0, 0};
+
+            for (int axis = 0; axis < 3; ++axis) {
+                quantized[axis] = static_cast<uint16_t>(std::lround(std::clamp(unit[axis], 0.0f, 1.0f) * 65535.0f));
+
+                float decoded = m_aabbMin[axis] + quantized[axis] / 65535.0f * extent[axis];
+                m_vertexStats.maxPositionError = std::max(m_vertexStats.maxPositionError, std::abs(decoded - pos[i][axis]));
+            }
+
+            Append(vertexData, quantized);
+            Append(positionData, quantized);
 
-            // uv (gl calls this st for whatever reason)
             if (hasUV) {
-                vertexData.push_back(uv[i].s);
-                vertexData.push_back(uv[i].t);
+                auto packed = glm::packHalf2x16(uv[i]);
+                auto decoded = glm::unpackHalf2x16(packed);
+
+                m_vertexStats.maxUvError = std::max({
+                        m_vertexStats.maxUvError,
+                        std::abs(decoded.x - uv[i].x),
+                        std::abs(decoded.y - uv[i].y)
+                });
+
+                Append(vertexData, packed);
             }
 
-            // normals
             if (hasNormal) {
-                vertexData.push_back(normal[i].x);
-                vertexData.push_back(normal[i].y);
-                vertexData.push_back(normal[i].z);
+                uint32_t packed;
+                m_vertexStats.maxNormalError = std::max(m_vertexStats.maxNormalError, PackDirection(normal[i], packed));
+                Append(vertexData, packed);
             }
 
             if (hasTangents) {
-                vertexData.push_back(tangents[i].x);
-                vertexData.push_back(tangents[i].y);
-                vertexData.push_back(tangents[i].z);
+                uint32_t packed;
+                m_vertexStats.maxTangentError = std::max(m_vertexStats.maxTangentError, PackDirection(tangents[i], packed));
+                Append(vertexData, packed);
             }
         }
 
-        glBindVertexArray(m_vao);
+        StateCache::BindVertexArray(m_vao);
 
         // vertex data upload
-        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
+        StateCache::BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
 
-        // index data upload
+        // index data upload, narrowed to 16 bits when the vertex count allows it.
+        // GL_UNSIGNED_BYTE would be smaller still, but plenty of hardware converts it on the fly, so no
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index.size() * sizeof(uint32_t), index.data(), GL_STATIC_DRAW);
+
+        if (m_indexType == GL_UNSIGNED_SHORT) {
+            std::vector<uint16_t> narrow(index.begin(), index.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(uint16_t), narrow.data(), GL_STATIC_DRAW);
+        } else {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, index.size() * sizeof(uint32_t), index.data(), GL_STATIC_DRAW);
+        }
 
         // vertex data layout setup
+        m_layout.Apply();
 
-#define STUPID_CAST(x) (reinterpret_cast<GLvoid*>(x))
+        // the depth pre-pass fetches 12 bytes a vertex from here instead of striding over 44 (8 instead of 20 compact).
+        // Encoded the same as the interleaved copy, so both decode to exactly the same positions and depths match
+        // for GL_EQUAL
+        StateCache::BindVertexArray(m_depthVao);
 
-        // how many bytes to skip between each vertex
-        size_t stride = 3 * sizeof(float); // + 2 * sizeof(float) + 3 * sizeof(float);
-        if (hasUV) stride += 2 * sizeof(float);
-        if (hasNormal) stride += 3 * sizeof(float);
-        if (hasTangents) stride += 3 * sizeof(float);
+        StateCache::BindBuffer(GL_ARRAY_BUFFER, m_positionVbo);
+        glBufferData(GL_ARRAY_BUFFER, positionData.size(), positionData.data(), GL_STATIC_DRAW);
 
-        // how many bytes to skip for the current vertex attribute
-        size_t offset = 0;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+        positionLayout.Apply();
 
-        // position
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
-        offset += 3 * sizeof(float);
+        StateCache::BindVertexArray(0);
+    }
 
-        // uv
-        if (hasUV) {
-            glEnableVertexAttribArray(1);
-            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
-            offset += 2 * sizeof(float);
-        }
+    size_t VertexLayout::GetStride() const
+    {
+        if (format == VertexFormat::Full) {
+            size_t stride = 3 * sizeof(float);
+            if (hasUV) stride += 2 * sizeof(float);
+            if (hasNormal) stride += 3 * sizeof(float);
+            if (hasTangents) stride += 3 * sizeof(float);
 
-        // normals
-        if (hasNormal) {
-            glEnableVertexAttribArray(2);
-            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
-            offset += 3 * sizeof(float);
+            return stride;
         }
 
-        if (hasTangents) {
-            glEnableVertexAttribArray(3);
-            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
+        // positions get padded to 4 shorts to keep every attribute 4 byte aligned
+        size_t stride = 4 * sizeof(uint16_t);
+        if (hasUV) stride += sizeof(uint32_t);
+        if (hasNormal) stride += sizeof(uint32_t);
+        if (hasTangents) stride += sizeof(uint32_t);
+
+        return stride;
+    }
+
+    void VertexLayout::Apply() const
+    {
+#define STUPID_CAST(x) (reinterpret_cast<GLvoid*>(x))
+
+        // how many bytes to skip for the current vertex attribute
+        size_t offset = 0;
+        auto stride = static_cast<GLsizei>(GetStride());
+
+        if (format == VertexFormat::Full) {
+            // position
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
             offset += 3 * sizeof(float);
+
+            // uv
+            if (hasUV) {
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
+                offset += 2 * sizeof(float);
+            }
+
+            // normals
+            if (hasNormal) {
+                glEnableVertexAttribArray(2);
+                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
+                offset += 3 * sizeof(float);
+            }
+
+            if (hasTangents) {
+                glEnableVertexAttribArray(3);
+                glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
+                offset += 3 * sizeof(float);
+            }
+        } else {
+            // position, normalized to [0, 1], the shader scales it back using the constants set in Draw
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, STUPID_CAST(offset));
+            offset += 4 * sizeof(uint16_t);
+
+            if (hasUV) {
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, STUPID_CAST(offset));
+                offset += sizeof(uint32_t);
+            }
+
+            // normals and tangents, the shader decodes the octahedral xy back to a vector
+            if (hasNormal) {
+                glEnableVertexAttribArray(2);
+                glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, STUPID_CAST(offset));
+                offset += sizeof(uint32_t);
+            }
+
+            if (hasTangents) {
+                glEnableVertexAttribArray(3);
+                glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, STUPID_CAST(offset));
+                offset += sizeof(uint32_t);
+            }
         }
 
 #undef STUPID_CAST
-
-        glBindVertexArray(0);
     }
 
-    void Mesh::Draw()
+    void Mesh::BindMaterial()
     {
         if (m_diffuse != nullptr) {
             m_diffuse->Bind(0);
@@ -138,9 +353,162 @@ namespace Engine::GL {
         } else {
             Texture::BindNull(3);
         }
+    }
+
+    void Mesh::BindGeometry()
+    {
+        // the dequantization constants live in the current values of attribute arrays the vao leaves disabled,
+        // so the same shaders work for every format without knowing which one they got
+        auto bias = GetPositionBias();
+        auto scale = GetPositionScale();
+
+        glVertexAttrib4f(POS_BIAS_LOCATION, bias.x, bias.y, bias.z, bias.w);
+        glVertexAttrib4f(POS_SCALE_LOCATION, scale.x, scale.y, scale.z, scale.w);
+
+        StateCache::BindVertexArray(m_vao);
+    }
+
+    void Mesh::BindDepthGeometry()
+    {
+        auto bias = GetPositionBias();
+        auto scale = GetPositionScale();
+
+        glVertexAttrib4f(POS_BIAS_LOCATION, bias.x, bias.y, bias.z, bias.w);
+        glVertexAttrib4f(POS_SCALE_LOCATION, scale.x, scale.y, scale.z, scale.w);
+
+        StateCache::BindVertexArray(m_depthVao);
+    }
+
+    glm::vec4 Mesh::GetPositionBias() const
+    {
+        if (m_layout.format == VertexFormat::Compact) {
+            return {m_aabbMin, 0.0f};
+        }
+
+        return glm::vec4(0.0f);
+    }
+
+    glm::vec4 Mesh::GetPositionScale() const
+    {
+        if (m_layout.format == VertexFormat::Compact) {
+            return {m_aabbMax - m_aabbMin, 1.0f};
+        }
+
+        return {1.0f, 1.0f, 1.0f, 0.0f};
+    }
+
+    void Mesh::SetLods(const std::vector<Util::LodLevel>& levels)
+    {
+        std::vector<uint32_t> indices;
+        m_lods.clear();
+
+        for (const auto& level : levels) {
+            m_lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(level.indices.size()), level.error});
+            indices.insert(indices.end(), level.indices.begin(), level.indices.end());
+        }
+
+        m_lod = 0;
+
+        // the element buffer binding is vao state, so the vao has to be bound to touch it
+        StateCache::BindVertexArray(m_vao);
+
+        if (m_indexType == GL_UNSIGNED_SHORT) {
+            std::vector<uint16_t> narrow(indices.begin(), indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(uint16_t), narrow.data(), GL_STATIC_DRAW);
+        } else {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+        }
+
+        StateCache::BindVertexArray(0);
+    }
+
+    void Mesh::Draw()
+    {
+        BindMaterial();
+        BindGeometry();
+        DrawBound();
+    }
+
+    void Mesh::DrawBound()
+    {
+        auto& lod = m_lods[m_lod];
+
+        glDrawElements(GL_TRIANGLES, lod.indexCount, m_indexType, reinterpret_cast<const GLvoid*>(lod.firstIndex * m_indexSize));
+    }
+
+    void Mesh::SetInstanceBuffer(GLuint buffer)
+    {
+        StateCache::BindVertexArray(m_vao);
+        StateCache::BindBuffer(GL_ARRAY_BUFFER, buffer);
+
+        // a mat4 attribute takes one location per column
+        for (GLuint column = 0; column < 4; ++column) {
+            glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+            glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                  reinterpret_cast<const GLvoid*>(column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + column, 1);
+        }
+
+        StateCache::BindVertexArray(0);
+    }
+
+    void Mesh::DrawInstancedBound(GLsizei count)
+    {
+        auto& lod = m_lods[m_lod];
+
+        glDrawElementsInstanced(GL_TRIANGLES, lod.indexCount, m_indexType, reinterpret_cast<const GLvoid*>(lod.firstIndex * m_indexSize), count);
+    }
+
+    void Mesh::DrawIndirectBound(size_t commandOffset)
+    {
+        Ext::DrawElementsIndirect(GL_TRIANGLES, m_indexType, reinterpret_cast<const GLvoid*>(commandOffset));
+    }
+
+    void Mesh::DrawCulled(const Util::Frustum& frustum, const glm::vec3& cameraPosition, DrawStats& stats)
+    {
+        BindMaterial();
+        BindGeometry();
+        DrawCulledBound(frustum, cameraPosition, stats);
+    }
+
+    void Mesh::DrawCulledBound(const Util::Frustum& frustum, const glm::vec3& cameraPosition, DrawStats& stats)
+    {
+        stats.trianglesTotal += m_drawCount / 3;
+
+        // meshlets only exist for the full detail level
+        if (m_meshlets.empty() || m_lod != 0) {
+            stats.trianglesDrawn += GetTriangleCount();
+            DrawBound();
+            return;
+        }
+
+        m_culledCounts.clear();
+        m_culledOffsets.clear();
+
+        // meshlets are contiguous in the index buffer, so neighbouring survivors merge into one range
+        uint32_t rangeEnd = ~0u;
+
+        for (const auto& meshlet : m_meshlets) {
+            if (!frustum.TestSphere(meshlet.center, meshlet.radius) || meshlet.IsBackfacing(cameraPosition)) {
+                continue;
+            }
+
+            stats.trianglesDrawn += meshlet.indexCount / 3;
+
+            if (meshlet.firstIndex == rangeEnd) {
+                m_culledCounts.back() += meshlet.indexCount;
+            } else {
+                m_culledCounts.push_back(meshlet.indexCount);
+                m_culledOffsets.push_back(reinterpret_cast<const GLvoid*>(meshlet.firstIndex * m_indexSize));
+            }
+
+            rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+        }
+
+        if (m_culledCounts.empty()) {
+            return;
+        }
 
-        glBindVertexArray(m_vao);
-        glDrawElements(GL_TRIANGLES, m_drawCount, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        glMultiDrawElements(GL_TRIANGLES, m_culledCounts.data(), m_indexType, m_culledOffsets.data(), m_culledCounts.size());
     }
-}
\ No newline at end of file
+}
@@ -1,15 +1,281 @@
 #include "Video/Model.hpp"
+#include "Video/GLExt.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
 
 namespace Engine::GL {
     Model::Model(std::vector<Engine::GL::Mesh> meshes) :
-        m_meshes(std::move(meshes))
+        m_meshes(std::move(meshes)),
+        m_aabbMin(0.0f),
+        m_aabbMax(0.0f),
+        m_center(0.0f),
+        m_radius(0.0f),
+        m_meshVisible(m_meshes.size(), 1)
     {
+        if (m_meshes.empty()) {
+            return;
+        }
+
+        auto min = m_meshes[0].GetAabbMin();
+        auto max = m_meshes[0].GetAabbMax();
+
+        for (const auto& mesh : m_meshes) {
+            min = glm::min(min, mesh.GetAabbMin());
+            max = glm::max(max, mesh.GetAabbMax());
+
+            m_lodErrors.resize(std::max(m_lodErrors.size(), mesh.GetLodCount()), 0.0f);
+
+            // meshes with a shorter chain keep drawing their last level, which has that level's error
+            for (size_t level = 0; level < m_lodErrors.size(); ++level) {
+                m_lodErrors[level] = std::max(m_lodErrors[level], mesh.GetLodError(level));
+            }
+        }
+
+        m_aabbMin = min;
+        m_aabbMax = max;
+        m_center = (min + max) * 0.5f;
+        m_radius = glm::length(max - min) * 0.5f;
     }
 
     void Model::Draw()
     {
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            if (m_meshVisible[i]) {
+                m_meshes[i].Draw();
+            }
+        }
+    }
+
+    void Model::Draw(DrawStats& stats)
+    {
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            stats.trianglesTotal += m_meshes[i].GetIndexCount() / 3;
+
+            if (m_meshVisible[i]) {
+                stats.trianglesDrawn += m_meshes[i].GetTriangleCount();
+                m_meshes[i].Draw();
+            }
+        }
+    }
+
+    void Model::DrawInstanced(const glm::mat4* transforms, size_t count)
+    {
+        if (count == 0) {
+            return;
+        }
+
+        if (m_instanceVbo == 0) {
+            glGenBuffers(1, &m_instanceVbo);
+        }
+
+        SetInstanceBuffer(m_instanceVbo);
+
+        // respecifying the whole buffer orphans last frame's storage instead of waiting for the GPU to finish with it
+        StateCache::BindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), transforms, GL_STREAM_DRAW);
+
+        // the visibility flags belong to the model's own placement, culling instances is up to the caller
+        for (auto& mesh : m_meshes) {
+            mesh.BindMaterial();
+            mesh.BindGeometry();
+            mesh.DrawInstancedBound(static_cast<GLsizei>(count));
+        }
+    }
+
+    void Model::DrawInstancedIndirect(GLuint instanceBuffer, GLuint commandBuffer)
+    {
+        SetInstanceBuffer(instanceBuffer);
+
+        StateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            m_meshes[i].BindMaterial();
+            m_meshes[i].BindGeometry();
+            m_meshes[i].DrawIndirectBound(i * sizeof(Ext::DrawElementsIndirectCommand));
+        }
+    }
+
+    void Model::SetInstanceBuffer(GLuint buffer)
+    {
+        if (buffer == m_meshInstanceBuffer) {
+            return;
+        }
+
         for (auto& mesh : m_meshes) {
-            mesh.Draw();
+            mesh.SetInstanceBuffer(buffer);
+        }
+
+        m_meshInstanceBuffer = buffer;
+    }
+
+    void Model::DrawCulled(const glm::mat4& projectionView, const glm::mat4& model, const glm::vec3& cameraPosition, DrawStats& stats)
+    {
+        // cull in object space, which saves transforming every bounding sphere and cone
+        Util::Frustum frustum(projectionView * model);
+        auto localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            if (m_meshVisible[i]) {
+                m_meshes[i].DrawCulled(frustum, localCamera, stats);
+            } else {
+                stats.trianglesTotal += m_meshes[i].GetIndexCount() / 3;
+            }
+        }
+    }
+
+    void Model::Submit(RenderQueue& queue, Program& program, const glm::mat4& model, RenderPass pass, bool cullMeshlets)
+    {
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            if (m_meshVisible[i]) {
+                queue.Submit(m_meshes[i], program, model, pass, cullMeshlets);
+            }
         }
     }
-}
\ No newline at end of file
+
+    void Model::SubmitIndirect(IndirectRenderer& renderer, Program& program, const glm::mat4& model)
+    {
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            if (m_meshVisible[i]) {
+                renderer.Submit(m_meshes[i], program, model);
+            }
+        }
+    }
+
+    void Model::SubmitVisibility(VisibilityRenderer& renderer, const glm::mat4& model)
+    {
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            if (m_meshVisible[i]) {
+                renderer.Submit(m_meshes[i], model);
+            }
+        }
+    }
+
+    void Model::AddToCullTable(Util::CullTable& table)
+    {
+        m_cullIndex = table.Size();
+
+        for (const auto& mesh : m_meshes) {
+            table.Add(mesh.GetSphereCenter(), mesh.GetSphereRadius());
+        }
+    }
+
+    void Model::UpdateCullTable(Util::CullTable& table, const glm::mat4& model) const
+    {
+        float scale = std::max({
+                glm::length(glm::vec3(model[0])),
+                glm::length(glm::vec3(model[1])),
+                glm::length(glm::vec3(model[2]))
+        });
+
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            auto center = glm::vec3(model * glm::vec4(m_meshes[i].GetSphereCenter(), 1.0f));
+            table.Set(m_cullIndex + i, center, m_meshes[i].GetSphereRadius() * scale);
+        }
+    }
+
+    void Model::UpdateVisibility(const Util::CullTable& table)
+    {
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            m_meshVisible[i] = table.IsVisible(m_cullIndex + i);
+        }
+    }
+
+    size_t Model::ApplyOcclusion(const Util::OcclusionBuffer& buffer, const glm::mat4& clip)
+    {
+        size_t occluded = 0;
+
+        for (size_t i = 0; i < m_meshes.size(); ++i) {
+            if (m_meshVisible[i] && !buffer.TestAabb(m_meshes[i].GetAabbMin(), m_meshes[i].GetAabbMax(), clip)) {
+                m_meshVisible[i] = 0;
+                occluded++;
+            }
+        }
+
+        return occluded;
+    }
+
+    void Model::SelectLod(const glm::mat4& projection, const glm::mat4& model, const glm::vec3& cameraPosition, float viewportHeight, float pixelThreshold)
+    {
+        // how much the model matrix can stretch an object space error
+        float scale = std::max({
+                glm::length(glm::vec3(model[0])),
+                glm::length(glm::vec3(model[1])),
+                glm::length(glm::vec3(model[2]))
+        });
+
+        auto center = glm::vec3(model * glm::vec4(m_center, 1.0f));
+        float distance = std::max(glm::distance(center, cameraPosition) - m_radius * scale, 0.01f);
+
+        // projection[1][1] is cot(fovy / 2), so this is how many pixels a unit at that distance covers
+        float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f / distance;
+
+        auto projectedError = [&](size_t level) {
+            return m_lodErrors[level] * scale * pixelsPerUnit;
+        };
+
+        size_t desired = 0;
+        while (desired + 1 < m_lodErrors.size() && projectedError(desired + 1) <= pixelThreshold) {
+            desired++;
+        }
+
+        // getting finer is always immediate, the current level is already over the threshold
+        if (desired < m_lod) {
+            m_lod = desired;
+        } else {
+            constexpr float hysteresis = 0.75f;
+
+            while (m_lod < desired && projectedError(m_lod + 1) <= pixelThreshold * hysteresis) {
+                m_lod++;
+            }
+        }
+
+        for (auto& mesh : m_meshes) {
+            mesh.SetLod(m_lod);
+        }
+    }
+
+    size_t Model::GetTriangleCount() const
+    {
+        size_t triangles = 0;
+
+        for (const auto& mesh : m_meshes) {
+            triangles += mesh.GetIndexCount() / 3;
+        }
+
+        return triangles;
+    }
+
+    void Model::PrintStats(const char* name) const
+    {
+        VertexStats total;
+        size_t vertexBytes = 0, fullVertexBytes = 0;
+        size_t indexCount = 0, indexBytes = 0;
+
+        for (const auto& mesh : m_meshes) {
+            const auto& stats = mesh.GetVertexStats();
+
+            total.vertexCount += stats.vertexCount;
+            vertexBytes += stats.vertexCount * stats.stride;
+            fullVertexBytes += stats.vertexCount * stats.fullStride;
+
+            indexCount += mesh.GetIndexCount();
+            indexBytes += mesh.GetIndexCount() * mesh.GetIndexSize();
+
+            total.maxPositionError = std::max(total.maxPositionError, stats.maxPositionError);
+            total.maxNormalError = std::max(total.maxNormalError, stats.maxNormalError);
+            total.maxTangentError = std::max(total.maxTangentError, stats.maxTangentError);
+            total.maxUvError = std::max(total.maxUvError, stats.maxUvError);
+        }
+
+        // every vertex gets fetched at least once per draw, so the size difference is the bandwidth saved per draw.
+        // indices are all fetched on every draw, so their size is the index fetch bandwidth per draw
+        printf("%s: %zu meshes, %zu vertices, %zu bytes of vertex data (%zu as full floats, %zu saved per draw)\n"
+               "%s: max error: position %g, normal %g deg, tangent %g deg, uv %g\n"
+               "%s: %zu indices, %zu bytes of index data fetched per draw (%zu as 32-bit)\n",
+               name, m_meshes.size(), total.vertexCount, vertexBytes, fullVertexBytes, fullVertexBytes - vertexBytes,
+               name, total.maxPositionError, total.maxNormalError, total.maxTangentError, total.maxUvError,
+               name, indexCount, indexBytes, indexCount * sizeof(uint32_t));
+    }
+}
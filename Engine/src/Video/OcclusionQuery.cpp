@@ -0,0 +1,106 @@
+#include "Video/OcclusionQuery.hpp"
+#include "Video/StateCache.hpp"
+
+#include <cstdint>
+
+namespace Engine::GL {
+    /// The unit cube every query draws, shared by all queries and created on first use
+    static GLuint CubeVao()
+    {
+        static GLuint vao = 0;
+
+        if (vao != 0) {
+            return vao;
+        }
+
+        static const float corners[] = {
+                0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,
+                0, 0, 1,  1, 0, 1,  1, 1, 1,  0, 1, 1,
+        };
+
+        // winding doesn't matter, queries are drawn without face culling
+        static const uint8_t faces[] = {
+                0, 1, 2,  0, 2, 3, // -z
+                4, 6, 5,  4, 7, 6, // +z
+                0, 4, 5,  0, 5, 1, // -y
+                3, 2, 6,  3, 6, 7, // +y
+                0, 3, 7,  0, 7, 4, // -x
+                1, 5, 6,  1, 6, 2, // +x
+        };
+
+        GLuint buffers[2];
+
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(2, buffers);
+
+        StateCache::BindVertexArray(vao);
+
+        StateCache::BindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+
+        StateCache::BindVertexArray(0);
+
+        return vao;
+    }
+
+    OcclusionQuery::OcclusionQuery()
+    {
+        glGenQueries(2, m_queries.data());
+    }
+
+    OcclusionQuery::~OcclusionQuery()
+    {
+        glDeleteQueries(2, m_queries.data());
+    }
+
+    void OcclusionQuery::Issue()
+    {
+        StateCache::BindVertexArray(CubeVao());
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, m_queries[m_current]);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, nullptr);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        m_issued[m_current] = true;
+    }
+
+    void OcclusionQuery::BeginConditional()
+    {
+        auto previous = m_current ^ 1;
+
+        if (!m_issued[previous]) {
+            return;
+        }
+
+        // only peek at the result, reading it before it's available would stall until the GPU catches up
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(m_queries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (available) {
+            GLuint passed;
+            glGetQueryObjectuiv(m_queries[previous], GL_QUERY_RESULT, &passed);
+            m_visible = passed != 0;
+        }
+
+        // with NO_WAIT the GPU draws anyway if it doesn't have the result yet, rather than waiting for it
+        glBeginConditionalRender(m_queries[previous], GL_QUERY_NO_WAIT);
+    }
+
+    void OcclusionQuery::EndConditional()
+    {
+        if (m_issued[m_current ^ 1]) {
+            glEndConditionalRender();
+        }
+    }
+
+    void OcclusionQuery::NextFrame()
+    {
+        m_current ^= 1;
+    }
+}
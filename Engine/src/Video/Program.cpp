@@ -1,11 +1,25 @@
 /// @file
 /// @author Victor Hermann "vitorhnn" Chiletto
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Util/FS.hpp"
 
 #include "Video/Program.hpp"
+#include "Video/GLExt.hpp"
+#include "Video/FrameUniformBuffer.hpp"
+#include "Video/LightBuffer.hpp"
+#include "Video/StateCache.hpp"
 
 namespace Engine::GL {
     Program::Program() : m_glid(glCreateProgram())
@@ -14,96 +28,524 @@ namespace Engine::GL {
 
     Program::~Program()
     {
-        glDeleteProgram(m_glid);
+        StateCache::DeleteProgram(m_glid);
     }
 
     void Program::Use()
     {
-        glUseProgram(m_glid);
+        if (m_linking) {
+            FinishLink();
+        }
+
+        StateCache::UseProgram(m_glid);
+    }
+
+    UniformStats Program::s_uniformStats;
+    ProgramCacheStats Program::s_cacheStats;
+    std::string Program::s_cacheDirectory = "shadercache";
+
+    /// Bytes one element of a uniform of the given type takes in the shadow copy, laid out the way glUniform* takes it
+    static size_t UniformTypeSize(GLenum type)
+    {
+        switch (type) {
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2:
+                return 8;
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3:
+                return 12;
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2:
+                return 16;
+            case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2:
+                return 24;
+            case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2:
+                return 32;
+            case GL_FLOAT_MAT3:
+                return 36;
+            case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3:
+                return 48;
+            case GL_FLOAT_MAT4:
+                return 64;
+            default:
+                // scalars and samplers
+                return 4;
+        }
+    }
+
+    void Program::AddUniform(const std::string& name, GLint location, size_t shadowOffset, size_t shadowSize)
+    {
+        UniformHandle handle(name);
+        auto mask = m_uniforms.size() - 1;
+
+        for (auto i = handle.hash & mask; ; i = (i + 1) & mask) {
+            auto& slot = m_uniforms[i];
+
+            if (slot.handle.hash == 0) {
+                slot = {handle, location, static_cast<uint32_t>(shadowOffset), static_cast<uint32_t>(shadowSize), false};
+                return;
+            }
+
+            // two names sharing both hashes and the length would silently alias, better to find out now
+            if (slot.handle == handle) {
+                if (slot.location != location) {
+                    throw std::runtime_error("uniform name hash collision on " + name);
+                }
+
+                return;
+            }
+        }
+    }
+
+    void Program::ReflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(m_glid, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(m_glid, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        struct Reflected {
+            std::string name;
+            GLint location;
+            size_t shadowOffset;
+            size_t shadowSize;
+        };
+
+        std::vector<Reflected> uniforms;
+        std::vector<GLchar> buffer(std::max(maxLength, 1));
+        size_t shadowSize = 0;
+
+        for (GLint i = 0; i < count; ++i) {
+            GLsizei length;
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(m_glid, i, static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+
+            std::string name(buffer.data(), length);
+            GLint location = glGetUniformLocation(m_glid, name.c_str());
+
+            // uniform block members don't have a location
+            if (location == -1) {
+                continue;
+            }
+
+            auto elementSize = UniformTypeSize(type);
+            uniforms.push_back({name, location, shadowSize, elementSize});
+
+            // arrays are reported as "name[0]", every element gets its own entry and "name" goes to the first one,
+            // all of them sharing one shadow copy of the whole array
+            if (auto bracket = name.rfind("[0]"); bracket != std::string::npos && bracket + 3 == name.size()) {
+                auto base = name.substr(0, bracket);
+                uniforms.push_back({base, location, shadowSize, elementSize * size});
+
+                for (GLint element = 1; element < size; ++element) {
+                    auto elementName = base + "[" + std::to_string(element) + "]";
+                    uniforms.push_back({elementName, glGetUniformLocation(m_glid, elementName.c_str()), shadowSize + element * elementSize, elementSize});
+                }
+            }
+
+            shadowSize += elementSize * size;
+        }
+
+        // at most half full, so probes stay short
+        size_t capacity = 16;
+        while (capacity < uniforms.size() * 2) {
+            capacity *= 2;
+        }
+
+        m_uniforms.assign(capacity, {});
+        m_shadow.assign(shadowSize, 0);
+
+        for (const auto& uniform : uniforms) {
+            AddUniform(uniform.name, uniform.location, uniform.shadowOffset, uniform.shadowSize);
+        }
+    }
+
+    Program::UniformSlot* Program::FindUniform(UniformHandle uniform)
+    {
+        if (m_uniforms.empty()) {
+            return nullptr;
+        }
+
+        auto mask = m_uniforms.size() - 1;
+
+        for (auto i = uniform.hash & mask; ; i = (i + 1) & mask) {
+            auto& slot = m_uniforms[i];
+
+            // a name that only shares the first hash keeps probing, it may not be in the program at all
+            if (slot.handle == uniform) {
+                return &slot;
+            }
+
+            if (slot.handle.hash == 0) {
+                return nullptr;
+            }
+        }
     }
 
-    GLint Program::GetUniformLocation(const std::string& uniform)
+    GLint Program::PrepareUpload(UniformHandle uniform, const void* value, size_t size)
     {
-        auto maybeLocation = m_uniforms.find(uniform);
+        auto slot = FindUniform(uniform);
+
+        if (slot == nullptr) {
+            return -1;
+        }
 
-        if (maybeLocation != m_uniforms.end()) {
-            return maybeLocation->second;
+        // more than the uniform holds, GL is going to reject it anyway
+        if (size > slot->shadowSize) {
+            s_uniformStats.uploads++;
+            return slot->location;
         }
 
-        GLint location = glGetUniformLocation(m_glid, uniform.c_str());
+        auto shadow = &m_shadow[slot->shadowOffset];
+
+        if (slot->valid && std::memcmp(shadow, value, size) == 0) {
+            s_uniformStats.skipped++;
+            return -1;
+        }
 
-        m_uniforms[uniform] = location;
+        std::memcpy(shadow, value, size);
 
-        return location;
+        // only a write covering the whole uniform tells us everything GL has for it
+        slot->valid = slot->valid || size == slot->shadowSize;
+        s_uniformStats.uploads++;
+
+        return slot->location;
     }
 
-    void Program::SetUniform(const std::string &uniform, const int value)
+    void Program::SetUniform(UniformHandle uniform, const int value)
     {
-        glUniform1i(GetUniformLocation(uniform), value);
+        if (auto location = PrepareUpload(uniform, &value, sizeof(value)); location != -1) {
+            glUniform1i(location, value);
+        }
     }
 
-    void Program::SetUniform(const std::string& uniform, const float value)
+    void Program::SetUniform(UniformHandle uniform, const float value)
     {
-        glUniform1f(GetUniformLocation(uniform), value);
+        if (auto location = PrepareUpload(uniform, &value, sizeof(value)); location != -1) {
+            glUniform1f(location, value);
+        }
     }
 
-    void Program::SetUniform(const std::string& uniform, const glm::vec4& vec)
+    void Program::SetUniform(UniformHandle uniform, const glm::vec2& vec)
     {
-        glUniform4fv(GetUniformLocation(uniform), 1, glm::value_ptr(vec));
+        if (auto location = PrepareUpload(uniform, glm::value_ptr(vec), sizeof(vec)); location != -1) {
+            glUniform2fv(location, 1, glm::value_ptr(vec));
+        }
     }
 
-    void Program::SetUniform(const std::string& uniform, const glm::vec3& vec)
+    void Program::SetUniform(UniformHandle uniform, const glm::vec4& vec)
     {
-        glUniform3fv(GetUniformLocation(uniform), 1, glm::value_ptr(vec));
+        if (auto location = PrepareUpload(uniform, glm::value_ptr(vec), sizeof(vec)); location != -1) {
+            glUniform4fv(location, 1, glm::value_ptr(vec));
+        }
     }
 
-    void Program::SetUniform(const std::string& uniform, const glm::mat3& mat)
+    void Program::SetUniform(UniformHandle uniform, const glm::vec3& vec)
     {
-        glUniformMatrix3fv(GetUniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(mat));
+        if (auto location = PrepareUpload(uniform, glm::value_ptr(vec), sizeof(vec)); location != -1) {
+            glUniform3fv(location, 1, glm::value_ptr(vec));
+        }
+    }
+
+    void Program::SetUniform(UniformHandle uniform, const glm::mat3& mat)
+    {
+        if (auto location = PrepareUpload(uniform, glm::value_ptr(mat), sizeof(mat)); location != -1) {
+            glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+        }
     }
 
-    void Program::SetUniform(const std::string& uniform, const glm::mat4& mat)
+    void Program::SetUniform(UniformHandle uniform, const glm::mat4& mat)
     {
-        glUniformMatrix4fv(GetUniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(mat));
+        if (auto location = PrepareUpload(uniform, glm::value_ptr(mat), sizeof(mat)); location != -1) {
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+        }
+    }
+
+    void Program::SetUniform(UniformHandle uniform, const glm::vec4* vecs, GLsizei count)
+    {
+        if (auto location = PrepareUpload(uniform, glm::value_ptr(vecs[0]), count * sizeof(glm::vec4)); location != -1) {
+            glUniform4fv(location, count, glm::value_ptr(vecs[0]));
+        }
     }
 
-    void Program::AttachShader(const char* path, ShaderType type)
+    void Program::AttachShader(const char* path, ShaderType type, const ShaderDefines& defines)
     {
         // magically read from somewhere (hint hint, implement FS::)
         auto vec = Util::FS::ReadAllBytes(path);
-        vec.push_back('\0');
-        const GLchar* source = vec.data();
+        std::string source(vec.begin(), vec.end());
 
-        GLenum gltype;
+        if (!defines.empty()) {
+            // #version has to stay the first thing in the file, anything after it can see the #defines.
+            // #line keeps the compiler's errors matching the file. Up to GLSL 4.10 the line after #line n is
+            // numbered n + 1, from 4.20 on it's numbered n
+            auto versionEnd = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos;
+            auto insertAt = versionEnd == std::string::npos ? 0 : versionEnd + 1;
+            auto version = insertAt == 0 ? 110 : std::atoi(source.c_str() + 8);
 
+            std::string injected;
+
+            for (const auto& [name, value] : defines) {
+                injected += "#define " + name + " " + value + "\n";
+            }
+
+            // the file's next line is its second when there's a #version, its first otherwise
+            auto nextLine = insertAt == 0 ? 1 : 2;
+            injected += "#line " + std::to_string(version >= 420 ? nextLine : nextLine - 1) + "\n";
+
+            source.insert(insertAt, injected);
+        }
+
+        m_sources.push_back({type, path, std::move(source)});
+    }
+
+    static GLenum ToGLType(ShaderType type)
+    {
         switch (type) {
             case ShaderType::Fragment:
-                gltype = GL_FRAGMENT_SHADER;
-                break;
+                return GL_FRAGMENT_SHADER;
             case ShaderType::Vertex:
-                gltype = GL_VERTEX_SHADER;
-                break;
+                return GL_VERTEX_SHADER;
+            case ShaderType::Compute:
+                return GL_COMPUTE_SHADER;
+        }
+
+        return GL_NONE;
+    }
+
+    void Program::CompileAndLink()
+    {
+        // asking for GL_COMPILE_STATUS here would wait on each compile in turn, a failed compile fails the link
+        // anyway, so the statuses only get looked at if it does
+        for (const auto& shader : m_sources) {
+            const GLchar* source = shader.source.c_str();
+
+            GLuint id = glCreateShader(ToGLType(shader.type));
+            glShaderSource(id, 1, &source, nullptr);
+            glCompileShader(id);
+
+            glAttachShader(m_glid, id);
+            glDeleteShader(id);
+
+            m_shaders.push_back(id);
+        }
+
+        if (Ext::ProgramParameteri != nullptr) {
+            Ext::ProgramParameteri(m_glid, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        glLinkProgram(m_glid);
+    }
+
+    void Program::ThrowLinkError()
+    {
+        GLchar message[1024];
+        GLsizei length = 0;
+
+        for (size_t i = 0; i < m_shaders.size(); ++i) {
+            GLint compiled;
+            glGetShaderiv(m_shaders[i], GL_COMPILE_STATUS, &compiled);
+
+            if (compiled != GL_TRUE) {
+                glGetShaderInfoLog(m_shaders[i], sizeof(message), &length, message);
+                throw std::runtime_error("Shader compilation failed (" + m_sources[i].path + "): " + std::string(message, length));
+            }
+        }
+
+        glGetProgramInfoLog(m_glid, sizeof(message), &length, message);
+        throw std::runtime_error("Program link failed: " + std::string(message, length));
+    }
+
+    std::string Program::GetCachePath() const
+    {
+        if (s_cacheDirectory.empty() || Ext::ProgramBinary == nullptr || Ext::GetProgramBinary == nullptr) {
+            return {};
+        }
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+        if (formats == 0) {
+            return {};
+        }
+
+        // binaries only load on the driver that made them, and only for the exact same sources (64-bit FNV-1a)
+        uint64_t hash = 14695981039346656037ull;
+
+        auto add = [&hash](const void* data, size_t size) {
+            for (size_t i = 0; i < size; ++i) {
+                hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * 1099511628211ull;
+            }
+        };
+
+        for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            auto string = reinterpret_cast<const char*>(glGetString(name));
+            add(string, std::strlen(string) + 1);
+        }
+
+        for (const auto& shader : m_sources) {
+            add(&shader.type, sizeof(shader.type));
+            add(shader.source.data(), shader.source.size() + 1);
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.bin", static_cast<unsigned long long>(hash));
+
+        return s_cacheDirectory + name;
+    }
+
+    bool Program::LoadBinary(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        char magic[4];
+        GLenum format;
+
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, "PGB1", 4) != 0 ||
+            !file.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+            return false;
         }
 
-        GLuint id = glCreateShader(gltype);
-        glShaderSource(id, 1, &source, nullptr);
-        glCompileShader(id);
+        std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
-        GLint compiled;
-        glGetShaderiv(id, GL_COMPILE_STATUS, &compiled);
-        if (compiled != GL_TRUE) {
-            GLsizei sz;
-            GLchar message[1024];
-            glGetShaderInfoLog(id, 1024, &sz, message);
-            throw std::runtime_error(std::string("Shader compilation failed") + message);
+        // a driver update can drop the format the binary was saved in
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+        std::vector<GLint> formats(formatCount);
+        glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+
+        if (std::find(formats.begin(), formats.end(), static_cast<GLint>(format)) == formats.end()) {
+            return false;
         }
 
-        glAttachShader(m_glid, id);
-        glDeleteShader(id);
+        Ext::ProgramBinary(m_glid, format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+        // the driver can still refuse it, for reasons of its own
+        GLint linked;
+        glGetProgramiv(m_glid, GL_LINK_STATUS, &linked);
+
+        return linked == GL_TRUE;
+    }
+
+    void Program::SaveBinary(const std::string& path) const
+    {
+        GLint linked, length = 0;
+        glGetProgramiv(m_glid, GL_LINK_STATUS, &linked);
+        glGetProgramiv(m_glid, GL_PROGRAM_BINARY_LENGTH, &length);
+
+        if (linked != GL_TRUE || length == 0) {
+            return;
+        }
+
+        std::vector<char> binary(length);
+        GLenum format;
+        Ext::GetProgramBinary(m_glid, length, nullptr, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(s_cacheDirectory, error);
+
+        // a cache that can't be written just means compiling again next time
+        std::ofstream file(path, std::ios::binary);
+        file.write("PGB1", 4);
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        file.write(binary.data(), binary.size());
     }
 
     void Program::Link()
     {
-        glLinkProgram(m_glid);
+        BeginLink();
+        FinishLink();
+    }
+
+    void Program::BeginLink()
+    {
+        auto start = std::chrono::steady_clock::now();
+        m_cachePath = GetCachePath();
+
+        if (!m_cachePath.empty() && LoadBinary(m_cachePath)) {
+            s_cacheStats.loaded++;
+            m_cachePath.clear();
+        } else {
+            CompileAndLink();
+            s_cacheStats.compiled++;
+        }
+
+        m_linking = true;
+
+        s_cacheStats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool Program::IsReady() const
+    {
+        if (!m_linking || Ext::MaxShaderCompilerThreads == nullptr) {
+            return true;
+        }
+
+        GLint done = GL_FALSE;
+        glGetProgramiv(m_glid, GL_COMPLETION_STATUS_KHR, &done);
+
+        return done == GL_TRUE;
+    }
+
+    void Program::FinishLink()
+    {
+        if (!m_linking) {
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        m_linking = false;
+
+        // this is where the wait happens, if the driver isn't done yet
+        GLint linked;
+        glGetProgramiv(m_glid, GL_LINK_STATUS, &linked);
+
+        if (linked != GL_TRUE) {
+            ThrowLinkError();
+        }
+
+        for (auto shader : m_shaders) {
+            glDetachShader(m_glid, shader);
+        }
+
+        m_shaders.clear();
+
+        if (!m_cachePath.empty()) {
+            SaveBinary(m_cachePath);
+        }
+
+        // nothing needs the sources past this point
+        m_sources.clear();
+
+        // shaders can't pick a block binding themselves before 4.20
+        GLuint frameBlock = glGetUniformBlockIndex(m_glid, "FrameData");
+
+        if (frameBlock != GL_INVALID_INDEX) {
+            glUniformBlockBinding(m_glid, frameBlock, FrameUniformBuffer::BINDING);
+        }
+
+        GLuint lightBlock = glGetUniformBlockIndex(m_glid, "PointLights");
+
+        if (lightBlock != GL_INVALID_INDEX) {
+            glUniformBlockBinding(m_glid, lightBlock, LightBuffer::BINDING);
+        }
+
+        ReflectUniforms();
+
+        s_cacheStats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Program::LinkAll(std::initializer_list<Program*> programs)
+    {
+        for (auto program : programs) {
+            program->BeginLink();
+        }
+
+        for (auto program : programs) {
+            program->FinishLink();
+        }
+    }
+
+    void Program::Dispatch(GLuint groupsX, GLuint groupsY, GLuint groupsZ)
+    {
+        Use();
+        Ext::DispatchCompute(groupsX, groupsY, groupsZ);
     }
 }
\ No newline at end of file
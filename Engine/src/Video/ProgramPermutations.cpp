@@ -0,0 +1,82 @@
+#include "Video/ProgramPermutations.hpp"
+
+#include <algorithm>
+
+namespace Engine::GL {
+    void ProgramPermutations::AttachShader(const char* path, ShaderType type)
+    {
+        m_stages.push_back({path, type});
+    }
+
+    void ProgramPermutations::Submit(const ShaderDefines& defines, Variant& variant)
+    {
+        variant.program = std::make_unique<Program>();
+
+        for (const auto& stage : m_stages) {
+            variant.program->AttachShader(stage.path.c_str(), stage.type, defines);
+        }
+
+        variant.program->BeginLink();
+        m_pending++;
+    }
+
+    Program& ProgramPermutations::Build(const ShaderDefines& defines)
+    {
+        auto& variant = m_variants[defines];
+
+        if (variant.ready) {
+            return *variant.program;
+        }
+
+        if (!variant.program) {
+            // it may have been queued already, it won't need building twice
+            m_queue.erase(std::remove(m_queue.begin(), m_queue.end(), defines), m_queue.end());
+
+            Submit(defines, variant);
+        }
+
+        variant.program->FinishLink();
+        variant.ready = true;
+        m_pending--;
+
+        return *variant.program;
+    }
+
+    Program* ProgramPermutations::Find(const ShaderDefines& defines)
+    {
+        auto [search, inserted] = m_variants.try_emplace(defines);
+
+        if (inserted) {
+            m_queue.push_back(defines);
+        }
+
+        return search->second.ready ? search->second.program.get() : nullptr;
+    }
+
+    void ProgramPermutations::Update(size_t maxFinishes)
+    {
+        // submitted all at once, so the driver can work on them side by side
+        for (const auto& defines : m_queue) {
+            Submit(defines, m_variants[defines]);
+        }
+
+        m_queue.clear();
+
+        size_t finished = 0;
+
+        for (auto& [defines, variant] : m_variants) {
+            if (finished == maxFinishes || m_pending == 0) {
+                break;
+            }
+
+            if (variant.ready || !variant.program->IsReady()) {
+                continue;
+            }
+
+            variant.program->FinishLink();
+            variant.ready = true;
+            m_pending--;
+            finished++;
+        }
+    }
+}
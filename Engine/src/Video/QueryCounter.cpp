@@ -0,0 +1,57 @@
+#include "Video/QueryCounter.hpp"
+
+namespace Engine::GL {
+    QueryCounter::~QueryCounter()
+    {
+        for (auto& queries : m_issued) {
+            glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+        }
+
+        glDeleteQueries(static_cast<GLsizei>(m_free.size()), m_free.data());
+    }
+
+    void QueryCounter::Begin()
+    {
+        GLuint query;
+
+        if (m_free.empty()) {
+            glGenQueries(1, &query);
+        } else {
+            query = m_free.back();
+            m_free.pop_back();
+        }
+
+        m_issued[m_frame].push_back(query);
+        glBeginQuery(m_target, query);
+    }
+
+    void QueryCounter::End()
+    {
+        glEndQuery(m_target);
+    }
+
+    void QueryCounter::NextFrame()
+    {
+        m_frame = (m_frame + 1) % FRAMES_IN_FLIGHT;
+
+        // this slot is about to be reused, its queries were issued FRAMES_IN_FLIGHT - 1 frames ago and are
+        // almost certainly done, so reading them shouldn't stall
+        auto& oldest = m_issued[m_frame];
+
+        if (oldest.empty()) {
+            return;
+        }
+
+        for (auto query : oldest) {
+            // 32 bits of nanoseconds run out after 4 seconds
+            GLuint64 result = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+            m_total += result;
+        }
+
+        m_frames++;
+
+        m_free.insert(m_free.end(), oldest.begin(), oldest.end());
+        oldest.clear();
+    }
+}
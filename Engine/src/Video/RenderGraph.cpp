@@ -0,0 +1,579 @@
+#include "Video/RenderGraph.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+namespace Engine::GL {
+    struct TextureFormat {
+        size_t bytes;
+        GLenum format;
+        GLenum type;
+        GLenum attachment;
+        bool filterable;
+    };
+
+    /// What glTexImage2D needs to allocate a texture of the format, its size and where it gets attached.
+    /// Throws on formats the graph doesn't know
+    static TextureFormat GetFormat(GLenum internalFormat)
+    {
+        switch (internalFormat) {
+            case GL_R8: return {1, GL_RED, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, true};
+            case GL_RG8: return {2, GL_RG, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, true};
+            // drivers pad it to 4 bytes
+            case GL_RGB8: return {4, GL_RGB, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, true};
+            case GL_RGBA8: return {4, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, true};
+            case GL_R16F: return {2, GL_RED, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT0, true};
+            case GL_RG16F: return {4, GL_RG, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT0, true};
+            case GL_RGBA16F: return {8, GL_RGBA, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT0, true};
+            case GL_R11F_G11F_B10F: return {4, GL_RGB, GL_FLOAT, GL_COLOR_ATTACHMENT0, true};
+            case GL_R32F: return {4, GL_RED, GL_FLOAT, GL_COLOR_ATTACHMENT0, true};
+            case GL_RG32F: return {8, GL_RG, GL_FLOAT, GL_COLOR_ATTACHMENT0, true};
+            case GL_RGBA32F: return {16, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT0, true};
+            case GL_R32UI: return {4, GL_RED_INTEGER, GL_UNSIGNED_INT, GL_COLOR_ATTACHMENT0, false};
+            case GL_RG32UI: return {8, GL_RG_INTEGER, GL_UNSIGNED_INT, GL_COLOR_ATTACHMENT0, false};
+            case GL_DEPTH_COMPONENT24: return {4, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, GL_DEPTH_ATTACHMENT, false};
+            case GL_DEPTH_COMPONENT32F: return {4, GL_DEPTH_COMPONENT, GL_FLOAT, GL_DEPTH_ATTACHMENT, false};
+            case GL_DEPTH24_STENCIL8: return {4, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT, false};
+            case GL_DEPTH32F_STENCIL8:
+                return {8, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, GL_DEPTH_STENCIL_ATTACHMENT, false};
+            default:
+                throw std::runtime_error("RenderGraph: unsupported texture format " + std::to_string(internalFormat));
+        }
+    }
+
+    RenderResource RenderPassBuilder::Read(RenderResource resource)
+    {
+        m_graph.AddAccess(m_pass, resource, false);
+        return resource;
+    }
+
+    RenderResource RenderPassBuilder::Write(RenderResource resource)
+    {
+        m_graph.AddAccess(m_pass, resource, true);
+        return resource;
+    }
+
+    void RenderPassBuilder::SetSideEffect()
+    {
+        m_graph.m_passes[m_pass].sideEffect = true;
+    }
+
+    RenderGraph::~RenderGraph()
+    {
+        for (auto& [attachments, framebuffer] : m_framebuffers) {
+            glDeleteFramebuffers(1, &framebuffer);
+        }
+
+        for (auto& pooled : m_pool) {
+            StateCache::DeleteTextures(1, &pooled.texture);
+        }
+    }
+
+    void RenderGraph::Reset()
+    {
+        m_resources.clear();
+        m_passes.clear();
+        m_order.clear();
+        m_accesses.clear();
+        m_compiled = false;
+    }
+
+    uint32_t RenderGraph::AddResource(const std::string& name, ResourceType type, const RenderTextureDesc& desc, GLuint object)
+    {
+        m_resources.push_back({name, type, desc, object});
+        m_accesses.emplace_back();
+
+        return static_cast<uint32_t>(m_resources.size() - 1);
+    }
+
+    RenderResource RenderGraph::CreateTexture(const std::string& name, const RenderTextureDesc& desc)
+    {
+        GetFormat(desc.internalFormat);
+
+        if (desc.width <= 0 || desc.height <= 0) {
+            throw std::runtime_error("RenderGraph: " + name + " has no size");
+        }
+
+        return {AddResource(name, ResourceType::Transient, desc, 0)};
+    }
+
+    RenderResource RenderGraph::ImportTexture(const std::string& name, GLuint texture, const RenderTextureDesc& desc)
+    {
+        return {AddResource(name, ResourceType::ImportedTexture, desc, texture)};
+    }
+
+    void RenderGraph::ForgetTexture(GLuint texture)
+    {
+        EvictFramebuffers(texture);
+        m_imports.erase(texture);
+    }
+
+    RenderResource RenderGraph::ImportBuffer(const std::string& name, GLuint buffer)
+    {
+        return {AddResource(name, ResourceType::ImportedBuffer, {GL_NONE, 0, 0}, buffer)};
+    }
+
+    RenderResource RenderGraph::ImportBackbuffer()
+    {
+        return {AddResource("backbuffer", ResourceType::Backbuffer, {GL_NONE, 0, 0}, 0)};
+    }
+
+    void RenderGraph::AddAccess(uint32_t pass, RenderResource resource, bool write)
+    {
+        if (resource.index >= m_resources.size()) {
+            throw std::runtime_error("RenderGraph: " + m_passes[pass].name + " uses a resource from another frame");
+        }
+
+        auto& accesses = m_accesses[resource.index];
+        auto& reads = m_passes[pass].reads;
+        auto& writes = m_passes[pass].writes;
+
+        // a pass both reading and writing a resource is one write, the attachment keeps what was in it
+        for (auto& access : accesses) {
+            if (access.pass == pass) {
+                if (write && !access.write) {
+                    access.write = true;
+                    reads.erase(std::find(reads.begin(), reads.end(), resource.index));
+                    writes.push_back(resource.index);
+                }
+
+                return;
+            }
+        }
+
+        accesses.push_back({pass, write});
+        (write ? writes : reads).push_back(resource.index);
+    }
+
+    void RenderGraph::AddPass(const std::string& name, const SetupFunction& setup, ExecuteFunction execute)
+    {
+        m_passes.push_back({name, std::move(execute)});
+        m_compiled = false;
+
+        RenderPassBuilder builder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+        setup(builder);
+    }
+
+    void RenderGraph::Cull()
+    {
+        for (auto& pass : m_passes) {
+            pass.dependencies.clear();
+            pass.live = false;
+        }
+
+        // inputs are what a pass needs to have run for its result, the rest of the dependencies only order it
+        // after the passes reading what it's about to overwrite
+        std::vector<std::vector<uint32_t>> inputs(m_passes.size());
+
+        for (uint32_t r = 0; r < m_resources.size(); ++r) {
+            const auto& accesses = m_accesses[r];
+            const auto& resource = m_resources[r];
+
+            // the access whose write the access at i sees: the last write before it, or for transients, which have
+            // nothing in them to begin with, the first one after. Imported resources come with what's in them
+            auto producer = [&](size_t i) {
+                for (size_t j = i; j-- > 0;) {
+                    if (accesses[j].write) {
+                        return j;
+                    }
+                }
+
+                for (size_t j = i + 1; resource.type == ResourceType::Transient && j < accesses.size(); ++j) {
+                    if (accesses[j].write) {
+                        return j;
+                    }
+                }
+
+                return accesses.size();
+            };
+
+            for (size_t i = 0; i < accesses.size(); ++i) {
+                auto& pass = m_passes[accesses[i].pass];
+
+                if (!accesses[i].write) {
+                    auto from = producer(i);
+
+                    if (from < accesses.size()) {
+                        inputs[accesses[i].pass].push_back(accesses[from].pass);
+                    } else if (resource.type == ResourceType::Transient) {
+                        throw std::runtime_error("RenderGraph: " + pass.name + " reads " + resource.name + " which nothing writes");
+                    }
+
+                    continue;
+                }
+
+                pass.sideEffect = pass.sideEffect || resource.type != ResourceType::Transient;
+
+                // the write before this one has to have run, it's what the attachment starts out with, and so do
+                // the reads of anything written before, or of what an imported resource came with
+                bool previous = false;
+
+                for (size_t j = i; j-- > 0;) {
+                    if (accesses[j].write && !previous) {
+                        inputs[accesses[i].pass].push_back(accesses[j].pass);
+                        previous = true;
+                    } else if (!accesses[j].write && (producer(j) < i ||
+                               (resource.type != ResourceType::Transient && producer(j) == accesses.size()))) {
+                        pass.dependencies.push_back(accesses[j].pass);
+                    }
+                }
+            }
+        }
+
+        std::vector<uint32_t> stack;
+
+        for (uint32_t p = 0; p < m_passes.size(); ++p) {
+            auto& pass = m_passes[p];
+            pass.dependencies.insert(pass.dependencies.end(), inputs[p].begin(), inputs[p].end());
+
+            if (pass.sideEffect) {
+                pass.live = true;
+                stack.push_back(p);
+            }
+        }
+
+        while (!stack.empty()) {
+            auto p = stack.back();
+            stack.pop_back();
+
+            for (auto input : inputs[p]) {
+                if (!m_passes[input].live) {
+                    m_passes[input].live = true;
+                    stack.push_back(input);
+                }
+            }
+        }
+    }
+
+    void RenderGraph::Sort()
+    {
+        // Kahn's algorithm over the live passes, the first declared of the ready ones goes next
+        std::vector<size_t> waiting(m_passes.size(), 0);
+        std::vector<std::vector<uint32_t>> dependents(m_passes.size());
+        std::set<uint32_t> ready;
+        size_t live = 0;
+
+        for (uint32_t p = 0; p < m_passes.size(); ++p) {
+            auto& pass = m_passes[p];
+
+            if (!pass.live) {
+                continue;
+            }
+
+            live++;
+            std::sort(pass.dependencies.begin(), pass.dependencies.end());
+            pass.dependencies.erase(std::unique(pass.dependencies.begin(), pass.dependencies.end()), pass.dependencies.end());
+
+            for (auto dependency : pass.dependencies) {
+                if (dependency != p && m_passes[dependency].live) {
+                    waiting[p]++;
+                    dependents[dependency].push_back(p);
+                }
+            }
+
+            if (waiting[p] == 0) {
+                ready.insert(p);
+            }
+        }
+
+        m_order.clear();
+
+        while (!ready.empty()) {
+            auto p = *ready.begin();
+            ready.erase(ready.begin());
+            m_order.push_back(p);
+
+            for (auto dependent : dependents[p]) {
+                if (--waiting[dependent] == 0) {
+                    ready.insert(dependent);
+                }
+            }
+        }
+
+        if (m_order.size() != live) {
+            throw std::runtime_error("RenderGraph: the passes depend on each other in a cycle");
+        }
+    }
+
+    void RenderGraph::AssignTextures()
+    {
+        for (size_t position = 0; position < m_order.size(); ++position) {
+            const auto& pass = m_passes[m_order[position]];
+
+            for (const auto* list : {&pass.reads, &pass.writes}) {
+                for (auto r : *list) {
+                    auto& resource = m_resources[r];
+                    resource.first = std::min(resource.first, position);
+                    resource.last = std::max(resource.last, position);
+                }
+            }
+        }
+
+        std::vector<uint32_t> transients;
+
+        for (uint32_t r = 0; r < m_resources.size(); ++r) {
+            if (m_resources[r].type == ResourceType::Transient && m_resources[r].first <= m_resources[r].last) {
+                transients.push_back(r);
+            }
+        }
+
+        std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) {
+            return m_resources[a].first < m_resources[b].first;
+        });
+
+        m_stats.transientTextures = transients.size();
+
+        // the first pooled texture of the same description that's free by the time the resource is first used,
+        // which has to be the texture of a resource whose last use is over
+        for (auto r : transients) {
+            auto& resource = m_resources[r];
+            auto format = GetFormat(resource.desc.internalFormat);
+            auto bytes = format.bytes * resource.desc.width * resource.desc.height;
+            PooledTexture* match = nullptr;
+
+            m_stats.transientBytes += bytes;
+
+            for (auto& pooled : m_pool) {
+                if (pooled.desc == resource.desc && (pooled.lastFrame != m_frame || pooled.busyUntil < resource.first)) {
+                    match = &pooled;
+                    break;
+                }
+            }
+
+            if (!match) {
+                GLuint texture;
+                auto filter = format.filterable ? GL_LINEAR : GL_NEAREST;
+
+                glGenTextures(1, &texture);
+                StateCache::BindTexture(0, texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, resource.desc.internalFormat, resource.desc.width, resource.desc.height, 0,
+                             format.format, format.type, nullptr);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+                m_pool.push_back({resource.desc, texture, bytes, m_frame - 1, 0});
+                match = &m_pool.back();
+            }
+
+            if (match->lastFrame != m_frame) {
+                match->lastFrame = m_frame;
+                m_stats.allocatedTextures++;
+                m_stats.allocatedBytes += match->bytes;
+            }
+
+            match->busyUntil = resource.last;
+            resource.object = match->texture;
+        }
+
+        for (const auto& pooled : m_pool) {
+            m_stats.pooledBytes += pooled.bytes;
+        }
+    }
+
+    void RenderGraph::Compile()
+    {
+        m_frame++;
+        m_stats = {};
+
+        Cull();
+        Sort();
+
+        for (auto p : m_order) {
+            const auto& pass = m_passes[p];
+            const RenderTextureDesc* size = nullptr;
+            bool backbuffer = false;
+
+            for (auto r : pass.writes) {
+                const auto& resource = m_resources[r];
+
+                if (resource.type == ResourceType::Backbuffer) {
+                    backbuffer = true;
+                } else if (resource.type != ResourceType::ImportedBuffer) {
+                    if (size && (size->width != resource.desc.width || size->height != resource.desc.height)) {
+                        throw std::runtime_error("RenderGraph: " + pass.name + " writes textures of different sizes");
+                    }
+
+                    size = &resource.desc;
+                }
+            }
+
+            if (backbuffer && size) {
+                throw std::runtime_error("RenderGraph: " + pass.name + " writes the backbuffer and textures");
+            }
+        }
+
+        AssignTextures();
+        UpdateImports();
+
+        m_stats.passes = m_passes.size();
+        m_stats.culledPasses = m_passes.size() - m_order.size();
+        m_compiled = true;
+    }
+
+    void RenderGraph::BindFramebuffer(const Pass& pass, const GLint* viewport)
+    {
+        std::vector<GLuint> colors;
+        GLuint depth = 0;
+        GLenum depthAttachment = GL_NONE;
+        const RenderTextureDesc* size = nullptr;
+
+        for (auto r : pass.writes) {
+            const auto& resource = m_resources[r];
+
+            if (resource.type != ResourceType::Transient && resource.type != ResourceType::ImportedTexture) {
+                continue;
+            }
+
+            auto attachment = GetFormat(resource.desc.internalFormat).attachment;
+
+            if (attachment == GL_COLOR_ATTACHMENT0) {
+                colors.push_back(resource.object);
+            } else {
+                depth = resource.object;
+                depthAttachment = attachment;
+            }
+
+            size = &resource.desc;
+        }
+
+        // writes nothing it can render to, the backbuffer or buffers only
+        if (!size) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+            return;
+        }
+
+        auto key = colors;
+        key.push_back(depth);
+
+        auto found = m_framebuffers.find(key);
+
+        if (found != m_framebuffers.end()) {
+            glBindFramebuffer(GL_FRAMEBUFFER, found->second);
+        } else {
+            GLuint framebuffer;
+            std::vector<GLenum> drawBuffers;
+
+            glGenFramebuffers(1, &framebuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+            for (size_t i = 0; i < colors.size(); ++i) {
+                drawBuffers.push_back(static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i));
+                glFramebufferTexture2D(GL_FRAMEBUFFER, drawBuffers.back(), GL_TEXTURE_2D, colors[i], 0);
+            }
+
+            if (depth) {
+                glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+            }
+
+            if (drawBuffers.empty()) {
+                glDrawBuffer(GL_NONE);
+            } else {
+                glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+            }
+
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                throw std::runtime_error("RenderGraph: framebuffer of " + pass.name + " incomplete");
+            }
+
+            m_framebuffers.emplace(std::move(key), framebuffer);
+        }
+
+        glViewport(0, 0, size->width, size->height);
+    }
+
+    void RenderGraph::EvictFramebuffers(GLuint texture)
+    {
+        for (auto fb = m_framebuffers.begin(); fb != m_framebuffers.end();) {
+            if (std::find(fb->first.begin(), fb->first.end(), texture) != fb->first.end()) {
+                glDeleteFramebuffers(1, &fb->second);
+                fb = m_framebuffers.erase(fb);
+            } else {
+                ++fb;
+            }
+        }
+    }
+
+    void RenderGraph::UpdateImports()
+    {
+        std::map<GLuint, RenderTextureDesc> imports;
+
+        for (const auto& resource : m_resources) {
+            if (resource.type == ResourceType::ImportedTexture) {
+                imports.emplace(resource.object, resource.desc);
+            }
+        }
+
+        // an import that went away may get deleted and its name reused, one that changed description has been
+        // reallocated already
+        for (const auto& [texture, desc] : m_imports) {
+            auto found = imports.find(texture);
+
+            if (found == imports.end() || !(found->second == desc)) {
+                EvictFramebuffers(texture);
+            }
+        }
+
+        m_imports = std::move(imports);
+    }
+
+    void RenderGraph::ReleaseUnused()
+    {
+        for (auto it = m_pool.begin(); it != m_pool.end();) {
+            if (m_frame - it->lastFrame < POOL_FRAMES) {
+                ++it;
+                continue;
+            }
+
+            EvictFramebuffers(it->texture);
+            StateCache::DeleteTextures(1, &it->texture);
+            it = m_pool.erase(it);
+        }
+    }
+
+    void RenderGraph::Execute()
+    {
+        if (!m_compiled) {
+            Compile();
+        }
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        for (auto p : m_order) {
+            const auto& pass = m_passes[p];
+
+            BindFramebuffer(pass, viewport);
+            pass.execute(*this);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+        ReleaseUnused();
+    }
+
+    GLuint RenderGraph::GetTexture(RenderResource resource) const
+    {
+        if (resource.index >= m_resources.size()) {
+            throw std::runtime_error("RenderGraph: resource from another frame");
+        }
+
+        return m_resources[resource.index].object;
+    }
+
+    std::vector<std::string> RenderGraph::GetExecutionOrder() const
+    {
+        std::vector<std::string> names;
+
+        for (auto p : m_order) {
+            names.push_back(m_passes[p].name);
+        }
+
+        return names;
+    }
+}
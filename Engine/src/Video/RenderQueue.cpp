@@ -0,0 +1,189 @@
+#include "Video/RenderQueue.hpp"
+#include "Video/StateCache.hpp"
+
+#include <cstring>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace Engine::GL {
+    // key layout, from the most significant bit down
+    static constexpr int PASS_SHIFT = 62;       // 2 bits
+    static constexpr int PROGRAM_BITS = 10;
+    static constexpr int MATERIAL_BITS = 16;
+    static constexpr int DEPTH_BITS = 24;
+
+    static constexpr UniformHandle MODEL_UNIFORM = "model"_u;
+    static constexpr UniformHandle INV_MODEL_UNIFORM = "invModel"_u;
+
+    /// Non-negative floats sort the same as their bit patterns, so the top bits make a coarse depth that keeps the order
+    static uint64_t QuantizeDepth(float distance)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &distance, sizeof(bits));
+
+        return bits >> (32 - DEPTH_BITS);
+    }
+
+    void RenderQueue::Begin(const glm::mat4& projectionView, const glm::vec3& cameraPosition)
+    {
+        m_items.clear();
+        m_entries.clear();
+
+        m_projectionView = projectionView;
+        m_cameraPosition = cameraPosition;
+    }
+
+    void RenderQueue::Submit(Mesh& mesh, Program& program, const glm::mat4& model, RenderPass pass, bool cullMeshlets)
+    {
+        auto programId = m_programIds.emplace(&program, static_cast<uint32_t>(m_programIds.size())).first->second;
+        auto materialId = m_materialIds.emplace(mesh.GetTextures(), static_cast<uint32_t>(m_materialIds.size())).first->second;
+
+        auto center = glm::vec3(model * glm::vec4(mesh.GetSphereCenter(), 1.0f));
+        auto depth = QuantizeDepth(glm::distance(center, m_cameraPosition));
+
+        uint64_t programBits = programId & ((1u << PROGRAM_BITS) - 1);
+        uint64_t materialBits = materialId & ((1u << MATERIAL_BITS) - 1);
+        uint64_t key = static_cast<uint64_t>(pass) << PASS_SHIFT;
+
+        if (pass == RenderPass::Depth) {
+            // textures don't matter to depth
+            key |= programBits << (PASS_SHIFT - PROGRAM_BITS);
+            key |= depth << (PASS_SHIFT - PROGRAM_BITS - MATERIAL_BITS - DEPTH_BITS);
+        } else if (pass != RenderPass::Transparent) {
+            key |= programBits << (PASS_SHIFT - PROGRAM_BITS);
+            key |= materialBits << (PASS_SHIFT - PROGRAM_BITS - MATERIAL_BITS);
+            key |= depth << (PASS_SHIFT - PROGRAM_BITS - MATERIAL_BITS - DEPTH_BITS);
+        } else {
+            // farthest first
+            auto inverted = ~depth & ((1u << DEPTH_BITS) - 1);
+
+            key |= inverted << (PASS_SHIFT - DEPTH_BITS);
+            key |= programBits << (PASS_SHIFT - DEPTH_BITS - PROGRAM_BITS);
+            key |= materialBits << (PASS_SHIFT - DEPTH_BITS - PROGRAM_BITS - MATERIAL_BITS);
+        }
+
+        m_entries.push_back({key, static_cast<uint32_t>(m_items.size())});
+        m_items.push_back({&mesh, &program, materialId, pass, cullMeshlets, model});
+    }
+
+    void RenderQueue::ApplyPassState(RenderPass pass)
+    {
+        bool depth = pass == RenderPass::Depth;
+        bool equal = pass == RenderPass::OpaqueEqual;
+
+        glColorMask(!depth, !depth, !depth, !depth);
+        glDepthMask(equal ? GL_FALSE : GL_TRUE);
+        glDepthFunc(equal ? GL_EQUAL : GL_LESS);
+    }
+
+    void RenderQueue::RadixSort()
+    {
+        m_scratch.resize(m_entries.size());
+
+        // least significant byte first, each pass is stable so the earlier ones keep their order within a bucket
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t counts[256] = {};
+
+            for (const auto& entry : m_entries) {
+                counts[(entry.key >> shift) & 0xff]++;
+            }
+
+            // every key has the same byte here, the pass wouldn't move anything
+            if (counts[(m_entries[0].key >> shift) & 0xff] == m_entries.size()) {
+                continue;
+            }
+
+            size_t offset = 0;
+
+            for (auto& count : counts) {
+                auto bucketSize = count;
+                count = offset;
+                offset += bucketSize;
+            }
+
+            for (const auto& entry : m_entries) {
+                m_scratch[counts[(entry.key >> shift) & 0xff]++] = entry;
+            }
+
+            std::swap(m_entries, m_scratch);
+        }
+    }
+
+    void RenderQueue::Execute(RenderStats& stats, DrawStats& drawStats)
+    {
+        if (m_items.empty()) {
+            return;
+        }
+
+        // what drawing the items as they came in would have cost, for comparison
+        for (size_t i = 0; i < m_items.size(); ++i) {
+            if (i == 0 || m_items[i].program != m_items[i - 1].program) stats.unsortedChanges++;
+            if (i == 0 || m_items[i].material != m_items[i - 1].material) stats.unsortedChanges++;
+            if (i == 0 || m_items[i].mesh != m_items[i - 1].mesh) stats.unsortedChanges++;
+        }
+
+        RadixSort();
+
+        Program* program = nullptr;
+        Mesh* geometry = nullptr;
+        auto material = ~0u;
+        auto pass = RenderPass::Opaque;
+
+        for (const auto& entry : m_entries) {
+            auto& item = m_items[entry.item];
+
+            if (item.pass != pass) {
+                pass = item.pass;
+                ApplyPassState(pass);
+
+                // the depth pass has its own vaos
+                geometry = nullptr;
+            }
+
+            if (item.program != program) {
+                program = item.program;
+                program->Use();
+                stats.programChanges++;
+            }
+
+            if (item.material != material && pass != RenderPass::Depth) {
+                material = item.material;
+                item.mesh->BindMaterial();
+                stats.materialChanges++;
+            }
+
+            if (item.mesh != geometry) {
+                geometry = item.mesh;
+
+                if (pass == RenderPass::Depth) {
+                    geometry->BindDepthGeometry();
+                } else {
+                    geometry->BindGeometry();
+                }
+
+                stats.geometryChanges++;
+            }
+
+            program->SetUniform(MODEL_UNIFORM, item.model);
+            program->SetUniform(INV_MODEL_UNIFORM, glm::inverseTranspose(glm::mat3(item.model)));
+
+            if (item.cullMeshlets) {
+                Util::Frustum frustum(m_projectionView * item.model);
+                auto localCamera = glm::vec3(glm::inverse(item.model) * glm::vec4(m_cameraPosition, 1.0f));
+
+                item.mesh->DrawCulledBound(frustum, localCamera, drawStats);
+            } else {
+                drawStats.trianglesTotal += item.mesh->GetIndexCount() / 3;
+                drawStats.trianglesDrawn += item.mesh->GetTriangleCount();
+
+                item.mesh->DrawBound();
+            }
+
+            stats.draws++;
+        }
+
+        if (pass != RenderPass::Opaque) {
+            ApplyPassState(RenderPass::Opaque);
+        }
+    }
+}
@@ -0,0 +1,205 @@
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+
+namespace Engine::GL {
+    // a fresh context has nothing bound and these all disabled, anything else starts out unknown
+    GLuint StateCache::s_program = 0;
+    GLuint StateCache::s_vertexArray = 0;
+    unsigned StateCache::s_activeUnit = 0;
+    std::array<std::array<GLuint, StateCache::TEXTURE_TARGETS.size()>, StateCache::TEXTURE_UNITS> StateCache::s_textures{};
+    std::array<GLuint, StateCache::BUFFER_TARGETS.size()> StateCache::s_buffers{};
+    std::vector<std::pair<GLenum, bool>> StateCache::s_capabilities = {
+            {GL_DEPTH_TEST, false}, {GL_CULL_FACE, false}, {GL_BLEND, false}, {GL_STENCIL_TEST, false}
+    };
+    StateCacheStats StateCache::s_stats;
+
+    template <size_t N>
+    static size_t IndexOf(const std::array<GLenum, N>& targets, GLenum target)
+    {
+        return std::find(targets.begin(), targets.end(), target) - targets.begin();
+    }
+
+    void StateCache::UseProgram(GLuint program)
+    {
+        s_stats.programs.calls++;
+
+        if (program == s_program) {
+            s_stats.programs.skipped++;
+            return;
+        }
+
+        s_program = program;
+        glUseProgram(program);
+    }
+
+    void StateCache::BindVertexArray(GLuint vertexArray)
+    {
+        s_stats.vertexArrays.calls++;
+
+        if (vertexArray == s_vertexArray) {
+            s_stats.vertexArrays.skipped++;
+            return;
+        }
+
+        s_vertexArray = vertexArray;
+        glBindVertexArray(vertexArray);
+    }
+
+    void StateCache::BindTexture(unsigned unit, GLuint texture, GLenum target)
+    {
+        s_stats.textures.calls++;
+
+        auto targetIndex = IndexOf(TEXTURE_TARGETS, target);
+        bool tracked = unit < TEXTURE_UNITS && targetIndex < TEXTURE_TARGETS.size();
+
+        if (tracked && s_textures[unit][targetIndex] == texture) {
+            s_stats.textures.skipped++;
+            return;
+        }
+
+        if (unit != s_activeUnit) {
+            s_activeUnit = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+
+        if (tracked) {
+            s_textures[unit][targetIndex] = texture;
+        }
+
+        glBindTexture(target, texture);
+    }
+
+    void StateCache::BindBuffer(GLenum target, GLuint buffer)
+    {
+        s_stats.buffers.calls++;
+
+        auto targetIndex = IndexOf(BUFFER_TARGETS, target);
+
+        if (targetIndex < BUFFER_TARGETS.size()) {
+            if (s_buffers[targetIndex] == buffer) {
+                s_stats.buffers.skipped++;
+                return;
+            }
+
+            s_buffers[targetIndex] = buffer;
+        }
+
+        glBindBuffer(target, buffer);
+    }
+
+    void StateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+    {
+        if (auto targetIndex = IndexOf(BUFFER_TARGETS, target); targetIndex < BUFFER_TARGETS.size()) {
+            s_buffers[targetIndex] = buffer;
+        }
+
+        glBindBufferBase(target, index, buffer);
+    }
+
+    void StateCache::SetCapability(GLenum capability, bool enabled)
+    {
+        s_stats.capabilities.calls++;
+
+        auto search = std::find_if(s_capabilities.begin(), s_capabilities.end(), [capability](const auto& entry) {
+            return entry.first == capability;
+        });
+
+        if (search == s_capabilities.end()) {
+            s_capabilities.emplace_back(capability, enabled);
+        } else if (search->second == enabled) {
+            s_stats.capabilities.skipped++;
+            return;
+        } else {
+            search->second = enabled;
+        }
+
+        if (enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+    }
+
+    void StateCache::Enable(GLenum capability)
+    {
+        SetCapability(capability, true);
+    }
+
+    void StateCache::Disable(GLenum capability)
+    {
+        SetCapability(capability, false);
+    }
+
+    void StateCache::DeleteProgram(GLuint program)
+    {
+        // a program in use only really goes away once it isn't, but its name can't be trusted anymore
+        if (program == s_program) {
+            s_program = UNKNOWN;
+        }
+
+        glDeleteProgram(program);
+    }
+
+    void StateCache::DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+    {
+        if (std::find(vertexArrays, vertexArrays + count, s_vertexArray) != vertexArrays + count) {
+            s_vertexArray = 0;
+        }
+
+        glDeleteVertexArrays(count, vertexArrays);
+    }
+
+    void StateCache::DeleteTextures(GLsizei count, const GLuint* textures)
+    {
+        for (auto& unit : s_textures) {
+            for (auto& bound : unit) {
+                if (std::find(textures, textures + count, bound) != textures + count) {
+                    bound = 0;
+                }
+            }
+        }
+
+        glDeleteTextures(count, textures);
+    }
+
+    void StateCache::DeleteBuffers(GLsizei count, const GLuint* buffers)
+    {
+        for (auto& bound : s_buffers) {
+            if (std::find(buffers, buffers + count, bound) != buffers + count) {
+                bound = 0;
+            }
+        }
+
+        glDeleteBuffers(count, buffers);
+    }
+
+    void StateCache::UnbindTexture(GLuint texture)
+    {
+        if (texture == 0) {
+            return;
+        }
+
+        for (unsigned unit = 0; unit < TEXTURE_UNITS; ++unit) {
+            for (size_t target = 0; target < TEXTURE_TARGETS.size(); ++target) {
+                if (s_textures[unit][target] == texture) {
+                    BindTexture(unit, 0, TEXTURE_TARGETS[target]);
+                }
+            }
+        }
+    }
+
+    void StateCache::Invalidate()
+    {
+        s_program = UNKNOWN;
+        s_vertexArray = UNKNOWN;
+        s_activeUnit = UNKNOWN;
+
+        for (auto& unit : s_textures) {
+            unit.fill(UNKNOWN);
+        }
+
+        s_buffers.fill(UNKNOWN);
+        s_capabilities.clear();
+    }
+}
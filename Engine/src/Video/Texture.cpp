@@ -4,6 +4,7 @@
 #include "stb_image.h"
 
 #include "Video/Texture.hpp"
+#include "Video/StateCache.hpp"
 
 
 namespace Engine::GL {
@@ -32,7 +33,7 @@ namespace Engine::GL {
 
         glGenTextures(1, &m_id);
         printf("generated texture with id %u, name %s\n", m_id, path);
-        glBindTexture(GL_TEXTURE_2D, m_id);
+        StateCache::BindTexture(0, m_id);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, imgFormat, GL_UNSIGNED_BYTE, bytes);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -41,8 +42,6 @@ namespace Engine::GL {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        glBindTexture(GL_TEXTURE_2D, 0);
-
         stbi_image_free(bytes);
         fclose(fp);
     }
@@ -54,23 +53,21 @@ namespace Engine::GL {
         }
 
         printf("texture id %u is dying\n", m_id);
-        glDeleteTextures(1, &m_id);
+        StateCache::DeleteTextures(1, &m_id);
     }
 
     void Texture::Bind(unsigned unit)
     {
-        glActiveTexture(GL_TEXTURE0 + unit);
-        glBindTexture(GL_TEXTURE_2D, m_id);
+        StateCache::BindTexture(unit, m_id);
     }
 
     void Texture::Unbind()
     {
-        glBindTexture(GL_TEXTURE_2D, 0);
+        StateCache::UnbindTexture(m_id);
     }
 
     void Texture::BindNull(unsigned unit)
     {
-        glActiveTexture(GL_TEXTURE0 + unit);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        StateCache::BindTexture(unit, 0);
     }
 }
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "Video/VisibilityRenderer.hpp"
+#include "Video/StateCache.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace Engine::GL {
+    static constexpr UniformHandle DRAW_BASE_UNIFORM = "drawBase"_u;
+
+    static GLuint CreateTarget(GLenum internalFormat, GLenum format, GLenum type, int width, int height)
+    {
+        GLuint texture;
+
+        glGenTextures(1, &texture);
+        StateCache::BindTexture(0, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        return texture;
+    }
+
+    VisibilityRenderer::VisibilityRenderer()
+    {
+        m_geometryProgram.AttachShader("GLSL/visibility.vert", ShaderType::Vertex);
+        m_geometryProgram.AttachShader("GLSL/visibility.frag", ShaderType::Fragment);
+
+        m_materialProgram.AttachShader("GLSL/deferred_fullscreen.vert", ShaderType::Vertex);
+        m_materialProgram.AttachShader("GLSL/visibility_material.frag", ShaderType::Fragment);
+
+        m_shadeProgram.AttachShader("GLSL/visibility_shade.vert", ShaderType::Vertex);
+        m_shadeProgram.AttachShader("GLSL/visibility_shade.frag", ShaderType::Fragment);
+
+        m_parallaxProgram.AttachShader("GLSL/visibility_shade.vert", ShaderType::Vertex);
+        m_parallaxProgram.AttachShader("GLSL/visibility_shade.frag", ShaderType::Fragment, {{"PARALLAX", "1"}});
+
+        m_compositeProgram.AttachShader("GLSL/deferred_fullscreen.vert", ShaderType::Vertex);
+        m_compositeProgram.AttachShader("GLSL/deferred_composite.frag", ShaderType::Fragment);
+
+        Program::LinkAll({&m_geometryProgram, &m_materialProgram, &m_shadeProgram, &m_parallaxProgram, &m_compositeProgram});
+
+        glGenBuffers(1, &m_drawDataBuffer);
+        glGenBuffers(1, &m_commandBuffer);
+        glGenFramebuffers(1, &m_visibilityFramebuffer);
+        glGenFramebuffers(1, &m_shadeFramebuffer);
+        glGenVertexArrays(1, &m_emptyVao);
+    }
+
+    VisibilityRenderer::~VisibilityRenderer()
+    {
+        glDeleteFramebuffers(1, &m_visibilityFramebuffer);
+        glDeleteFramebuffers(1, &m_shadeFramebuffer);
+        StateCache::DeleteTextures(1, &m_visibility);
+        StateCache::DeleteTextures(1, &m_depth);
+        StateCache::DeleteTextures(1, &m_color);
+        StateCache::DeleteTextures(1, &m_materialDepth);
+        StateCache::DeleteBuffers(1, &m_drawDataBuffer);
+        StateCache::DeleteBuffers(1, &m_commandBuffer);
+        StateCache::DeleteVertexArrays(1, &m_emptyVao);
+    }
+
+    void VisibilityRenderer::Resize(int width, int height)
+    {
+        StateCache::DeleteTextures(1, &m_visibility);
+        StateCache::DeleteTextures(1, &m_depth);
+        StateCache::DeleteTextures(1, &m_color);
+        StateCache::DeleteTextures(1, &m_materialDepth);
+
+        m_width = width;
+        m_height = height;
+
+        // 12 bytes a pixel until shading, however many attributes the materials need
+        m_visibility = CreateTarget(GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, width, height);
+        m_depth = CreateTarget(GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+        m_color = CreateTarget(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, width, height);
+        m_materialDepth = CreateTarget(GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_visibilityFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_visibility, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("visibility buffer incomplete");
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_shadeFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_materialDepth, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("visibility shading buffer incomplete");
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void VisibilityRenderer::Begin()
+    {
+        m_items.clear();
+    }
+
+    void VisibilityRenderer::Submit(Mesh& mesh, const glm::mat4& model)
+    {
+        if (m_items.size() == GeometryPool::MAX_DRAWS) {
+            return;
+        }
+
+        auto& allocation = m_pool.Add(mesh);
+        m_items.push_back({&mesh, allocation.bucket, model});
+    }
+
+    void VisibilityRenderer::Execute(IndirectStats& stats, DrawStats& drawStats)
+    {
+        if (m_items.empty()) {
+            return;
+        }
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        if (viewport[2] != m_width || viewport[3] != m_height) {
+            Resize(viewport[2], viewport[3]);
+        }
+
+        // bucket first, so the geometry pass gets one multi draw per bucket, then textures, so each material's draws
+        // end up next to each other
+        m_order.resize(m_items.size());
+        std::iota(m_order.begin(), m_order.end(), 0);
+
+        auto materialKey = [this](uint32_t i) {
+            const auto& item = m_items[i];
+            return std::make_tuple(item.bucket, item.mesh->GetTextures());
+        };
+
+        std::stable_sort(m_order.begin(), m_order.end(), [&materialKey](uint32_t a, uint32_t b) {
+            return materialKey(a) < materialKey(b);
+        });
+
+        m_drawData.clear();
+        m_commands.clear();
+        m_materials.clear();
+
+        for (size_t i = 0; i < m_order.size(); ++i) {
+            const auto& item = m_items[m_order[i]];
+            const auto& allocation = *m_pool.Find(*item.mesh);
+            const auto& lod = item.mesh->GetCurrentLod();
+
+            if (i == 0 || materialKey(m_order[i]) != materialKey(m_order[i - 1])) {
+                if (m_materials.size() + 1 == MAX_MATERIALS) {
+                    break;
+                }
+
+                m_materials.push_back({item.mesh, item.bucket});
+            }
+
+            m_drawData.push_back({
+                    item.model,
+                    glm::mat4(glm::inverseTranspose(glm::mat3(item.model))),
+                    item.mesh->GetPositionBias(),
+                    item.mesh->GetPositionScale(),
+                    allocation.firstIndex + lod.firstIndex,
+                    allocation.baseVertex,
+                    static_cast<uint32_t>(m_materials.size() - 1),
+                    0
+            });
+
+            auto drawIndex = static_cast<uint32_t>(m_commands.size());
+            m_commands.push_back({lod.indexCount, 1, allocation.firstIndex + lod.firstIndex, allocation.baseVertex, drawIndex});
+
+            drawStats.trianglesTotal += item.mesh->GetIndexCount() / 3;
+            drawStats.trianglesDrawn += lod.indexCount / 3;
+        }
+
+        // orphaned like IndirectRenderer's, last frame's may still be in use
+        StateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_drawData.size() * sizeof(DrawData), m_drawData.data(), GL_STREAM_DRAW);
+        StateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, m_drawDataBuffer);
+
+        StateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(Ext::DrawElementsIndirectCommand), m_commands.data(), GL_STREAM_DRAW);
+
+        // geometry: ids and depth, nothing else gets written or read
+        static const GLuint noDraw[] = {0, 0, 0, 0};
+        static const GLfloat farDepth = 1.0f;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_visibilityFramebuffer);
+        StateCache::Enable(GL_DEPTH_TEST);
+        glClearBufferuiv(GL_COLOR, 0, noDraw);
+        glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+        m_geometryProgram.Use();
+
+        for (size_t first = 0; first < m_commands.size();) {
+            auto bucket = m_items[m_order[first]].bucket;
+            auto last = first + 1;
+
+            while (last < m_commands.size() && m_items[m_order[last]].bucket == bucket) {
+                last++;
+            }
+
+            m_pool.Bind(bucket);
+            m_geometryProgram.SetUniform(DRAW_BASE_UNIFORM, static_cast<int>(first));
+
+            Ext::MultiDrawElementsIndirect(
+                    GL_TRIANGLES,
+                    m_pool.GetIndexType(bucket),
+                    reinterpret_cast<const void*>(first * sizeof(Ext::DrawElementsIndirectCommand)),
+                    static_cast<GLsizei>(last - first),
+                    0
+            );
+
+            stats.multiDraws++;
+            stats.draws += last - first;
+
+            first = last;
+        }
+
+        // every covered pixel's material, as depth
+        glBindFramebuffer(GL_FRAMEBUFFER, m_shadeFramebuffer);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glDepthFunc(GL_ALWAYS);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+        StateCache::BindTexture(VISIBILITY_UNIT, m_visibility);
+        StateCache::BindVertexArray(m_emptyVao);
+
+        m_materialProgram.Use();
+        m_materialProgram.SetUniform("visibilityMap", static_cast<int>(VISIBILITY_UNIT));
+        m_materialProgram.SetUniform("materialCount", static_cast<float>(MAX_MATERIALS));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        // one pass per material, each only reaching its own pixels
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+
+        auto screenSize = glm::vec2(m_width, m_height);
+
+        for (size_t material = 0; material < m_materials.size(); ++material) {
+            auto* mesh = m_materials[material].mesh;
+            auto bucket = m_materials[material].bucket;
+            const auto& layout = m_pool.GetLayout(bucket);
+
+            auto& program = mesh->GetTextures()[3] != nullptr ? m_parallaxProgram : m_shadeProgram;
+
+            program.Use();
+            program.SetUniform("diffuseMap", 0);
+            program.SetUniform("specularMap", 1);
+            program.SetUniform("normalMap", 2);
+            program.SetUniform("depthMap", 3);
+            program.SetUniform("visibilityMap", static_cast<int>(VISIBILITY_UNIT));
+            program.SetUniform("screenSize", screenSize);
+            program.SetUniform("materialDepth", static_cast<float>(material + 1) / MAX_MATERIALS);
+            program.SetUniform("heightScale", m_heightScale);
+
+            // bits for a compact layout, uvs, normals and tangents, see fetchVertex in the shader
+            int vertexFormat = (layout.format == VertexFormat::Compact ? 1 : 0) | (layout.hasUV ? 2 : 0) |
+                               (layout.hasNormal ? 4 : 0) | (layout.hasTangents ? 8 : 0);
+
+            program.SetUniform("vertexFormat", vertexFormat);
+            program.SetUniform("vertexStride", static_cast<int>(layout.GetStride() / 4));
+            program.SetUniform("shortIndices", m_pool.GetIndexType(bucket) == GL_UNSIGNED_SHORT ? 1 : 0);
+
+            mesh->BindMaterial();
+            StateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, VERTEX_BINDING, m_pool.GetVertexBuffer(bucket));
+            StateCache::BindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, m_pool.GetIndexBuffer(bucket));
+
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        glDepthMask(GL_TRUE);
+
+        // the depth test has to be on for gl_FragDepth to get written, it just can't throw anything out
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDepthFunc(GL_ALWAYS);
+
+        StateCache::BindTexture(0, m_color);
+        StateCache::BindTexture(1, m_depth);
+
+        m_compositeProgram.Use();
+        m_compositeProgram.SetUniform("lightMap", 0);
+        m_compositeProgram.SetUniform("depthMap", 1);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glDepthFunc(GL_LESS);
+    }
+}
@@ -3,6 +3,7 @@
 #include "glad/glad.h"
 
 #include "Video/Window.hpp"
+#include "Video/GLExt.hpp"
 
 void GLDebugSink(
         GLenum source,
@@ -28,8 +29,10 @@ namespace Engine::GL {
     )
     {
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+        // spelled out so depth can be blitted to a GL_DEPTH24_STENCIL8 texture (see DepthPyramid)
+        SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+        SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 
 #ifndef NDEBUG
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
@@ -58,12 +61,34 @@ namespace Engine::GL {
             throw std::runtime_error("failed to create window");
         }
 
-        ctx = SDL_GL_CreateContext(window);
+        // ask for the newest context the optional paths use, 3.3 is all the rest of the engine needs
+        const int versions[][2] = {{4, 6}, {4, 5}, {4, 3}, {3, 3}};
+        ctx = nullptr;
+
+        for (const auto& version : versions) {
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, version[0]);
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, version[1]);
+
+            if ((ctx = SDL_GL_CreateContext(window)) != nullptr) {
+                break;
+            }
+        }
+
+        if (ctx == nullptr) {
+            throw std::runtime_error("failed to create gl context");
+        }
 
         if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) {
             throw std::runtime_error("failed to load gl");
         }
 
+        Ext::Load(SDL_GL_GetProcAddress);
+
+        // as many compiler threads as the driver likes, programs poll for completion instead of waiting
+        if (Ext::MaxShaderCompilerThreads != nullptr) {
+            Ext::MaxShaderCompilerThreads(0xFFFFFFFF);
+        }
+
         SDL_GL_SetSwapInterval(-1);
 
 #ifndef NDEBUG
@@ -87,4 +112,11 @@ namespace Engine::GL {
     {
         SDL_GL_SwapWindow(window);
     }
+
+    void Window::SetSwapInterval(int interval)
+    {
+        if (SDL_GL_SetSwapInterval(interval) != 0) {
+            fprintf(stderr, "swap interval %d unsupported: %s\n", interval, SDL_GetError());
+        }
+    }
 }
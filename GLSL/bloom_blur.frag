@@ -0,0 +1,25 @@
+#version 330 core
+
+// fragment shader: bloom, one direction of a separable 9 tap gaussian blur (see Bloom)
+
+out vec4 color;
+
+uniform sampler2D sourceMap;
+
+// one texel along the axis to blur, in texture coordinates
+uniform vec2 direction;
+
+const float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(sourceMap, 0));
+    vec3 sum = texture(sourceMap, uv).rgb * weights[0];
+
+    for (int i = 1; i < 5; ++i) {
+        sum += texture(sourceMap, uv + direction * i).rgb * weights[i];
+        sum += texture(sourceMap, uv - direction * i).rgb * weights[i];
+    }
+
+    color = vec4(sum, 1.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// fragment shader: bloom, keeps what's brighter than the threshold at half resolution (see Bloom)
+
+out vec4 color;
+
+uniform sampler2D sceneMap;
+uniform float threshold;
+
+void main()
+{
+    // on the corner the 2x2 scene texels under the pixel share, the bilinear sample averages them
+    vec2 uv = gl_FragCoord.xy * 2.0 / vec2(textureSize(sceneMap, 0));
+    vec3 scene = texture(sceneMap, uv).rgb;
+    float brightness = max(scene.r, max(scene.g, scene.b));
+
+    color = vec4(scene * max(brightness - threshold, 0.0) / max(brightness, 1e-4), 1.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// fragment shader: bloom, added on top of the scene with the blend set to GL_ONE, GL_ONE (see Bloom)
+
+out vec4 color;
+
+uniform sampler2D bloomMap;
+uniform float intensity;
+
+// x, y, width and height, as glViewport takes them
+uniform vec4 viewport;
+
+void main()
+{
+    vec2 uv = (gl_FragCoord.xy - viewport.xy) / viewport.zw;
+
+    color = vec4(texture(bloomMap, uv).rgb * intensity, 0.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+
+// vertex shader: stretches the unit cube occlusion queries draw over a bounding box
+
+layout (location = 0) in vec3 pos;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+uniform mat4 model;
+
+uniform vec3 aabbMin;
+uniform vec3 aabbMax;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(mix(aabbMin, aabbMax, pos), 1.0);
+}
@@ -1,6 +1,13 @@
 #version 330 core
 
 // fragment shader: forward rendered phong with diffuse, specular and normal mapping, single light source
+// POINT_LIGHTS: also loops over every light in the PointLights block
+// CLUSTERED: also loops over the lights binned into the fragment's cluster (see ClusteredLights)
+// DEFERRED: writes the G-buffer instead of lighting (see DeferredRenderer)
+
+#if defined(DEFERRED) || defined(POINT_LIGHTS) || defined(CLUSTERED)
+#define WORLD_TBN
+#endif
 
 in VS_OUT {
     vec3 fragPos;
@@ -8,15 +15,166 @@ in VS_OUT {
     vec3 tLightPos;
     vec3 tViewPos;
     vec3 tFragPos;
+#ifdef WORLD_TBN
+    mat3 worldTBN;
+#endif
 } fs_in;
 
+#ifdef DEFERRED
+layout (location = 0) out vec4 albedoSpec;
+layout (location = 1) out vec2 octNormal;
+#else
 out vec4 color;
+#endif
 
 uniform sampler2D diffuseMap;
 uniform sampler2D specularMap;
 uniform sampler2D normalMap;
 
-uniform vec3 lightColor;
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+#if defined(POINT_LIGHTS) || defined(CLUSTERED)
+// reaches exactly 0 at the radius, so lights can be skipped past it
+float attenuation(float dist, float radius)
+{
+    float window = clamp(1.0 - pow(dist / radius, 4.0), 0.0, 1.0);
+
+    return window * window / (dist * dist + 1.0);
+}
+#endif
+
+#ifdef POINT_LIGHTS
+// has to match LightBuffer::MAX_LIGHTS
+#define MAX_POINT_LIGHTS 256
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+// every point light in the scene, shared by every program (see LightBuffer)
+layout (std140) uniform PointLights {
+    int pointLightCount;
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+vec3 pointLighting(vec3 normal)
+{
+    vec3 albedo = texture(diffuseMap, fs_in.uv).rgb;
+    vec3 spec = texture(specularMap, fs_in.uv).rgb;
+    vec3 viewDir = normalize(viewPos - fs_in.fragPos);
+    vec3 result = vec3(0.0);
+
+    for (int i = 0; i < pointLightCount; ++i) {
+        vec3 toLight = pointLights[i].positionRadius.xyz - fs_in.fragPos;
+        float dist = length(toLight);
+
+        if (dist >= pointLights[i].positionRadius.w) {
+            continue;
+        }
+
+        vec3 lightDir = toLight / dist;
+        vec3 halfway = normalize(lightDir + viewDir);
+
+        float diffStr = max(dot(lightDir, normal), 0.0);
+        float specStr = pow(max(dot(normal, halfway), 0.0), 96);
+
+        result += (diffStr * albedo + specStr * spec) * pointLights[i].color.rgb * attenuation(dist, pointLights[i].positionRadius.w);
+    }
+
+    return result;
+}
+#endif
+
+#ifdef CLUSTERED
+// every light binned this frame, 3 texels each: position and radius, color, direction and cosine of the cone's
+// half angle, -1 for point lights (see ClusteredLights)
+uniform samplerBuffer clusterLights;
+
+// an offset into clusterIndices and a light count per cluster
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterIndices;
+
+// tiles across, tiles down, slices
+uniform vec4 clusterGrid;
+
+// slice = log(view depth) * x + y
+uniform vec2 clusterDepth;
+
+uniform vec2 screenSize;
+
+int clusterIndex()
+{
+    float viewDepth = -(view * vec4(fs_in.fragPos, 1.0)).z;
+
+    ivec3 grid = ivec3(clusterGrid.xyz);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / screenSize * clusterGrid.xy), ivec2(0), grid.xy - 1);
+    int slice = clamp(int(log(max(viewDepth, 1e-4)) * clusterDepth.x + clusterDepth.y), 0, grid.z - 1);
+
+    return tile.x + grid.x * (tile.y + grid.y * slice);
+}
+
+vec3 clusteredLighting(vec3 normal)
+{
+    vec3 albedo = texture(diffuseMap, fs_in.uv).rgb;
+    vec3 spec = texture(specularMap, fs_in.uv).rgb;
+    vec3 viewDir = normalize(viewPos - fs_in.fragPos);
+    vec3 result = vec3(0.0);
+
+    uvec2 range = texelFetch(clusterRanges, clusterIndex()).xy;
+
+    for (uint i = 0u; i < range.y; ++i) {
+        int light = int(texelFetch(clusterIndices, int(range.x + i)).r) * 3;
+        vec4 positionRadius = texelFetch(clusterLights, light);
+        vec4 directionAngle = texelFetch(clusterLights, light + 2);
+
+        vec3 toLight = positionRadius.xyz - fs_in.fragPos;
+        float dist = length(toLight);
+
+        if (dist >= positionRadius.w) {
+            continue;
+        }
+
+        vec3 lightDir = toLight / dist;
+        float strength = attenuation(dist, positionRadius.w);
+
+        // spot lights fade out over the outer tenth of their cone, reaching 0 on the edge the binning tests against
+        if (directionAngle.w > -1.0) {
+            strength *= smoothstep(directionAngle.w, mix(directionAngle.w, 1.0, 0.1), dot(-lightDir, directionAngle.xyz));
+        }
+
+        vec3 halfway = normalize(lightDir + viewDir);
+
+        float diffStr = max(dot(lightDir, normal), 0.0);
+        float specStr = pow(max(dot(normal, halfway), 0.0), 96);
+
+        result += (diffStr * albedo + specStr * spec) * texelFetch(clusterLights, light + 1).rgb * strength;
+    }
+
+    return result;
+}
+#endif
+
+#ifdef DEFERRED
+// unit vector to the octahedron, unfolded onto [-1, 1]^2 (octDecode in the vertex shaders undoes it)
+vec2 octEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+
+    return n.xy;
+}
+#endif
 
 vec3 ambient()
 {
@@ -55,7 +213,20 @@ void main()
     // map to [-1, 1]
     normal = normalize(normal * 2.0 - 1.0);
 
+#ifdef DEFERRED
+    albedoSpec = vec4(texture(diffuseMap, fs_in.uv).rgb, texture(specularMap, fs_in.uv).r);
+    octNormal = octEncode(normalize(fs_in.worldTBN * normal));
+#else
     vec3 result = ambient() + diffuse(normal) + specular(normal);
 
+#ifdef POINT_LIGHTS
+    result += pointLighting(normalize(fs_in.worldTBN * normal));
+#endif
+
+#ifdef CLUSTERED
+    result += clusteredLighting(normalize(fs_in.worldTBN * normal));
+#endif
+
     color = vec4(result, 1.0);
+#endif
 }
@@ -7,30 +7,66 @@ layout (location = 1) in vec2 uv;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec3 tangent;
 
+// dequantization constants, fed through attribute arrays the vao leaves disabled (see Mesh::Draw)
+// posScale.w is 1 when normals and tangents are octahedral encoded
+layout (location = 4) in vec4 posBias;
+layout (location = 5) in vec4 posScale;
+
+// the G-buffer, point and clustered lights are in world space, so those variants need the tangent frame itself too
+#if defined(DEFERRED) || defined(POINT_LIGHTS) || defined(CLUSTERED)
+#define WORLD_TBN
+#endif
+
 out VS_OUT {
     vec3 fragPos;
     vec2 uv;
     vec3 tLightPos;
     vec3 tViewPos;
     vec3 tFragPos;
+#ifdef WORLD_TBN
+    mat3 worldTBN;
+#endif
 } vs_out;
 
-uniform mat4 projection;
-uniform mat4 view;
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
 uniform mat4 model;
 uniform mat3 invModel;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+// depth_only.vert lays down the depth these get tested against for equality, so both have to round the same
+invariant gl_Position;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+
+    return normalize(n);
+}
+
+vec3 decodeDirection(vec3 v)
+{
+    return posScale.w > 0.5 ? octDecode(v.xy) : v;
+}
 
 void main()
 {
-    vs_out.fragPos = vec3(model * vec4(pos, 1.0));
+    vec3 position = posBias.xyz + pos * posScale.xyz;
+
+    vs_out.fragPos = vec3(model * vec4(position, 1.0));
     vs_out.uv = uv;
 
     // calculate tangent space matrix
-    vec3 T = normalize(invModel * tangent);
-    vec3 N = normalize(invModel * normal);
+    vec3 T = normalize(invModel * decodeDirection(tangent));
+    vec3 N = normalize(invModel * decodeDirection(normal));
     T = normalize(T - dot(T, N) * N);
     vec3 B = cross(N, T);
 
@@ -40,6 +76,10 @@ void main()
     vs_out.tViewPos = TBN * viewPos;
     vs_out.tFragPos = TBN * vs_out.fragPos;
 
+#ifdef WORLD_TBN
+    vs_out.worldTBN = mat3(T, B, N);
+#endif
+
 
-    gl_Position = projection * view * model * vec4(pos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
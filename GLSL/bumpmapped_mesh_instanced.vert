@@ -0,0 +1,73 @@
+#version 330 core
+
+// vertex shader: forward rendered phong with diffuse, specular and normal mapping, single light source, instanced
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 uv;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec3 tangent;
+
+// dequantization constants, fed through attribute arrays the vao leaves disabled (see Mesh::Draw)
+// posScale.w is 1 when normals and tangents are octahedral encoded
+layout (location = 4) in vec4 posBias;
+layout (location = 5) in vec4 posScale;
+
+out VS_OUT {
+    vec3 fragPos;
+    vec2 uv;
+    vec3 tLightPos;
+    vec3 tViewPos;
+    vec3 tFragPos;
+} vs_out;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+// per instance model matrix, one column per location (6 to 9, see Model::DrawInstanced)
+layout (location = 6) in mat4 model;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+
+    return normalize(n);
+}
+
+vec3 decodeDirection(vec3 v)
+{
+    return posScale.w > 0.5 ? octDecode(v.xy) : v;
+}
+
+void main()
+{
+    // deriving the normal matrix here saves uploading a second matrix per instance
+    mat3 invModel = transpose(inverse(mat3(model)));
+
+    vec3 position = posBias.xyz + pos * posScale.xyz;
+
+    vs_out.fragPos = vec3(model * vec4(position, 1.0));
+    vs_out.uv = uv;
+
+    // calculate tangent space matrix
+    vec3 T = normalize(invModel * decodeDirection(tangent));
+    vec3 N = normalize(invModel * decodeDirection(normal));
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(N, T);
+
+    // i forgot to type transpose here and wasted 2 hours of my life
+    mat3 TBN = transpose(mat3(T, B, N));
+    vs_out.tLightPos = TBN * lightPos;
+    vs_out.tViewPos = TBN * viewPos;
+    vs_out.tFragPos = TBN * vs_out.fragPos;
+
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
+}
@@ -0,0 +1,100 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : enable
+
+// vertex shader: forward rendered phong with diffuse, specular and normal mapping, single light source, multi draw indirect
+
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec2 uv;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec3 tangent;
+
+// one entry per draw, see IndirectRenderer::DrawData
+struct DrawData {
+    mat4 model;
+    mat4 invModel;
+    vec4 posBias;
+    // posScale.w is 1 when normals and tangents are octahedral encoded
+    vec4 posScale;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+#ifdef GL_ARB_shader_draw_parameters
+// where this multi draw's commands start, gl_DrawIDARB counts from 0 in every call
+uniform int drawBase;
+#else
+// every command's base instance is its draw index, and the pool's vaos feed 0, 1, 2... per instance at
+// location 10, so with one instance per command this is the draw index too (see GeometryPool)
+layout (location = 10) in uint drawId;
+#endif
+
+DrawData draw;
+
+int drawIndex()
+{
+#ifdef GL_ARB_shader_draw_parameters
+    return drawBase + gl_DrawIDARB;
+#else
+    return int(drawId);
+#endif
+}
+
+out VS_OUT {
+    vec3 fragPos;
+    vec2 uv;
+    vec3 tLightPos;
+    vec3 tViewPos;
+    vec3 tFragPos;
+} vs_out;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+
+    return normalize(n);
+}
+
+vec3 decodeDirection(vec3 v)
+{
+    return draw.posScale.w > 0.5 ? octDecode(v.xy) : v;
+}
+
+void main()
+{
+    draw = draws[drawIndex()];
+    mat4 model = draw.model;
+    mat3 invModel = mat3(draw.invModel);
+
+    vec3 position = draw.posBias.xyz + pos * draw.posScale.xyz;
+
+    vs_out.fragPos = vec3(model * vec4(position, 1.0));
+    vs_out.uv = uv;
+
+    // calculate tangent space matrix
+    vec3 T = normalize(invModel * decodeDirection(tangent));
+    vec3 N = normalize(invModel * decodeDirection(normal));
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(N, T);
+
+    // i forgot to type transpose here and wasted 2 hours of my life
+    mat3 TBN = transpose(mat3(T, B, N));
+    vs_out.tLightPos = TBN * lightPos;
+    vs_out.tViewPos = TBN * viewPos;
+    vs_out.tFragPos = TBN * vs_out.fragPos;
+
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
+}
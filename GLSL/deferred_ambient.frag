@@ -0,0 +1,65 @@
+#version 330 core
+
+// fragment shader: deferred lighting, ambient and the frame's light over the whole G-buffer (see DeferredRenderer)
+
+out vec4 color;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+uniform sampler2D albedoSpecMap;
+uniform sampler2D octNormalMap;
+uniform sampler2D depthMap;
+
+uniform mat4 invProjectionView;
+uniform vec2 screenSize;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+
+    return normalize(n);
+}
+
+vec3 worldPosition(float depth)
+{
+    vec4 ndc = vec4(gl_FragCoord.xy / screenSize, depth, 1.0) * 2.0 - 1.0;
+    vec4 world = invProjectionView * ndc;
+
+    return world.xyz / world.w;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(depthMap, texel, 0).r;
+
+    // nothing was drawn here
+    if (depth == 1.0) {
+        discard;
+    }
+
+    vec4 albedoSpec = texelFetch(albedoSpecMap, texel, 0);
+    vec3 normal = octDecode(texelFetch(octNormalMap, texel, 0).rg);
+    vec3 position = worldPosition(depth);
+
+    vec3 lightDir = normalize(lightPos - position);
+    vec3 viewDir = normalize(viewPos - position);
+    vec3 halfway = normalize(lightDir + viewDir);
+
+    float ambientMod = 0.1;
+    float diffStr = max(dot(lightDir, normal), 0.0);
+    float specStr = pow(max(dot(normal, halfway), 0.0), 96);
+
+    vec3 result = (ambientMod + diffStr) * lightColor * albedoSpec.rgb + specStr * lightColor * albedoSpec.a;
+
+    color = vec4(result, 1.0);
+}
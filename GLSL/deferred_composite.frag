@@ -0,0 +1,17 @@
+#version 330 core
+
+// fragment shader: deferred lighting, copies the lit G-buffer and its depth to the window (see DeferredRenderer)
+
+out vec4 color;
+
+uniform sampler2D lightMap;
+uniform sampler2D depthMap;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    // the depth goes along so forward drawn objects still get hidden by the deferred ones
+    color = vec4(texelFetch(lightMap, texel, 0).rgb, 1.0);
+    gl_FragDepth = texelFetch(depthMap, texel, 0).r;
+}
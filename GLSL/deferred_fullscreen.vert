@@ -0,0 +1,11 @@
+#version 330 core
+
+// vertex shader: deferred lighting, one triangle covering the screen, no vertex buffer needed (see DeferredRenderer)
+
+void main()
+{
+    // corners at (-1, -1), (3, -1) and (-1, 3), the part outside the screen gets clipped
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
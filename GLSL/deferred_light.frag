@@ -0,0 +1,76 @@
+#version 330 core
+
+// fragment shader: deferred lighting, one point light added to whatever its volume covers (see DeferredRenderer)
+
+flat in vec4 light;
+flat in vec3 color;
+
+out vec4 result;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+uniform sampler2D albedoSpecMap;
+uniform sampler2D octNormalMap;
+uniform sampler2D depthMap;
+
+uniform mat4 invProjectionView;
+uniform vec2 screenSize;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+
+    return normalize(n);
+}
+
+vec3 worldPosition(float depth)
+{
+    vec4 ndc = vec4(gl_FragCoord.xy / screenSize, depth, 1.0) * 2.0 - 1.0;
+    vec4 world = invProjectionView * ndc;
+
+    return world.xyz / world.w;
+}
+
+// same falloff as the forward shaders' POINT_LIGHTS, 0 at the radius so the volume can stop there
+float attenuation(float dist, float radius)
+{
+    float window = clamp(1.0 - pow(dist / radius, 4.0), 0.0, 1.0);
+
+    return window * window / (dist * dist + 1.0);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(depthMap, texel, 0).r;
+
+    vec3 position = worldPosition(depth);
+    vec3 toLight = light.xyz - position;
+    float dist = length(toLight);
+
+    // the box is drawn without a depth test, so this also throws out the sky and whatever is in front of the sphere
+    if (depth == 1.0 || dist >= light.w) {
+        discard;
+    }
+
+    vec4 albedoSpec = texelFetch(albedoSpecMap, texel, 0);
+    vec3 normal = octDecode(texelFetch(octNormalMap, texel, 0).rg);
+
+    vec3 lightDir = toLight / dist;
+    vec3 viewDir = normalize(viewPos - position);
+    vec3 halfway = normalize(lightDir + viewDir);
+
+    float diffStr = max(dot(lightDir, normal), 0.0);
+    float specStr = pow(max(dot(normal, halfway), 0.0), 96);
+
+    result = vec4((diffStr * albedoSpec.rgb + specStr * albedoSpec.a) * color * attenuation(dist, light.w), 1.0);
+}
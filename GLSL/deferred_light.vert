@@ -0,0 +1,29 @@
+#version 330 core
+
+// vertex shader: deferred lighting, a box around a point light's sphere, one instance per light (see DeferredRenderer)
+
+layout (location = 0) in vec3 corner;
+
+// straight out of the LightBuffer, a PointLight per instance
+layout (location = 1) in vec4 positionRadius;
+layout (location = 2) in vec4 pointColor;
+
+flat out vec4 light;
+flat out vec3 color;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+void main()
+{
+    light = positionRadius;
+    color = pointColor.rgb;
+
+    gl_Position = projection * view * vec4(positionRadius.xyz + corner * positionRadius.w, 1.0);
+}
@@ -0,0 +1,7 @@
+#version 330 core
+
+// fragment shader: depth pre-pass, color writes are off so there's nothing to output
+
+void main()
+{
+}
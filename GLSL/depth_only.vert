@@ -0,0 +1,30 @@
+#version 330 core
+
+// vertex shader: depth pre-pass, positions only (see RenderPass::Depth). Has to compute gl_Position exactly like
+// the shaders the same items get shaded with, the pass after this one tests for equal depth
+
+layout (location = 0) in vec3 pos;
+
+// dequantization constants, fed through attribute arrays the vao leaves disabled (see Mesh::Draw)
+layout (location = 4) in vec4 posBias;
+layout (location = 5) in vec4 posScale;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+uniform mat4 model;
+
+invariant gl_Position;
+
+void main()
+{
+    vec3 position = posBias.xyz + pos * posScale.xyz;
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
+}
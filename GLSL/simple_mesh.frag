@@ -10,9 +10,15 @@ out vec4 color;
 
 uniform sampler2D diffuseMap;
 uniform sampler2D specularMap;
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
 
 vec3 ambient()
 {
@@ -6,20 +6,51 @@ layout (location = 0) in vec3 pos;
 layout (location = 1) in vec2 iUV;
 layout (location = 2) in vec3 norm;
 
+// dequantization constants, fed through attribute arrays the vao leaves disabled (see Mesh::Draw)
+// posScale.w is 1 when normals and tangents are octahedral encoded
+layout (location = 4) in vec4 posBias;
+layout (location = 5) in vec4 posScale;
+
 out vec3 normal;
 out vec3 fragPos;
 out vec2 uv;
 
-uniform mat4 projection;
-uniform mat4 view;
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
 uniform mat4 model;
 uniform mat3 invModel;
 
+// depth_only.vert lays down the depth these get tested against for equality, so both have to round the same
+invariant gl_Position;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+
+    return normalize(n);
+}
+
+vec3 decodeDirection(vec3 v)
+{
+    return posScale.w > 0.5 ? octDecode(v.xy) : v;
+}
+
 void main()
 {
-    normal = invModel * norm;
-    fragPos = vec3(model * vec4(pos, 1.0));
-    gl_Position = projection * view * model * vec4(pos, 1.0);
+    vec3 position = posBias.xyz + pos * posScale.xyz;
+
+    normal = invModel * decodeDirection(norm);
+    fragPos = vec3(model * vec4(position, 1.0));
+    gl_Position = projection * view * model * vec4(position, 1.0);
 
     uv = iUV;
 }
@@ -0,0 +1,14 @@
+#version 430 core
+
+// fragment shader: visibility buffer geometry pass, writes which triangle of which draw covers the pixel
+// (see VisibilityRenderer)
+
+flat in uint drawIndex;
+
+layout (location = 0) out uvec2 visibility;
+
+void main()
+{
+    // 0 is left for the pixels nothing covers. gl_PrimitiveID restarts with every draw of a multi draw
+    visibility = uvec2(drawIndex + 1u, uint(gl_PrimitiveID));
+}
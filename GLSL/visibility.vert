@@ -0,0 +1,55 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : enable
+
+// vertex shader: visibility buffer geometry pass, positions only, multi draw indirect (see VisibilityRenderer)
+
+layout (location = 0) in vec3 pos;
+
+// one entry per draw, see VisibilityRenderer::DrawData
+struct DrawData {
+    mat4 model;
+    mat4 invModel;
+    vec4 posBias;
+    vec4 posScale;
+    uint firstIndex;
+    int baseVertex;
+    uint material;
+    uint pad0;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+#ifdef GL_ARB_shader_draw_parameters
+// where this multi draw's commands start, gl_DrawIDARB counts from 0 in every call
+uniform int drawBase;
+#else
+// every command's base instance is its draw index, see GeometryPool
+layout (location = 10) in uint drawId;
+#endif
+
+flat out uint drawIndex;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+void main()
+{
+#ifdef GL_ARB_shader_draw_parameters
+    drawIndex = uint(drawBase + gl_DrawIDARB);
+#else
+    drawIndex = drawId;
+#endif
+
+    DrawData draw = draws[drawIndex];
+    vec3 position = draw.posBias.xyz + pos * draw.posScale.xyz;
+
+    gl_Position = projection * view * draw.model * vec4(position, 1.0);
+}
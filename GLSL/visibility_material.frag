@@ -0,0 +1,36 @@
+#version 430 core
+
+// fragment shader: visibility buffer, writes each pixel's material as depth, so every material's shading pass
+// can have the depth test keep it to its own pixels (see VisibilityRenderer)
+
+struct DrawData {
+    mat4 model;
+    mat4 invModel;
+    vec4 posBias;
+    vec4 posScale;
+    uint firstIndex;
+    int baseVertex;
+    uint material;
+    uint pad0;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+uniform usampler2D visibilityMap;
+
+// VisibilityRenderer::MAX_MATERIALS
+uniform float materialCount;
+
+void main()
+{
+    uint draw = texelFetch(visibilityMap, ivec2(gl_FragCoord.xy), 0).x;
+
+    // uncovered pixels keep the cleared depth, which no material's pass is drawn at
+    if (draw == 0u) {
+        discard;
+    }
+
+    gl_FragDepth = float(draws[draw - 1u].material + 1u) / materialCount;
+}
@@ -0,0 +1,323 @@
+#version 430 core
+
+// fragment shader: visibility buffer shading, phong with diffuse, specular and normal mapping, the frame's light
+// and every light in the PointLights block, for the pixels of one material (see VisibilityRenderer)
+// PARALLAX: relief parallax mapping first. Unlike the forward shader it can't discard past the uv edges
+
+#ifndef PARALLAX_LAYERS
+#define PARALLAX_LAYERS 16
+#endif
+
+// has to match LightBuffer::MAX_LIGHTS
+#define MAX_POINT_LIGHTS 256
+
+// one entry per draw, see VisibilityRenderer::DrawData
+struct DrawData {
+    mat4 model;
+    mat4 invModel;
+    vec4 posBias;
+    vec4 posScale;
+    uint firstIndex;
+    int baseVertex;
+    uint material;
+    uint pad0;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+// the material's pool bucket, a word at a time (see GeometryPool)
+layout (std430, binding = 1) readonly buffer VertexBuffer {
+    uint vertexWords[];
+};
+
+layout (std430, binding = 2) readonly buffer IndexBuffer {
+    uint indexWords[];
+};
+
+out vec4 color;
+
+// per frame camera and light, shared by every program (see FrameUniformBuffer)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+// every point light in the scene, shared by every program (see LightBuffer)
+layout (std140) uniform PointLights {
+    int pointLightCount;
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+uniform sampler2D diffuseMap;
+uniform sampler2D specularMap;
+uniform sampler2D normalMap;
+uniform sampler2D depthMap;
+
+uniform usampler2D visibilityMap;
+uniform vec2 screenSize;
+
+// bit 0 for a compact layout, then uvs, normals and tangents (see VertexLayout)
+uniform int vertexFormat;
+
+// in words
+uniform int vertexStride;
+
+uniform int shortIndices;
+
+uniform float heightScale;
+
+struct Vertex {
+    vec3 position;
+    vec2 uv;
+    vec3 normal;
+    vec3 tangent;
+};
+
+// perspective correct barycentrics at the pixel center, and how much they change one pixel right and one pixel up
+struct Barycentrics {
+    vec3 lambda;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+
+    return normalize(n);
+}
+
+// the x and y of a GL_INT_2_10_10_10_REV word, normalized
+vec2 unpackSnorm10(uint word)
+{
+    ivec2 v = ivec2(int(word << 22) >> 22, int(word << 12) >> 22);
+
+    return max(vec2(v) / 511.0, -1.0);
+}
+
+uint fetchIndex(uint i)
+{
+    if (shortIndices != 0) {
+        uint word = indexWords[i >> 1];
+
+        return (i & 1u) != 0u ? word >> 16 : word & 0xffffu;
+    }
+
+    return indexWords[i];
+}
+
+// decodes what VertexLayout::Apply points the attributes at
+Vertex fetchVertex(uint index, DrawData draw)
+{
+    uint offset = index * uint(vertexStride);
+
+    Vertex v;
+    v.uv = vec2(0.0);
+    v.normal = vec3(0.0, 0.0, 1.0);
+    v.tangent = vec3(1.0, 0.0, 0.0);
+
+    if ((vertexFormat & 1) == 0) {
+        v.position = uintBitsToFloat(uvec3(vertexWords[offset], vertexWords[offset + 1u], vertexWords[offset + 2u]));
+        offset += 3u;
+
+        if ((vertexFormat & 2) != 0) {
+            v.uv = uintBitsToFloat(uvec2(vertexWords[offset], vertexWords[offset + 1u]));
+            offset += 2u;
+        }
+
+        if ((vertexFormat & 4) != 0) {
+            v.normal = uintBitsToFloat(uvec3(vertexWords[offset], vertexWords[offset + 1u], vertexWords[offset + 2u]));
+            offset += 3u;
+        }
+
+        if ((vertexFormat & 8) != 0) {
+            v.tangent = uintBitsToFloat(uvec3(vertexWords[offset], vertexWords[offset + 1u], vertexWords[offset + 2u]));
+        }
+    } else {
+        uint xy = vertexWords[offset];
+        uint zw = vertexWords[offset + 1u];
+        v.position = vec3(xy & 0xffffu, xy >> 16, zw & 0xffffu) / 65535.0;
+        offset += 2u;
+
+        if ((vertexFormat & 2) != 0) {
+            v.uv = unpackHalf2x16(vertexWords[offset]);
+            offset += 1u;
+        }
+
+        if ((vertexFormat & 4) != 0) {
+            v.normal = octDecode(unpackSnorm10(vertexWords[offset]));
+            offset += 1u;
+        }
+
+        if ((vertexFormat & 8) != 0) {
+            v.tangent = octDecode(unpackSnorm10(vertexWords[offset]));
+        }
+    }
+
+    v.position = draw.posBias.xyz + v.position * draw.posScale.xyz;
+
+    return v;
+}
+
+Barycentrics barycentrics(vec4 clip0, vec4 clip1, vec4 clip2)
+{
+    vec3 invW = 1.0 / vec3(clip0.w, clip1.w, clip2.w);
+    vec2 ndc0 = clip0.xy * invW.x;
+    vec2 ndc1 = clip1.xy * invW.y;
+    vec2 ndc2 = clip2.xy * invW.z;
+
+    // screen space barycentrics are linear in ndc, these are their gradients, already divided by w
+    float invDet = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+    vec3 ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+    vec3 ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+    float ddxSum = ddx.x + ddx.y + ddx.z;
+    float ddySum = ddy.x + ddy.y + ddy.z;
+
+    vec2 delta = gl_FragCoord.xy / screenSize * 2.0 - 1.0 - ndc0;
+    float interpInvW = invW.x + delta.x * ddxSum + delta.y * ddySum;
+
+    Barycentrics b;
+    b.lambda = (vec3(invW.x, 0.0, 0.0) + delta.x * ddx + delta.y * ddy) / interpInvW;
+
+    // the same again a pixel over, as differences
+    vec2 pixel = 2.0 / screenSize;
+    b.ddx = (b.lambda * interpInvW + ddx * pixel.x) / (interpInvW + ddxSum * pixel.x) - b.lambda;
+    b.ddy = (b.lambda * interpInvW + ddy * pixel.y) / (interpInvW + ddySum * pixel.y) - b.lambda;
+
+    return b;
+}
+
+// reaches exactly 0 at the radius, so lights can be skipped past it
+float attenuation(float dist, float radius)
+{
+    float window = clamp(1.0 - pow(dist / radius, 4.0), 0.0, 1.0);
+
+    return window * window / (dist * dist + 1.0);
+}
+
+#ifdef PARALLAX
+// relief_parallax from parallaxmapped_mesh.frag, with the gradients passed along, the neighbouring pixels may be
+// on other triangles
+vec2 reliefParallax(vec2 uv, vec2 uvDx, vec2 uvDy, vec3 tViewDir)
+{
+    const float numLayers = PARALLAX_LAYERS;
+    float layerDepth = 1.0 / numLayers;
+    float currentDepth = 0.0;
+    vec2 deltaUv = tViewDir.xy * heightScale / numLayers;
+
+    vec2 currentUv = uv;
+    float currentDepthMapValue = textureGrad(depthMap, currentUv, uvDx, uvDy).r;
+
+    for (int i = 0; i < PARALLAX_LAYERS && currentDepth < currentDepthMapValue; ++i) {
+        currentUv -= deltaUv;
+        currentDepthMapValue = textureGrad(depthMap, currentUv, uvDx, uvDy).r;
+        currentDepth += layerDepth;
+    }
+
+    deltaUv /= 2;
+    float deltaDepth = layerDepth / 2;
+
+    currentUv += deltaUv;
+    currentDepth += deltaDepth;
+
+    for (int i = 0; i < 10; ++i) {
+        deltaUv /= 2;
+        deltaDepth /= 2;
+
+        currentDepthMapValue = textureGrad(depthMap, currentUv, uvDx, uvDy).r;
+
+        if (currentDepthMapValue > currentDepth) {
+            currentUv -= deltaUv;
+            currentDepth += deltaDepth;
+        } else {
+            currentUv += deltaUv;
+            currentDepth -= deltaDepth;
+        }
+    }
+
+    return currentUv;
+}
+#endif
+
+void main()
+{
+    uvec2 visibility = texelFetch(visibilityMap, ivec2(gl_FragCoord.xy), 0).xy;
+    DrawData draw = draws[visibility.x - 1u];
+
+    uint first = draw.firstIndex + visibility.y * 3u;
+    Vertex v0 = fetchVertex(uint(int(fetchIndex(first)) + draw.baseVertex), draw);
+    Vertex v1 = fetchVertex(uint(int(fetchIndex(first + 1u)) + draw.baseVertex), draw);
+    Vertex v2 = fetchVertex(uint(int(fetchIndex(first + 2u)) + draw.baseVertex), draw);
+
+    vec3 world0 = vec3(draw.model * vec4(v0.position, 1.0));
+    vec3 world1 = vec3(draw.model * vec4(v1.position, 1.0));
+    vec3 world2 = vec3(draw.model * vec4(v2.position, 1.0));
+
+    mat4 projectionView = projection * view;
+    Barycentrics b = barycentrics(projectionView * vec4(world0, 1.0), projectionView * vec4(world1, 1.0),
+                                  projectionView * vec4(world2, 1.0));
+
+    vec3 fragPos = mat3(world0, world1, world2) * b.lambda;
+    mat3x2 uvs = mat3x2(v0.uv, v1.uv, v2.uv);
+    vec2 uv = uvs * b.lambda;
+    vec2 uvDx = uvs * b.ddx;
+    vec2 uvDy = uvs * b.ddy;
+
+    // the same tangent frame bumpmapped_mesh.vert builds, per pixel
+    mat3 invModel = mat3(draw.invModel);
+    vec3 T = normalize(invModel * (mat3(v0.tangent, v1.tangent, v2.tangent) * b.lambda));
+    vec3 N = normalize(invModel * (mat3(v0.normal, v1.normal, v2.normal) * b.lambda));
+    T = normalize(T - dot(T, N) * N);
+    mat3 TBN = mat3(T, cross(N, T), N);
+
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+#ifdef PARALLAX
+    uv = reliefParallax(uv, uvDx, uvDy, transpose(TBN) * viewDir);
+#endif
+
+    vec3 albedo = textureGrad(diffuseMap, uv, uvDx, uvDy).rgb;
+    vec3 spec = textureGrad(specularMap, uv, uvDx, uvDy).rgb;
+    vec3 normal = normalize(TBN * normalize(textureGrad(normalMap, uv, uvDx, uvDy).rgb * 2.0 - 1.0));
+
+    vec3 lightDir = normalize(lightPos - fragPos);
+
+#ifdef PARALLAX
+    float specStr = pow(max(dot(normal, normalize(lightDir + viewDir)), 0.0), 96);
+#else
+    float specStr = pow(max(dot(viewDir, reflect(-lightDir, normal)), 0.0), 96);
+#endif
+
+    vec3 result = 0.1 * lightColor * albedo + max(dot(lightDir, normal), 0.0) * lightColor * albedo + specStr * lightColor * spec;
+
+    for (int i = 0; i < pointLightCount; ++i) {
+        vec3 toLight = pointLights[i].positionRadius.xyz - fragPos;
+        float dist = length(toLight);
+
+        if (dist >= pointLights[i].positionRadius.w) {
+            continue;
+        }
+
+        vec3 pointDir = toLight / dist;
+        vec3 halfway = normalize(pointDir + viewDir);
+
+        float pointDiff = max(dot(pointDir, normal), 0.0);
+        float pointSpec = pow(max(dot(normal, halfway), 0.0), 96);
+
+        result += (pointDiff * albedo + pointSpec * spec) * pointLights[i].color.rgb * attenuation(dist, pointLights[i].positionRadius.w);
+    }
+
+    color = vec4(result, 1.0);
+}
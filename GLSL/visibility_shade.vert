@@ -0,0 +1,16 @@
+#version 430 core
+
+// vertex shader: visibility buffer shading, one triangle covering the screen at the depth of the material being
+// shaded (see VisibilityRenderer)
+
+// (material + 1) / VisibilityRenderer::MAX_MATERIALS, as written by visibility_material.frag
+uniform float materialDepth;
+
+void main()
+{
+    // corners at (-1, -1), (3, -1) and (-1, 3), the part outside the screen gets clipped
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    // maps back to exactly materialDepth with the default depth range, the shading passes test for equality
+    gl_Position = vec4(corner * 2.0 - 1.0, materialDepth * 2.0 - 1.0, 1.0);
+}
@@ -1,3 +1,11 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <random>
+
 #include "SDL.h"
 #include "glad/glad.h"
 #include "stb_image.h"
@@ -9,78 +17,345 @@
 #include "Video/Window.hpp"
 #include "Video/Program.hpp"
 #include "Video/FlyCamera.hpp"
+#include "Video/OcclusionQuery.hpp"
+#include "Video/IndirectRenderer.hpp"
+#include "Video/GpuCuller.hpp"
+#include "Video/FrameUniformBuffer.hpp"
+#include "Video/ProgramPermutations.hpp"
+#include "Video/StateCache.hpp"
+#include "Video/QueryCounter.hpp"
+#include "Video/LightBuffer.hpp"
+#include "Video/DeferredRenderer.hpp"
+#include "Video/ClusteredLights.hpp"
+#include "Video/VisibilityRenderer.hpp"
+#include "Video/RenderGraph.hpp"
+#include "Video/Bloom.hpp"
 
 #include "Util/FS.hpp"
 #include "Util/ObjLoader.hpp"
 #include "Util/AssimpLoader.hpp"
+#include "Util/PVS.hpp"
 
 /// @mainpage
 ///
 /// Trabalho da matéria de Computação Gráfica da UFRRJ (2018.1)
 ///
 
-int main()
+int main(int argc, char** argv)
 {
     using namespace Engine;
 
+    // --stats prints the counters below once a second. It turns vsync off, or the frame time would only ever
+    // show the display's refresh rate
+    bool printStats = false;
+
+    for (int i = 1; i < argc; ++i) {
+        printStats = printStats || strcmp(argv[i], "--stats") == 0;
+    }
+
     SDL_Init(SDL_INIT_EVERYTHING);
 
     Assimp::DefaultLogger::create("", Assimp::Logger::LogSeverity::VERBOSE, aiDefaultLogStream_STDERR);
 
     GL::Window w("ufrrj", 1920, 1080, true, true, 4);
+
+    if (printStats) {
+        w.SetSwapInterval(0);
+    }
+
     Input::SDLInput ipt;
 
     auto mouseLock = false;
     SDL_SetRelativeMouseMode(static_cast<SDL_bool>(mouseLock));
 
-    glEnable(GL_DEPTH_TEST);
+    GL::StateCache::Enable(GL_DEPTH_TEST);
+
+    // forward loops over every point light for every fragment, deferred lights a G-buffer afterwards and clustered
+    // only loops over the lights binned into the fragment's cluster. The visibility buffer shades each pixel once
+    // with shaders of its own, anything else gets drawn forward. F11 steps through them
+    enum class Lighting { Forward, Deferred, Clustered, Visibility };
+    const char* lightingDefines[] = {"POINT_LIGHTS", "DEFERRED", "CLUSTERED", "POINT_LIGHTS"};
+    const char* lightingNames[] = {"forward", "deferred", "clustered", "visibility buffer"};
+
+    GL::ShaderDefines pointLightDefines{{"POINT_LIGHTS", "1"}};
+    GL::ShaderDefines deferredDefines{{"DEFERRED", "1"}};
+    GL::ShaderDefines clusteredDefines{{"CLUSTERED", "1"}};
 
     GL::Program prog;
-    prog.AttachShader("GLSL/bumpmapped_mesh.vert", GL::ShaderType::Vertex);
-    prog.AttachShader("GLSL/bumpmapped_mesh.frag", GL::ShaderType::Fragment);
-    prog.Link();
+    prog.AttachShader("GLSL/bumpmapped_mesh.vert", GL::ShaderType::Vertex, pointLightDefines);
+    prog.AttachShader("GLSL/bumpmapped_mesh.frag", GL::ShaderType::Fragment, pointLightDefines);
+
+    // the same shaders writing the G-buffer, lit by DeferredRenderer afterwards
+    GL::Program deferredProg;
+    deferredProg.AttachShader("GLSL/bumpmapped_mesh.vert", GL::ShaderType::Vertex, deferredDefines);
+    deferredProg.AttachShader("GLSL/bumpmapped_mesh.frag", GL::ShaderType::Fragment, deferredDefines);
+
+    GL::Program clusteredProg;
+    clusteredProg.AttachShader("GLSL/bumpmapped_mesh.vert", GL::ShaderType::Vertex, clusteredDefines);
+    clusteredProg.AttachShader("GLSL/bumpmapped_mesh.frag", GL::ShaderType::Fragment, clusteredDefines);
+
+    GL::Program* litProgs[] = {&prog, &deferredProg, &clusteredProg, &prog};
 
     GL::Program prog2;
     prog2.AttachShader("GLSL/simple_mesh.vert", GL::ShaderType::Vertex);
     prog2.AttachShader("GLSL/simple_mesh.frag", GL::ShaderType::Fragment);
-    prog2.Link();
 
     GL::Program* mainProg = &prog;
 
+    GL::Program instancedProg;
+    instancedProg.AttachShader("GLSL/bumpmapped_mesh_instanced.vert", GL::ShaderType::Vertex);
+    instancedProg.AttachShader("GLSL/bumpmapped_mesh.frag", GL::ShaderType::Fragment);
+
+    GL::Program instancedProg2;
+    instancedProg2.AttachShader("GLSL/simple_mesh_instanced.vert", GL::ShaderType::Vertex);
+    instancedProg2.AttachShader("GLSL/simple_mesh.frag", GL::ShaderType::Fragment);
+
+    GL::Program* crowdProg = &instancedProg;
+
     GL::Program lampProgram;
     lampProgram.AttachShader("GLSL/simple_mesh.vert", GL::ShaderType::Vertex);
     lampProgram.AttachShader("GLSL/fullbright.frag", GL::ShaderType::Fragment);
-    lampProgram.Link();
 
-    GL::Program parallaxProgram;
-    parallaxProgram.AttachShader("GLSL/bumpmapped_mesh.vert", GL::ShaderType::Vertex);
-    parallaxProgram.AttachShader("GLSL/parallaxmapped_mesh.frag", GL::ShaderType::Fragment);
-    parallaxProgram.Link();
+    // one program per parallax technique and layer count, built as they get used. Simple parallax doesn't march
+    // layers, so it gets a single variant
+    GL::ProgramPermutations parallaxVariants;
+    parallaxVariants.AttachShader("GLSL/bumpmapped_mesh.vert", GL::ShaderType::Vertex);
+    parallaxVariants.AttachShader("GLSL/parallaxmapped_mesh.frag", GL::ShaderType::Fragment);
+
+    auto parallaxDefines = [&lightingDefines](int technique, int layers, Lighting lighting) {
+        GL::ShaderDefines defines{{"PARALLAX_TECHNIQUE", std::to_string(technique)}};
+
+        if (technique != 0) {
+            defines["PARALLAX_LAYERS"] = std::to_string(layers);
+        }
+
+        defines[lightingDefines[static_cast<int>(lighting)]] = "1";
+
+        return defines;
+    };
+
+    // drawn while the variant that's actually wanted is still compiling
+    GL::Program* parallaxFallbacks[] = {
+            &parallaxVariants.Build(parallaxDefines(0, 0, Lighting::Forward)),
+            &parallaxVariants.Build(parallaxDefines(0, 0, Lighting::Deferred)),
+            &parallaxVariants.Build(parallaxDefines(0, 0, Lighting::Clustered)),
+            &parallaxVariants.Build(parallaxDefines(0, 0, Lighting::Visibility)),
+    };
 
-    GL::Program* parallaxPointer = &parallaxProgram;
+    GL::Program boundingBoxProgram;
+    boundingBoxProgram.AttachShader("GLSL/bounding_box.vert", GL::ShaderType::Vertex);
+    boundingBoxProgram.AttachShader("GLSL/fullbright.frag", GL::ShaderType::Fragment);
 
-    auto nanosuit = Util::AssimpLoader::LoadModel("cyborg.obj");
+    GL::Program depthProgram;
+    depthProgram.AttachShader("GLSL/depth_only.vert", GL::ShaderType::Vertex);
+    depthProgram.AttachShader("GLSL/depth_only.frag", GL::ShaderType::Fragment);
+
+    // submitted together so the driver can compile them side by side
+    GL::Program::LinkAll({&prog, &deferredProg, &clusteredProg, &prog2, &instancedProg, &instancedProg2, &lampProgram, &boundingBoxProgram, &depthProgram});
+
+    // the multi draw indirect path needs a 4.3 context, everything else keeps working without it
+    std::optional<GL::IndirectRenderer> indirectRenderer;
+    std::optional<GL::Program> mdiProg, mdiProg2, mdiLampProgram;
+
+    if (GL::IndirectRenderer::IsSupported()) {
+        indirectRenderer.emplace();
+
+        mdiProg.emplace();
+        mdiProg->AttachShader("GLSL/bumpmapped_mesh_mdi.vert", GL::ShaderType::Vertex);
+        mdiProg->AttachShader("GLSL/bumpmapped_mesh.frag", GL::ShaderType::Fragment);
+
+        mdiProg2.emplace();
+        mdiProg2->AttachShader("GLSL/simple_mesh_mdi.vert", GL::ShaderType::Vertex);
+        mdiProg2->AttachShader("GLSL/simple_mesh.frag", GL::ShaderType::Fragment);
+
+        mdiLampProgram.emplace();
+        mdiLampProgram->AttachShader("GLSL/simple_mesh_mdi.vert", GL::ShaderType::Vertex);
+        mdiLampProgram->AttachShader("GLSL/fullbright.frag", GL::ShaderType::Fragment);
+
+        GL::Program::LinkAll({&*mdiProg, &*mdiProg2, &*mdiLampProgram});
+    } else {
+        printf("multi draw indirect unavailable, needs gl 4.3\n");
+    }
+
+    Util::AssimpLoader::LoadOptions nanosuitOptions;
+    nanosuitOptions.vertexFormat = GL::VertexFormat::Compact;
+    nanosuitOptions.buildMeshlets = true;
+    nanosuitOptions.lodLevels = 4;
+
+    auto nanosuit = Util::AssimpLoader::LoadModel("cyborg.obj", nanosuitOptions);
+    nanosuit.PrintStats("cyborg.obj");
 
     auto cube = Util::AssimpLoader::LoadModel("cube.obj");
+    cube.PrintStats("cube.obj");
 
     auto tex_cube = Util::AssimpLoader::LoadModel("tex_cube.obj");
+    tex_cube.PrintStats("tex_cube.obj");
+
+    // every mesh in the scene gets a sphere in one table, so the whole scene is frustum culled in one go
+    Util::CullTable cullTable;
+    nanosuit.AddToCullTable(cullTable);
+    cube.AddToCullTable(cullTable);
+    tex_cube.AddToCullTable(cullTable);
+
+    // how deep tex_cube's parallax relief goes, as a fraction of a face's texture
+    const float heightScale = 0.1f;
+
+    // the textured cube is solid, so it can hide whatever is behind it. Parallax mapping shows its faces up to
+    // heightScale of a face further in and discards fragments that step outside the face, so its own mesh isn't
+    // entirely inside what gets drawn. A box shrunk by that much on every side is
+    auto occluderInset = (tex_cube.GetAabbMax() - tex_cube.GetAabbMin()) * heightScale;
+    auto occluder = Util::MakeBox(tex_cube.GetAabbMin() + occluderInset, tex_cube.GetAabbMax() - occluderInset);
+    Util::OcclusionBuffer occlusionBuffer;
+
+    // a potentially visible set for the models that stay put, baked with PVSBaker placing them like cubeModel and
+    // mdl below: pvsbaker scene.pvs <cell size> cube.obj --translate 5 0 0 --scale 0.5 tex_cube.obj --translate 3 1.5 0
+    // --rotate-y 90. The nanosuit spins, so no cell's set can speak for it and it's left to the other culling.
+    // Only used if someone baked one for the scene
+    std::optional<Util::PVS> pvs;
+    GL::Model* pvsObjects[] = {&cube, &tex_cube};
+
+    if (std::ifstream("scene.pvs")) {
+        pvs = Util::PVS::Load("scene.pvs");
+
+        if (pvs->GetObjectCount() != std::size(pvsObjects)) {
+            fprintf(stderr, "scene.pvs has %zu objects instead of %zu, ignoring it\n", pvs->GetObjectCount(), std::size(pvsObjects));
+            pvs.reset();
+        }
+    }
+
+    GL::RenderQueue renderQueue;
+    GL::FrameUniformBuffer frameUniforms;
+
+    // a crowd of cyborgs behind the scene, drawn instanced with one draw call per mesh
+    constexpr size_t crowdSide = 100;
+    std::vector<glm::mat4> crowd, visibleCrowd;
+    Util::CullTable crowdTable;
+
+    for (size_t i = 0; i < crowdSide * crowdSide; ++i) {
+        auto transform = glm::translate(glm::mat4(1.0f), {(i % crowdSide) * 3.0f - crowdSide * 1.5f, 0.0f, -10.0f - (i / crowdSide) * 3.0f});
+        transform = glm::scale(transform, {0.5f, 0.5f, 0.5f});
+
+        crowd.push_back(transform);
+        crowdTable.Add(glm::vec3(transform * glm::vec4(nanosuit.GetCenter(), 1.0f)), nanosuit.GetRadius() * 0.5f);
+    }
+
+    // the same crowd culled by a compute shader, against the frustum and last frame's depth
+    std::optional<GL::GpuCuller> gpuCuller;
+    std::optional<GL::DepthPyramid> depthPyramid;
+    glm::mat4 previousProjectionView(1.0f);
+    bool havePyramid = false;
+
+    if (GL::GpuCuller::IsSupported()) {
+        gpuCuller.emplace();
+        gpuCuller->SetInstances(crowd, nanosuit.GetCenter(), nanosuit.GetRadius());
+        depthPyramid.emplace();
+    }
+
+    // the parallax shaders make tex_cube the most expensive draw per pixel, so it gets a hardware query too
+    GL::OcclusionQuery texCubeQuery;
 
+    // samples that reach the fragment shaders, the depth pre-pass is there to bring this down
+    GL::QueryCounter shadedSamples(GL_SAMPLES_PASSED);
+
+    // gpu time of the scene's lit draws, to compare the lighting paths as the light count goes up
+    GL::QueryCounter sceneTime(GL_TIME_ELAPSED);
+
+    // point lights scattered around the scene, each circling its own spot. The forward programs loop over all of
+    // them per fragment, the deferred renderer draws a volume per light, the clustered programs loop over the ones
+    // binned into their cluster. Everything but clustered stops at LightBuffer::MAX_LIGHTS
+    GL::LightBuffer lightBuffer;
+    GL::DeferredRenderer deferredRenderer;
+    GL::ClusteredLights clusteredLights;
+
+    // storage blocks in the vertex and fragment shaders, like the multi draw path
+    std::optional<GL::VisibilityRenderer> visibilityRenderer;
+
+    if (GL::VisibilityRenderer::IsSupported()) {
+        visibilityRenderer.emplace();
+        visibilityRenderer->SetHeightScale(heightScale);
+    }
+
+    // post processing, declared as render graph passes every frame. The graph orders them, culls the ones nothing
+    // reads and has transient targets whose lifetimes don't overlap share a texture. Without the bloom composite,
+    // B toggles it, the rest of the bloom passes get culled
+    GL::RenderGraph renderGraph;
+    GL::Bloom bloom;
+
+    std::vector<GL::PointLight> pointLights, lightAnchors;
+    std::mt19937 lightRng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    for (size_t i = 0; i < 1024; ++i) {
+        GL::PointLight light{};
+        light.position = {unit(lightRng) * 16.0f - 8.0f, unit(lightRng) * 5.0f - 1.0f, unit(lightRng) * 10.0f - 6.0f};
+        light.radius = 1.5f + unit(lightRng) * 2.5f;
+        light.color = glm::vec3(unit(lightRng), unit(lightRng), unit(lightRng)) * 2.0f;
+
+        lightAnchors.push_back(light);
+    }
+
+    // spot lights hanging over the scene, only the clustered programs know about them
+    std::vector<GL::SpotLight> spotLights;
+
+    for (size_t i = 0; i < 16; ++i) {
+        GL::SpotLight light{};
+        light.position = {unit(lightRng) * 16.0f - 8.0f, 4.0f, unit(lightRng) * 10.0f - 6.0f};
+        light.radius = 8.0f;
+        light.color = glm::vec3(unit(lightRng), unit(lightRng), unit(lightRng)) * 4.0f;
+        light.cosAngle = std::cos(glm::radians(20.0f + unit(lightRng) * 15.0f));
+        light.direction = glm::normalize(glm::vec3(unit(lightRng) - 0.5f, -2.0f, unit(lightRng) - 0.5f));
+
+        spotLights.push_back(light);
+    }
+
+    // what F12 steps through
+    const size_t lightCounts[] = {0, 16, 64, 256, 1024};
+    size_t lightCountIndex = 2;
 
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
 
+    // the slices start a little past the near plane, the first few would be too thin to be worth binning into
+    clusteredLights.SetProjection(projection, 0.5f, 100.0f);
+
     auto model = glm::mat4(1.0f);
     model = glm::scale(model, {0.5f, 0.5f, 0.5f});
 
-    auto invModel = glm::inverseTranspose(glm::mat3(model));
-
     auto camera = FlyCamera();
 
     auto lightPos = glm::vec3(5.0f, 0.0f, 0.0f);
 
     int technique = 0;
+    bool parallaxMapping = true;
+    bool meshletCulling = true;
+    bool occlusionCulling = true;
+    bool occlusionQueries = true;
+    bool drawCrowd = false;
+    bool multiDraw = indirectRenderer.has_value();
+    bool gpuCulling = gpuCuller.has_value();
+    bool depthPrepass = true;
+    bool bloomComposite = true;
+    auto lighting = Lighting::Forward;
+
+    // frame time and triangle counts get averaged over a second, and printed with --stats
+    GL::DrawStats drawStats;
+    GL::RenderStats renderStats;
+    GL::IndirectStats indirectStats;
+    uint32_t frames = 0, statsStart = SDL_GetTicks();
+    uint64_t cullTicks = 0;
+    uint64_t binTicks = 0;
+    size_t visibleMeshes = 0, occludedMeshes = 0, texCubeHidden = 0, crowdDrawn = 0;
+
+    // run twice to compare, the first run with an empty shadercache directory fills it
+    const auto& cacheStats = GL::Program::GetCacheStats();
+    printf("startup: %u ms, shader programs %zu loaded from the binary cache and %zu compiled in %.1f ms\n",
+           SDL_GetTicks(), cacheStats.loaded, cacheStats.compiled, cacheStats.milliseconds);
+
     while (!ipt.IsQuitRequested()) {
         ipt.Update();
 
+        // submits the variants asked for last frame and picks up whichever the driver has finished
+        parallaxVariants.Update();
+
         if (ipt.ConsumeKey(Input::Keys::F1)) {
             mouseLock = !mouseLock;
             SDL_SetRelativeMouseMode(static_cast<SDL_bool>(mouseLock));
@@ -89,73 +364,468 @@ int main()
         if (ipt.ConsumeKey(Input::Keys::F2)) {
             if (mainProg == &prog) {
                 mainProg = &prog2;
-                parallaxPointer = &prog;
+                crowdProg = &instancedProg2;
             } else {
                 mainProg = &prog;
-                parallaxPointer = &parallaxProgram;
+                crowdProg = &instancedProg;
             }
+
+            parallaxMapping = !parallaxMapping;
         }
 
         if (ipt.ConsumeKey(Input::Keys::F3)) {
             technique = (technique + 1) % 3;
         }
 
+        if (ipt.ConsumeKey(Input::Keys::F4)) {
+            meshletCulling = !meshletCulling;
+        }
+
+        if (ipt.ConsumeKey(Input::Keys::F5)) {
+            occlusionCulling = !occlusionCulling;
+        }
+
+        if (ipt.ConsumeKey(Input::Keys::F6)) {
+            occlusionQueries = !occlusionQueries;
+        }
+
+        if (ipt.ConsumeKey(Input::Keys::F7)) {
+            drawCrowd = !drawCrowd;
+        }
+
+        if (ipt.ConsumeKey(Input::Keys::F8)) {
+            multiDraw = !multiDraw && indirectRenderer.has_value();
+        }
+
+        if (ipt.ConsumeKey(Input::Keys::F9)) {
+            gpuCulling = !gpuCulling && gpuCuller.has_value();
+        }
+
+        if (ipt.ConsumeKey(Input::Keys::F10)) {
+            depthPrepass = !depthPrepass;
+        }
+
+        if (ipt.ConsumeKey(Input::Keys::F11)) {
+            lighting = static_cast<Lighting>((static_cast<int>(lighting) + 1) % std::size(lightingNames));
+
+            if (lighting == Lighting::Visibility && !visibilityRenderer) {
+                lighting = Lighting::Forward;
+            }
+        }
+
+        bool deferred = lighting == Lighting::Deferred;
+        bool clustered = lighting == Lighting::Clustered;
+        bool visibility = lighting == Lighting::Visibility;
+
+        // the scene, tex_cube included, gets drawn and lit by a renderer of its own
+        bool screenSpace = deferred || visibility;
+
+        if (ipt.ConsumeKey(Input::Keys::F12)) {
+            lightCountIndex = (lightCountIndex + 1) % std::size(lightCounts);
+        }
+
+        if (ipt.ConsumeKey(Input::Keys::B)) {
+            bloomComposite = !bloomComposite;
+        }
+
         glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        mainProg->Use();
-        mainProg->SetUniform("projection", projection);
-        mainProg->SetUniform("objColor", glm::vec3{0.3f, 0.6f, 0.1f});
-        mainProg->SetUniform("lightColor", glm::vec3{1.0f, 1.0f, 1.0f});
-        mainProg->SetUniform("lightPos", lightPos);
-        mainProg->SetUniform("viewPos", camera.GetPosition());
-        mainProg->SetUniform("diffuseMap", 0);
-        mainProg->SetUniform("specularMap", 1);
-        mainProg->SetUniform("normalMap", 2);
+        // the multi draw programs run the same fragment shaders, only the vertex shaders fetch per draw data differently
+        auto sceneProg = clustered && mainProg == &prog ? &clusteredProg : mainProg;
+        auto sceneLampProg = &lampProgram;
+
+        if (multiDraw) {
+            sceneProg = mainProg == &prog ? &*mdiProg : &*mdiProg2;
+            sceneLampProg = &*mdiLampProgram;
+        }
 
         camera.Update(ipt);
-        mainProg->SetUniform("view", camera.GetViewMatrix());
+
+        // camera and light for every program at once, the programs only get what's specific to them
+        GL::FrameData frameData{};
+        frameData.projection = projection;
+        frameData.view = camera.GetViewMatrix();
+        frameData.viewPos = camera.GetPosition();
+        frameData.lightPos = lightPos;
+        frameData.lightColor = glm::vec3{1.0f, 1.0f, 1.0f};
+        frameUniforms.Update(frameData);
+
+        pointLights.clear();
+
+        for (size_t i = 0; i < lightCounts[lightCountIndex]; ++i) {
+            auto light = lightAnchors[i];
+            auto angle = SDL_GetTicks() / 1000.0f + i;
+            light.position += glm::vec3(std::sin(angle), 0.0f, std::cos(angle)) * 0.5f;
+
+            pointLights.push_back(light);
+        }
+
+        lightBuffer.Update(pointLights);
+
+        if (clustered) {
+            auto binStart = SDL_GetPerformanceCounter();
+            clusteredLights.Update(pointLights, spotLights, camera.GetViewMatrix());
+            binTicks += SDL_GetPerformanceCounter() - binStart;
+        }
+
+        sceneProg->Use();
+        sceneProg->SetUniform("objColor", glm::vec3{0.3f, 0.6f, 0.1f});
+        sceneProg->SetUniform("diffuseMap", 0);
+        sceneProg->SetUniform("specularMap", 1);
+        sceneProg->SetUniform("normalMap", 2);
+
+        deferredProg.Use();
+        deferredProg.SetUniform("diffuseMap", 0);
+        deferredProg.SetUniform("specularMap", 1);
+        deferredProg.SetUniform("normalMap", 2);
 
         auto rotmodel = glm::rotate(model, SDL_GetTicks() / 2000.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-        mainProg->SetUniform("model", rotmodel);
 
-        invModel = glm::inverseTranspose(glm::mat3(rotmodel));
-        mainProg->SetUniform("invModel", invModel);
-        nanosuit.Draw();
+        auto mdl = glm::mat4(1.0f);
+        mdl = glm::translate(mdl, {3.0f, 1.5f, 0.0f});
+        mdl = glm::rotate(mdl, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        auto cubeModel = glm::translate(glm::mat4(1), lightPos);
+        cubeModel = glm::scale(cubeModel, {0.5f, 0.5f, 0.5f});
+
+        auto cullStart = SDL_GetPerformanceCounter();
+
+        nanosuit.UpdateCullTable(cullTable, rotmodel);
+        cube.UpdateCullTable(cullTable, cubeModel);
+        tex_cube.UpdateCullTable(cullTable, mdl);
+
+        visibleMeshes += cullTable.Cull(Util::Frustum(projection * camera.GetViewMatrix()));
+
+        nanosuit.UpdateVisibility(cullTable);
+        cube.UpdateVisibility(cullTable);
+        tex_cube.UpdateVisibility(cullTable);
+
+        if (pvs) {
+            const auto& visibleSet = pvs->Lookup(camera.GetPosition());
+
+            for (size_t i = 0; i < std::size(pvsObjects); ++i) {
+                if (!visibleSet[i]) {
+                    pvsObjects[i]->Hide();
+                }
+            }
+        }
+
+        if (occlusionCulling) {
+            auto projectionView = projection * camera.GetViewMatrix();
+
+            occlusionBuffer.Clear();
+            occlusionBuffer.RasterizeOccluder(occluder.positions, occluder.indices, projectionView * mdl);
+            occlusionBuffer.BuildHierarchy();
+
+            occludedMeshes += nanosuit.ApplyOcclusion(occlusionBuffer, projectionView * rotmodel);
+            occludedMeshes += cube.ApplyOcclusion(occlusionBuffer, projectionView * cubeModel);
+        }
+
+        cullTicks += SDL_GetPerformanceCounter() - cullStart;
+
+        nanosuit.SelectLod(projection, rotmodel, camera.GetPosition(), 1080.0f);
+
+        // steep and relief march more layers up close, where their stepping would show
+        auto cubeDistance = glm::distance(camera.GetPosition(), glm::vec3(mdl[3]));
+        int layers = cubeDistance < 3.0f ? 32 : cubeDistance < 8.0f ? 16 : 8;
+
+        GL::Program* parallaxPointer = litProgs[static_cast<int>(lighting)];
+
+        if (parallaxMapping) {
+            auto variant = parallaxVariants.Find(parallaxDefines(technique, layers, lighting));
+            parallaxPointer = variant != nullptr ? variant : parallaxFallbacks[static_cast<int>(lighting)];
+        }
+
+        if (clustered) {
+            clusteredLights.Apply(clusteredProg);
+            clusteredLights.Apply(*parallaxPointer);
+        }
 
         parallaxPointer->Use();
-        parallaxPointer->SetUniform("projection", projection);
         parallaxPointer->SetUniform("objColor", glm::vec3{0.3f, 0.6f, 0.1f});
-        parallaxPointer->SetUniform("lightColor", glm::vec3{1.0f, 1.0f, 1.0f});
-        parallaxPointer->SetUniform("lightPos", lightPos);
-        parallaxPointer->SetUniform("viewPos", camera.GetPosition());
-        parallaxPointer->SetUniform("view", camera.GetViewMatrix());
-        parallaxPointer->SetUniform("heightScale", 0.1f);
+        parallaxPointer->SetUniform("heightScale", heightScale);
         parallaxPointer->SetUniform("diffuseMap", 0);
         parallaxPointer->SetUniform("specularMap", 1);
         parallaxPointer->SetUniform("normalMap", 2);
         parallaxPointer->SetUniform("depthMap", 3);
-        parallaxPointer->SetUniform("parallaxSwitch", technique);
 
-        auto mdl = glm::mat4(1.0f);
-        mdl = glm::translate(mdl, {3.0f, 1.5f, 0.0f});
-        mdl = glm::rotate(mdl, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        parallaxPointer->SetUniform("model", mdl);
-        parallaxPointer->SetUniform("invModel", glm::inverseTranspose(glm::mat3(mdl)));
+        sceneTime.Begin();
+
+        if (deferred) {
+            // everything lit goes to the G-buffer, with the render queue: the multi draw programs and the pre-pass
+            // are forward only, and writing the G-buffer already costs one shading pass per pixel
+            deferredRenderer.BeginGeometry();
+            shadedSamples.Begin();
+
+            renderQueue.Begin(projection * camera.GetViewMatrix(), camera.GetPosition());
+            nanosuit.Submit(renderQueue, deferredProg, rotmodel, GL::RenderPass::Opaque, meshletCulling);
+            renderQueue.Execute(renderStats, drawStats);
+
+            parallaxPointer->Use();
+            parallaxPointer->SetUniform("model", mdl);
+            parallaxPointer->SetUniform("invModel", glm::inverseTranspose(glm::mat3(mdl)));
+            tex_cube.Draw();
+
+            deferredRenderer.Resolve(lightBuffer, glm::inverse(projection * camera.GetViewMatrix()));
+            sceneTime.End();
+
+            // the lamp is unlit, it goes on top forward like the crowd
+            renderQueue.Begin(projection * camera.GetViewMatrix(), camera.GetPosition());
+            cube.Submit(renderQueue, lampProgram, cubeModel, GL::RenderPass::Opaque);
+            renderQueue.Execute(renderStats, drawStats);
+        } else if (visibility) {
+            // tex_cube goes in too, its relief parallax is what gains the most from running once per pixel.
+            // The renderer's full screen passes would count every pixel again, so the sample counter only sees
+            // what's drawn forward afterwards
+            visibilityRenderer->Begin();
+            nanosuit.SubmitVisibility(*visibilityRenderer, rotmodel);
+            tex_cube.SubmitVisibility(*visibilityRenderer, mdl);
+            visibilityRenderer->Execute(indirectStats, drawStats);
+            sceneTime.End();
+
+            shadedSamples.Begin();
+
+            renderQueue.Begin(projection * camera.GetViewMatrix(), camera.GetPosition());
+            cube.Submit(renderQueue, lampProgram, cubeModel, GL::RenderPass::Opaque);
+            renderQueue.Execute(renderStats, drawStats);
+        } else if (multiDraw) {
+            shadedSamples.Begin();
+
+            // meshlet culling needs a draw per meshlet run, so the multi draw path draws the meshes whole.
+            // The pool has no position only streams, so there's no depth pre-pass here either
+            indirectRenderer->Begin();
+            nanosuit.SubmitIndirect(*indirectRenderer, *sceneProg, rotmodel);
+            cube.SubmitIndirect(*indirectRenderer, *sceneLampProg, cubeModel);
+            indirectRenderer->Execute(indirectStats, drawStats);
+        } else {
+            // the queue sets model and invModel itself, everything else is in the frame uniforms or was set above
+            auto scenePass = GL::RenderPass::Opaque;
+
+            // executed on its own so the sample counter only sees the shading passes
+            if (depthPrepass) {
+                renderQueue.Begin(projection * camera.GetViewMatrix(), camera.GetPosition());
+                nanosuit.Submit(renderQueue, depthProgram, rotmodel, GL::RenderPass::Depth, meshletCulling);
+                cube.Submit(renderQueue, depthProgram, cubeModel, GL::RenderPass::Depth);
+                GL::DrawStats prepassStats;
+                renderQueue.Execute(renderStats, prepassStats);
+
+                scenePass = GL::RenderPass::OpaqueEqual;
+            }
 
-        tex_cube.Draw();
+            shadedSamples.Begin();
 
-        lampProgram.Use();
-        lampProgram.SetUniform("projection", projection);
-        lampProgram.SetUniform("view", camera.GetViewMatrix());
-        auto cubeModel = glm::translate(glm::mat4(1), lightPos);
-        cubeModel = glm::scale(cubeModel, {0.5f, 0.5f, 0.5f});
-        lampProgram.SetUniform("model", cubeModel);
+            renderQueue.Begin(projection * camera.GetViewMatrix(), camera.GetPosition());
+            nanosuit.Submit(renderQueue, *sceneProg, rotmodel, scenePass, meshletCulling);
+            cube.Submit(renderQueue, *sceneLampProg, cubeModel, scenePass);
+            renderQueue.Execute(renderStats, drawStats);
+        }
+
+        if (!screenSpace) {
+            sceneTime.End();
+        }
+
+        if (drawCrowd && gpuCulling) {
+            auto projectionView = projection * camera.GetViewMatrix();
+            gpuCuller->Cull(nanosuit, projectionView, havePyramid ? &*depthPyramid : nullptr, previousProjectionView);
+        } else if (drawCrowd) {
+            crowdTable.Cull(Util::Frustum(projection * camera.GetViewMatrix()));
+            visibleCrowd.clear();
+
+            for (size_t i = 0; i < crowd.size(); ++i) {
+                if (crowdTable.IsVisible(i)) {
+                    visibleCrowd.push_back(crowd[i]);
+                }
+            }
+        }
 
-        cube.Draw();
+        if (drawCrowd) {
+            crowdProg->Use();
+            crowdProg->SetUniform("objColor", glm::vec3{0.3f, 0.6f, 0.1f});
+            crowdProg->SetUniform("diffuseMap", 0);
+            crowdProg->SetUniform("specularMap", 1);
+            crowdProg->SetUniform("normalMap", 2);
 
+            if (gpuCulling) {
+                nanosuit.DrawInstancedIndirect(gpuCuller->GetInstanceBuffer(), gpuCuller->GetCommandBuffer());
+            } else {
+                nanosuit.DrawInstanced(visibleCrowd.data(), visibleCrowd.size());
+                crowdDrawn += visibleCrowd.size();
+            }
+        }
+
+        shadedSamples.End();
+
+        // tex_cube goes last so everything that can hide it is already in the depth buffer when its box is tested.
+        // The box can't tell anything while the camera is inside it, its front faces are behind the near plane
+        auto localCamera = glm::vec3(glm::inverse(mdl) * glm::vec4(camera.GetPosition(), 1.0f));
+        bool insideBox = glm::all(glm::greaterThanEqual(localCamera, tex_cube.GetAabbMin() - 0.2f)) &&
+                         glm::all(glm::lessThanEqual(localCamera, tex_cube.GetAabbMax() + 0.2f));
+        bool useQuery = occlusionQueries && !insideBox && !screenSpace;
+
+        if (useQuery) {
+            boundingBoxProgram.Use();
+            boundingBoxProgram.SetUniform("model", mdl);
+            boundingBoxProgram.SetUniform("aabbMin", tex_cube.GetAabbMin());
+            boundingBoxProgram.SetUniform("aabbMax", tex_cube.GetAabbMax());
+
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDepthMask(GL_FALSE);
+
+            texCubeQuery.Issue();
+
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthMask(GL_TRUE);
+        }
+
+        // parallax mapping discards, so tex_cube stays out of the pre-pass and gets tested against what's there.
+        // The deferred and visibility buffer paths have drawn it already
+        if (!screenSpace) {
+            parallaxPointer->Use();
+            parallaxPointer->SetUniform("model", mdl);
+            parallaxPointer->SetUniform("invModel", glm::inverseTranspose(glm::mat3(mdl)));
+
+            shadedSamples.Begin();
+            sceneTime.Begin();
+        }
+
+        if (screenSpace) {
+            texCubeQuery.Reset();
+        } else if (useQuery) {
+            texCubeQuery.BeginConditional();
+            tex_cube.Draw();
+            texCubeQuery.EndConditional();
+            texCubeQuery.NextFrame();
+
+            texCubeHidden += !texCubeQuery.WasVisible();
+        } else {
+            texCubeQuery.Reset();
+            tex_cube.Draw();
+        }
+
+        if (!screenSpace) {
+            sceneTime.End();
+            shadedSamples.End();
+        }
+
+        shadedSamples.NextFrame();
+        sceneTime.NextFrame();
+
+        // next frame's crowd gets tested against what ended up on screen this frame
+        havePyramid = drawCrowd && gpuCulling;
+
+        if (havePyramid) {
+            depthPyramid->Build();
+            previousProjectionView = projection * camera.GetViewMatrix();
+        }
+
+        GLint screenViewport[4];
+        glGetIntegerv(GL_VIEWPORT, screenViewport);
+
+        renderGraph.Reset();
+        auto backbuffer = renderGraph.ImportBackbuffer();
+        auto bloomTexture = bloom.AddPasses(renderGraph, backbuffer, screenViewport[2], screenViewport[3]);
+
+        if (bloomComposite) {
+            bloom.AddComposite(renderGraph, bloomTexture, backbuffer);
+        }
+
+        renderGraph.Execute();
 
         w.Present();
+
+        frames++;
+
+        if (auto now = SDL_GetTicks(); now - statsStart >= 1000) {
+            if (printStats) {
+                printf("%.2f ms/frame, meshlet culling %s, lod %zu, %zu of %zu queued triangles drawn\n"
+                       "%.1f us/frame frustum and occlusion culling, %zu of %zu meshes in the frustum, %zu of them occluded (occlusion culling %s)\n",
+                       static_cast<float>(now - statsStart) / frames,
+                       meshletCulling ? "on" : "off",
+                       nanosuit.GetLod(),
+                       drawStats.trianglesDrawn / frames, drawStats.trianglesTotal / frames,
+                       cullTicks * 1e6 / SDL_GetPerformanceFrequency() / frames,
+                       visibleMeshes / frames, cullTable.Size(), occludedMeshes / frames,
+                       occlusionCulling ? "on" : "off");
+                printf("tex_cube hidden by its occlusion query in %zu of %u frames (queries %s)\n",
+                       texCubeHidden, frames, occlusionQueries ? "on" : "off");
+
+                if (visibility) {
+                    printf("visibility buffer: %zu draws in %zu multi draws, %zu material passes, %zu KiB pooled geometry\n",
+                           indirectStats.draws / frames, indirectStats.multiDraws / frames,
+                           visibilityRenderer->GetMaterialCount(), visibilityRenderer->GetPool().GetSize() / 1024);
+                } else if (multiDraw) {
+                    printf("multi draw indirect: %zu draws in %zu calls per frame, %zu KiB pooled geometry\n",
+                           indirectStats.draws / frames, indirectStats.multiDraws / frames,
+                           indirectRenderer->GetPool().GetSize() / 1024);
+                } else {
+                    printf("render queue: %zu draws, %zu program, %zu material and %zu geometry changes per frame (%zu unsorted)\n",
+                           renderStats.draws / frames, renderStats.programChanges / frames, renderStats.materialChanges / frames,
+                           renderStats.geometryChanges / frames, renderStats.unsortedChanges / frames);
+                }
+
+                const auto& uniformStats = GL::Program::GetUniformStats();
+                printf("uniforms: %zu uploaded, %zu skipped as unchanged per frame\n",
+                       uniformStats.uploads / frames, uniformStats.skipped / frames);
+
+                GLint viewport[4], samples = 0;
+                glGetIntegerv(GL_VIEWPORT, viewport);
+                glGetIntegerv(GL_SAMPLES, &samples);
+
+                auto screenSamples = static_cast<double>(viewport[2]) * viewport[3] * std::max(samples, 1);
+                printf("shading: %.2f samples shaded per screen sample (depth pre-pass %s)\n",
+                       shadedSamples.GetAverage() / screenSamples, depthPrepass && !multiDraw && !screenSpace ? "on" : "off");
+
+                printf("lighting: %s, %zu lights, %.2f ms gpu time for the lit scene\n",
+                       lightingNames[static_cast<int>(lighting)], clustered ? clusteredLights.GetCount() : lightBuffer.GetCount(),
+                       sceneTime.GetAverage() / 1e6);
+
+                if (clustered) {
+                    const auto& builder = clusteredLights.GetBuilder();
+                    auto clusterStats = builder.GetStats();
+                    printf("clusters: %.1f us/frame binning on %zu threads, %zu of %zu clusters lit, %.1f lights per lit cluster, %zu at most\n",
+                           binTicks * 1e6 / SDL_GetPerformanceFrequency() / frames, builder.GetThreadCount(),
+                           clusterStats.nonEmpty, builder.GetClusterCount(),
+                           clusterStats.nonEmpty > 0 ? static_cast<double>(clusterStats.references) / clusterStats.nonEmpty : 0.0,
+                           clusterStats.maxLights);
+                }
+
+                const auto& stateStats = GL::StateCache::GetStats();
+                auto stateTotal = stateStats.Total();
+                printf("state cache: %zu of %zu state calls reached gl per frame, hit rates: programs %.0f%%, vaos %.0f%%, textures %.0f%%, buffers %.0f%%\n",
+                       (stateTotal.calls - stateTotal.skipped) / frames, stateTotal.calls / frames,
+                       stateStats.programs.HitRate() * 100.0, stateStats.vertexArrays.HitRate() * 100.0,
+                       stateStats.textures.HitRate() * 100.0, stateStats.buffers.HitRate() * 100.0);
+
+                // the last frame's, the graph and its textures only change with the window size and the toggles
+                const auto& graphStats = renderGraph.GetStats();
+                printf("render graph: %zu of %zu passes culled, %zu transient textures in %zu, %.1f MiB (%.1f MiB without aliasing), %.1f MiB pooled\n",
+                       graphStats.culledPasses, graphStats.passes, graphStats.transientTextures, graphStats.allocatedTextures,
+                       graphStats.allocatedBytes / 1048576.0, graphStats.transientBytes / 1048576.0, graphStats.pooledBytes / 1048576.0);
+
+                if (drawCrowd && gpuCulling) {
+                    printf("crowd: %zu instances culled on the gpu, the survivors never come back to the cpu\n", gpuCuller->GetInstanceCount());
+                } else if (drawCrowd) {
+                    printf("crowd: %zu of %zu instances in view\n", crowdDrawn / frames, crowd.size());
+                }
+            }
+
+            drawStats = {};
+            renderStats = {};
+            indirectStats = {};
+            GL::Program::ResetUniformStats();
+            GL::StateCache::ResetStats();
+            shadedSamples.Reset();
+            sceneTime.Reset();
+            cullTicks = 0;
+            binTicks = 0;
+            visibleMeshes = 0;
+            occludedMeshes = 0;
+            texCubeHidden = 0;
+            crowdDrawn = 0;
+            frames = 0;
+            statsStart = now;
+        }
     }
 
     return 0;
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Util/ClusterBuilder.hpp"
+
+static int s_failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+    if (!condition) {
+        fprintf(stderr, "failed: %s\n", what);
+        ++s_failures;
+    }
+}
+
+/// Picks random points in the frustum, most of them close to the camera, and counts the lights that reach a point
+/// but are missing from the list of the cluster the point falls in
+static size_t CountMissing(const Engine::Util::ClusterBuilder& builder, const std::vector<Engine::Util::ClusterLight>& lights,
+                           const glm::mat4& projection, const glm::mat4& view, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    const auto& ranges = builder.GetRanges();
+    const auto& indices = builder.GetIndices();
+    auto inverse = glm::inverse(projection);
+    size_t missed = 0;
+
+    for (size_t sample = 0; sample < 50000; ++sample) {
+        glm::vec2 ndc(unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f);
+        auto depth = unit(rng) * unit(rng) * builder.GetFar();
+
+        auto onNear = inverse * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+        auto ray = glm::vec3(onNear) / onNear.w;
+        auto viewPoint = ray * (depth / -ray.z);
+
+        auto cluster = builder.GetCluster(ndc, depth);
+
+        if (cluster == static_cast<size_t>(-1)) {
+            continue;
+        }
+
+        auto first = indices.begin() + ranges[cluster * 2];
+        auto last = first + ranges[cluster * 2 + 1];
+
+        for (size_t l = 0; l < lights.size(); ++l) {
+            const auto& light = lights[l];
+            auto toPoint = viewPoint - glm::vec3(view * glm::vec4(light.position, 1.0f));
+            auto distance = glm::length(toPoint);
+
+            if (distance >= light.radius) {
+                continue;
+            }
+
+            if (light.cosAngle > -1.0f) {
+                auto axis = glm::mat3(view) * light.direction;
+
+                if (distance > 0.0f && glm::dot(toPoint / distance, axis) < light.cosAngle) {
+                    continue;
+                }
+            }
+
+            missed += std::find(first, last, static_cast<uint16_t>(l)) == last;
+        }
+    }
+
+    return missed;
+}
+
+/// Bins point and spot lights spread over the scene, around the camera and behind it with the demo's grid and
+/// projection, on one thread and on several, and checks every light reaching a point is in that point's cluster
+int main()
+{
+    using namespace Engine;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    const glm::vec3 eye(0.0f, 2.0f, 8.0f);
+    auto projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+    auto view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    auto forward = glm::normalize(-eye);
+
+    // a fifth of them spot lights pointing somewhere downwards, every eighth one around the camera
+    std::vector<Util::ClusterLight> lights;
+
+    for (size_t i = 0; i < 512; ++i) {
+        Util::ClusterLight light{};
+        light.position = {unit(rng) * 40.0f - 20.0f, unit(rng) * 10.0f - 5.0f, unit(rng) * 45.0f - 40.0f};
+        light.radius = 1.0f + unit(rng) * 4.0f;
+        light.cosAngle = -1.0f;
+
+        if (i % 8 == 1) {
+            light.position = eye + glm::vec3(unit(rng) * 4.0f - 2.0f, unit(rng) * 4.0f - 2.0f, unit(rng) * 6.0f - 3.0f);
+        }
+
+        if (i % 5 == 0) {
+            light.direction = glm::normalize(glm::vec3(unit(rng) - 0.5f, -1.0f, unit(rng) - 0.5f));
+            light.cosAngle = std::cos(glm::radians(15.0f + unit(rng) * 30.0f));
+        }
+
+        lights.push_back(light);
+    }
+
+    // the slicing starts at 0.5, so these two only reach the first slice from closer than that: one between the
+    // camera and there, one behind the camera
+    auto betweenIndex = lights.size();
+    lights.push_back({eye + forward * 0.25f, 0.5f, glm::vec3(0.0f), -1.0f});
+
+    auto behindIndex = lights.size();
+    lights.push_back({eye - forward * 1.0f, 1.3f, glm::vec3(0.0f), -1.0f});
+
+    std::vector<uint32_t> singleRanges;
+    std::vector<uint16_t> singleIndices;
+
+    for (size_t threads : {1, 4}) {
+        Util::ClusterBuilder builder({16, 9, 24}, threads);
+        builder.SetProjection(projection, 0.5f, 100.0f);
+        builder.Build(lights, view);
+
+        Check(builder.GetThreadCount() == threads, "the builder runs on as many threads as asked for");
+        Check(CountMissing(builder, lights, projection, view, rng) == 0, "every light reaching a point is in its cluster");
+
+        // the middle of the screen, just in front of the near plane, in the first slice
+        auto cluster = builder.GetCluster({0.0f, 0.0f}, 0.2f);
+        const auto& ranges = builder.GetRanges();
+        auto first = builder.GetIndices().begin() + ranges[cluster * 2];
+        auto last = first + ranges[cluster * 2 + 1];
+
+        Check(cluster != static_cast<size_t>(-1) && cluster < builder.GetDimensions().x * builder.GetDimensions().y,
+              "a point closer than where the slicing starts is in the first slice");
+        Check(std::find(first, last, static_cast<uint16_t>(betweenIndex)) != last,
+              "a light between the camera and the first slice's far end is binned into it");
+        Check(std::find(first, last, static_cast<uint16_t>(behindIndex)) != last,
+              "a light behind the camera reaching in front of it is binned into the first slice");
+
+        if (threads == 1) {
+            singleRanges = builder.GetRanges();
+            singleIndices = builder.GetIndices();
+        } else {
+            Check(builder.GetRanges() == singleRanges && builder.GetIndices() == singleIndices,
+                  "several threads bin the same lists as one");
+        }
+    }
+
+    if (s_failures == 0) {
+        printf("all cluster builder checks passed\n");
+    }
+
+    return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include <cmath>
+#include <cstdio>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Util/MeshData.hpp"
+#include "Util/OcclusionBuffer.hpp"
+
+static int s_failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+    if (!condition) {
+        fprintf(stderr, "failed: %s\n", what);
+        ++s_failures;
+    }
+}
+
+/// Rasterizes a box whose front face is 2 x 2 at 5 units in front of a camera at the origin, then checks the
+/// depth written under it and left alone around it, and which boxes it hides
+int main()
+{
+    using namespace Engine;
+
+    auto projection = glm::perspective(glm::radians(90.0f), 2.0f, 0.1f, 100.0f);
+
+    Util::OcclusionBuffer buffer(256, 128);
+    buffer.Clear();
+    buffer.BuildHierarchy();
+
+    Check(buffer.TestAabb({-1.0f, -1.0f, -50.0f}, {1.0f, 1.0f, -49.0f}, projection), "everything is visible in a cleared buffer");
+
+    auto occluder = Util::MakeBox({-1.0f, -1.0f, -6.0f}, {1.0f, 1.0f, -5.0f});
+    buffer.RasterizeOccluder(occluder.positions, occluder.indices, projection);
+    buffer.BuildHierarchy();
+
+    // the front face is parallel to the near plane, so every pixel it covers has the same depth
+    auto front = projection * glm::vec4(0.0f, 0.0f, -5.0f, 1.0f);
+    auto expected = front.z / front.w * 0.5f + 0.5f;
+
+    Check(std::abs(buffer.GetDepth(128, 64) - expected) < 1e-4f, "the middle pixel has the front face's depth");
+    Check(std::abs(buffer.GetDepth(120, 70) - expected) < 1e-4f, "a pixel off the middle has the front face's depth");
+
+    // the front face covers x and y within 1 / 5 of the way to the frustum's sides, 128 +- 12.8 by 64 +- 12.8
+    Check(buffer.GetDepth(100, 64) == 1.0f, "a pixel left of the occluder stays at the far plane");
+    Check(buffer.GetDepth(128, 90) == 1.0f, "a pixel above the occluder stays at the far plane");
+    Check(buffer.GetDepth(0, 0) == 1.0f, "the corner stays at the far plane");
+
+    Check(!buffer.TestAabb({-0.5f, -0.5f, -20.0f}, {0.5f, 0.5f, -19.0f}, projection), "a box behind the occluder is hidden");
+    Check(buffer.TestAabb({-0.2f, -0.2f, -3.0f}, {0.2f, 0.2f, -2.5f}, projection), "a box in front of the occluder is visible");
+    Check(buffer.TestAabb({6.0f, -0.5f, -20.0f}, {7.0f, 0.5f, -19.0f}, projection), "a box beside the occluder is visible");
+    Check(buffer.TestAabb({-8.0f, -0.5f, -20.0f}, {8.0f, 0.5f, -19.0f}, projection), "a box wider than the occluder is visible");
+    Check(buffer.TestAabb({-0.5f, -0.5f, -20.0f}, {0.5f, 0.5f, 1.0f}, projection), "a box crossing the near plane is visible");
+
+    if (s_failures == 0) {
+        printf("all occlusion buffer checks passed\n");
+    }
+
+    return s_failures == 0 ? 0 : 1;
+}
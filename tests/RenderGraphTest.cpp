@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Video/RenderGraph.hpp"
+
+static int s_failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+    if (!condition) {
+        fprintf(stderr, "failed: %s\n", what);
+        ++s_failures;
+    }
+}
+
+// just enough of GL for the graph to run without a context: names count up, framebuffers remember what's
+// attached to them
+static GLuint s_nextName = 1;
+static GLuint s_boundFramebuffer = 0;
+static std::map<GLuint, std::vector<GLuint>> s_framebuffers;
+static size_t s_framebuffersCreated = 0;
+
+static void APIENTRY GenNames(GLsizei n, GLuint* names)
+{
+    for (GLsizei i = 0; i < n; ++i) {
+        names[i] = s_nextName++;
+    }
+}
+
+static void APIENTRY GenFramebuffers(GLsizei n, GLuint* names)
+{
+    GenNames(n, names);
+    s_framebuffersCreated += n;
+}
+
+static void APIENTRY DeleteFramebuffers(GLsizei n, const GLuint* names)
+{
+    for (GLsizei i = 0; i < n; ++i) {
+        s_framebuffers.erase(names[i]);
+    }
+}
+
+static void APIENTRY BindFramebuffer(GLenum, GLuint framebuffer)
+{
+    s_boundFramebuffer = framebuffer;
+}
+
+static void APIENTRY FramebufferTexture2D(GLenum, GLenum, GLenum, GLuint texture, GLint)
+{
+    s_framebuffers[s_boundFramebuffer].push_back(texture);
+}
+
+static GLenum APIENTRY CheckFramebufferStatus(GLenum)
+{
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void APIENTRY GetIntegerv(GLenum, GLint* values)
+{
+    values[0] = 0;
+    values[1] = 0;
+    values[2] = 1280;
+    values[3] = 720;
+}
+
+static void APIENTRY Ignore(GLenum) {}
+static void APIENTRY IgnoreBind(GLenum, GLuint) {}
+static void APIENTRY IgnoreDelete(GLsizei, const GLuint*) {}
+static void APIENTRY IgnoreDrawBuffers(GLsizei, const GLenum*) {}
+static void APIENTRY IgnoreParameter(GLenum, GLenum, GLint) {}
+static void APIENTRY IgnoreViewport(GLint, GLint, GLsizei, GLsizei) {}
+static void APIENTRY IgnoreImage(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) {}
+
+/// The bloom chain, its passes declared out of order, with or without the composite reading its result
+static void DeclareBloom(Engine::GL::RenderGraph& graph, bool composite, std::vector<Engine::GL::RenderResource>& textures)
+{
+    using namespace Engine::GL;
+
+    auto backbuffer = graph.ImportBackbuffer();
+    auto scene = graph.CreateTexture("scene", {GL_RGBA8, 1280, 720});
+    auto bright = graph.CreateTexture("bright", {GL_RGBA16F, 640, 360});
+    auto horizontal = graph.CreateTexture("horizontal", {GL_RGBA16F, 640, 360});
+    auto vertical = graph.CreateTexture("vertical", {GL_RGBA16F, 640, 360});
+    auto none = [](const RenderGraph&) {};
+
+    graph.AddPass("blur vertical", [&](RenderPassBuilder& pass) {
+        pass.Read(horizontal);
+        pass.Write(vertical);
+    }, none);
+
+    graph.AddPass("resolve", [&](RenderPassBuilder& pass) {
+        pass.Read(backbuffer);
+        pass.Write(scene);
+    }, none);
+
+    graph.AddPass("bright", [&](RenderPassBuilder& pass) {
+        pass.Read(scene);
+        pass.Write(bright);
+    }, none);
+
+    graph.AddPass("blur horizontal", [&](RenderPassBuilder& pass) {
+        pass.Read(bright);
+        pass.Write(horizontal);
+    }, none);
+
+    if (composite) {
+        graph.AddPass("composite", [&](RenderPassBuilder& pass) {
+            pass.Read(vertical);
+            pass.Write(backbuffer);
+        }, none);
+    }
+
+    textures = {scene, bright, horizontal, vertical};
+}
+
+/// Runs a pass rendering into an imported texture and returns how many framebuffers the graph had to create
+static size_t RenderToImport(Engine::GL::RenderGraph& graph, GLuint texture, int width)
+{
+    using namespace Engine::GL;
+
+    auto created = s_framebuffersCreated;
+
+    graph.Reset();
+    auto target = graph.ImportTexture("target", texture, {GL_RGBA8, width, 64});
+    graph.AddPass("draw", [&](RenderPassBuilder& pass) { pass.Write(target); }, [](const RenderGraph&) {});
+    graph.Execute();
+
+    return s_framebuffersCreated - created;
+}
+
+/// Checks the order, culling and texture sharing Compile comes up with, and that framebuffers built on imported
+/// textures don't outlive the import, with GL replaced by functions that only keep track of names
+int main()
+{
+    using namespace Engine::GL;
+
+    glad_glGenTextures = GenNames;
+    glad_glDeleteTextures = IgnoreDelete;
+    glad_glActiveTexture = Ignore;
+    glad_glBindTexture = IgnoreBind;
+    glad_glTexImage2D = IgnoreImage;
+    glad_glTexParameteri = IgnoreParameter;
+    glad_glGenFramebuffers = GenFramebuffers;
+    glad_glDeleteFramebuffers = DeleteFramebuffers;
+    glad_glBindFramebuffer = BindFramebuffer;
+    glad_glFramebufferTexture2D = FramebufferTexture2D;
+    glad_glCheckFramebufferStatus = CheckFramebufferStatus;
+    glad_glDrawBuffer = Ignore;
+    glad_glDrawBuffers = IgnoreDrawBuffers;
+    glad_glGetIntegerv = GetIntegerv;
+    glad_glViewport = IgnoreViewport;
+
+    RenderGraph graph;
+    std::vector<RenderResource> textures;
+
+    DeclareBloom(graph, true, textures);
+    graph.Execute();
+
+    std::vector<std::string> expected{"resolve", "bright", "blur horizontal", "blur vertical", "composite"};
+    Check(graph.GetExecutionOrder() == expected, "passes run in dependency order, not declaration order");
+    Check(graph.GetStats().culledPasses == 0, "nothing is culled when the composite reads the blur");
+
+    // the vertical blur starts after the bright pass's texture is last read, and has its format and size
+    Check(graph.GetTexture(textures[3]) == graph.GetTexture(textures[1]), "the vertical blur shares the bright pass's texture");
+    Check(graph.GetTexture(textures[2]) != graph.GetTexture(textures[1]), "the horizontal blur gets a texture of its own");
+    Check(graph.GetStats().transientTextures == 4 && graph.GetStats().allocatedTextures == 3, "4 transients fit in 3 textures");
+
+    graph.Reset();
+    DeclareBloom(graph, false, textures);
+    graph.Execute();
+
+    Check(graph.GetExecutionOrder().empty(), "without the composite, no pass leads to a side effect");
+    Check(graph.GetStats().culledPasses == 4, "every pass of the chain is culled");
+
+    graph.Reset();
+    auto cycled = graph.CreateTexture("cycled", {GL_R8, 4, 4});
+    auto backbuffer = graph.ImportBackbuffer();
+    graph.AddPass("first", [&](RenderPassBuilder& pass) {
+        pass.Read(cycled);
+        pass.Write(backbuffer);
+    }, [](const RenderGraph&) {});
+    graph.AddPass("second", [&](RenderPassBuilder& pass) {
+        pass.Read(backbuffer);
+        pass.Write(cycled);
+    }, [](const RenderGraph&) {});
+
+    bool threw = false;
+
+    try {
+        graph.Compile();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+
+    Check(threw, "passes reading each other's writes are a cycle");
+
+    // A reads what the backbuffer came with, and a transient only C, declared last, writes. B overwriting the
+    // backbuffer still has to wait for A, though A doesn't need anything from it
+    graph.Reset();
+    auto shared = graph.ImportBackbuffer();
+    auto late = graph.CreateTexture("late", {GL_R8, 4, 4});
+    graph.AddPass("A", [&](RenderPassBuilder& pass) {
+        pass.Read(shared);
+        pass.Read(late);
+        pass.SetSideEffect();
+    }, [](const RenderGraph&) {});
+    graph.AddPass("B", [&](RenderPassBuilder& pass) { pass.Write(shared); }, [](const RenderGraph&) {});
+    graph.AddPass("C", [&](RenderPassBuilder& pass) { pass.Write(late); }, [](const RenderGraph&) {});
+    graph.Compile();
+
+    auto order = graph.GetExecutionOrder();
+    auto position = [&](const char* name) { return std::find(order.begin(), order.end(), name) - order.begin(); };
+
+    Check(order.size() == 3, "reading an import and writing it are both kept");
+    Check(position("C") < position("A"), "a read waits for the write declared after it on a transient");
+    Check(position("A") < position("B"), "a read of an import runs before the later write overwriting it");
+
+    // name 1000 stands for a texture owned by someone else, deleted and created again under the same name
+    Check(RenderToImport(graph, 1000, 64) == 1, "the first frame rendering to an import builds a framebuffer");
+    Check(RenderToImport(graph, 1000, 64) == 0, "the same import the next frame reuses it");
+    Check(RenderToImport(graph, 1000, 128) == 1, "an import reallocated at another size gets a new one");
+
+    graph.Reset();
+    graph.Compile();
+
+    Check(RenderToImport(graph, 1000, 128) == 1, "an import missing for a frame gets a new one when it's back");
+
+    graph.ForgetTexture(1000);
+
+    Check(RenderToImport(graph, 1000, 128) == 1, "ForgetTexture drops the framebuffers built on it");
+
+    size_t attached = 0;
+
+    for (const auto& [framebuffer, attachments] : s_framebuffers) {
+        attached += std::count(attachments.begin(), attachments.end(), 1000u);
+    }
+
+    Check(attached == 1, "only the latest framebuffer on the import is left");
+
+    if (s_failures == 0) {
+        printf("all render graph checks passed\n");
+    }
+
+    return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Util/ClusterBuilder.hpp"
+
+/// Times ClusterBuilder on a random set of point and spot lights, the same grid and projection the demo uses.
+/// Whether the binning is right is tests/ClusterBuilderTest's business
+int main(int argc, char** argv)
+{
+    using namespace Engine;
+
+    size_t lightCount = 1024;
+    size_t iterations = 1000;
+    size_t threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && strcmp(argv[i], "--lights") == 0) {
+            lightCount = strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--iterations") == 0) {
+            iterations = strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+            threads = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--lights n] [--iterations n] [--threads n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    const glm::vec3 eye(0.0f, 2.0f, 8.0f);
+
+    // a fifth of them spot lights, pointing somewhere downwards, and every eighth one around the camera
+    std::vector<Util::ClusterLight> lights;
+
+    for (size_t i = 0; i < lightCount; ++i) {
+        Util::ClusterLight light{};
+        light.position = {unit(rng) * 40.0f - 20.0f, unit(rng) * 10.0f - 5.0f, unit(rng) * 45.0f - 40.0f};
+
+        if (i % 8 == 1) {
+            light.position = eye + glm::vec3(unit(rng) * 4.0f - 2.0f, unit(rng) * 4.0f - 2.0f, unit(rng) * 6.0f - 3.0f);
+        }
+
+        light.radius = 1.0f + unit(rng) * 4.0f;
+        light.cosAngle = -1.0f;
+
+        if (i % 5 == 0) {
+            light.direction = glm::normalize(glm::vec3(unit(rng) - 0.5f, -1.0f, unit(rng) - 0.5f));
+            light.cosAngle = std::cos(glm::radians(15.0f + unit(rng) * 30.0f));
+        }
+
+        lights.push_back(light);
+    }
+
+    auto projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+    auto view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    try {
+        Util::ClusterBuilder builder({16, 9, 24}, threads);
+        builder.SetProjection(projection, 0.5f, 100.0f);
+
+        // the first build grows the lists, it's left out of the timing
+        builder.Build(lights, view);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < iterations; ++i) {
+            builder.Build(lights, view);
+        }
+
+        auto microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        auto stats = builder.GetStats();
+
+        printf("%zu lights into %zu clusters on %zu threads: %.1f us per build\n"
+               "%zu clusters lit, %.1f lights per lit cluster, %zu at most\n",
+               lights.size(), builder.GetClusterCount(), builder.GetThreadCount(), microseconds / std::max<size_t>(iterations, 1),
+               stats.nonEmpty, stats.nonEmpty > 0 ? static_cast<double>(stats.references) / stats.nonEmpty : 0.0, stats.maxLights);
+
+        return 0;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
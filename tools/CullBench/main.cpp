@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Util/CullTable.hpp"
+#include "Util/Frustum.hpp"
+
+/// Times CullTable::Cull over a table of random spheres, 100k by default, from cameras turning around the middle
+/// of them, against a plain loop calling Frustum::TestSphere on an array of structures. Both have to agree on
+/// every entry
+int main(int argc, char** argv)
+{
+    using namespace Engine;
+
+    size_t count = 100000;
+    size_t iterations = 200;
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && strcmp(argv[i], "--objects") == 0) {
+            count = strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--iterations") == 0) {
+            iterations = std::max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else {
+            fprintf(stderr, "usage: %s [--objects n] [--iterations n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    struct Sphere {
+        glm::vec3 center;
+        float radius;
+    };
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::vector<Sphere> spheres;
+    Util::CullTable table;
+
+    for (size_t i = 0; i < count; ++i) {
+        Sphere sphere{{unit(rng) * 400.0f - 200.0f, unit(rng) * 20.0f - 10.0f, unit(rng) * 400.0f - 200.0f}, 0.5f + unit(rng) * 2.0f};
+
+        spheres.push_back(sphere);
+        table.Add(sphere.center, sphere.radius);
+    }
+
+    auto projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+    std::vector<uint8_t> reference(count);
+    size_t mismatches = 0;
+
+    // the same table from a camera looking along the ground and one looking down from above it, where fewer of
+    // the spheres are in view
+    const glm::vec3 eyes[] = {{0.0f, 2.0f, 0.0f}, {0.0f, 60.0f, 0.0f}};
+    const glm::vec3 targets[] = {{0.0f, 2.0f, -1.0f}, {0.0f, 0.0f, -1.0f}};
+    const char* names[] = {"along the ground", "from above"};
+
+    for (size_t c = 0; c < std::size(eyes); ++c) {
+        double tableSeconds = 0.0, referenceSeconds = 0.0;
+        size_t visible = 0;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            auto angle = glm::radians(360.0f) * static_cast<float>(i) / static_cast<float>(iterations);
+            auto rotation = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f));
+            auto target = eyes[c] + glm::vec3(rotation * glm::vec4(targets[c] - eyes[c], 0.0f));
+            Util::Frustum frustum(projection * glm::lookAt(eyes[c], target, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+            auto start = std::chrono::steady_clock::now();
+            auto tableVisible = table.Cull(frustum);
+            auto middle = std::chrono::steady_clock::now();
+
+            size_t referenceVisible = 0;
+
+            for (size_t s = 0; s < count; ++s) {
+                reference[s] = frustum.TestSphere(spheres[s].center, spheres[s].radius);
+                referenceVisible += reference[s];
+            }
+
+            auto end = std::chrono::steady_clock::now();
+
+            tableSeconds += std::chrono::duration<double>(middle - start).count();
+            referenceSeconds += std::chrono::duration<double>(end - middle).count();
+            visible += tableVisible;
+
+            for (size_t s = 0; s < count; ++s) {
+                mismatches += table.IsVisible(s) != (reference[s] != 0);
+            }
+
+            mismatches += tableVisible != referenceVisible;
+        }
+
+        printf("%zu objects %s: %zu visible, %.1f us per cull table pass, %.1f us per array of structures loop\n",
+               count, names[c], visible / iterations, tableSeconds * 1e6 / iterations, referenceSeconds * 1e6 / iterations);
+    }
+
+    printf("%zu entries culled differently from Frustum::TestSphere\n", mismatches);
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Util/AssimpLoader.hpp"
+#include "Util/Frustum.hpp"
+#include "Util/IndexOptimizer.hpp"
+#include "Util/Meshlets.hpp"
+
+/// Splits a model into meshlets the way the loader does and culls them from cameras circling it, once with the
+/// whole model in view and once from close up, with the demo's projection. Prints the triangles that survive
+/// frustum and normal cone culling against the model's total and how long culling takes, without a GPU or vsync
+/// in the way. The GPU side of the comparison is the lit scene time ufrrj-cg --stats prints
+int main(int argc, char** argv)
+{
+    using namespace Engine;
+
+    const char* path = "cyborg.obj";
+    size_t views = 64;
+    size_t iterations = 100;
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && strcmp(argv[i], "--views") == 0) {
+            views = std::max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else if (i + 1 < argc && strcmp(argv[i], "--iterations") == 0) {
+            iterations = std::max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else if (argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [model] [--views n] [--iterations n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        auto mesh = Util::AssimpLoader::LoadMeshData(path);
+        Util::IndexOptimizer::Optimize(mesh);
+
+        auto meshlets = Util::BuildMeshlets(mesh);
+        auto triangles = mesh.indices.size() / 3;
+
+        glm::vec3 lower(INFINITY), upper(-INFINITY);
+
+        for (const auto& position : mesh.positions) {
+            lower = glm::min(lower, position);
+            upper = glm::max(upper, position);
+        }
+
+        auto center = (lower + upper) * 0.5f;
+        auto radius = glm::length(upper - lower) * 0.5f;
+
+        printf("%s: %zu triangles in %zu meshlets\n", path, triangles, meshlets.size());
+
+        auto projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f * radius);
+
+        // far enough for the whole model to fit the vertical field of view, and close enough to only see part of it
+        const float distances[] = {radius / std::sin(glm::radians(22.5f)), radius * 1.2f};
+        const char* names[] = {"whole model in view", "close up"};
+
+        for (size_t d = 0; d < std::size(distances); ++d) {
+            size_t drawn = 0, frustumDrawn = 0;
+            double seconds = 0.0;
+
+            for (size_t v = 0; v < views; ++v) {
+                auto angle = glm::radians(360.0f) * static_cast<float>(v) / static_cast<float>(views);
+                auto eye = center + glm::vec3(std::sin(angle), 0.3f, std::cos(angle)) * distances[d];
+                Util::Frustum frustum(projection * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+                size_t viewDrawn = 0;
+                auto start = std::chrono::steady_clock::now();
+
+                // the same tests as Mesh::DrawCulledBound, with the model matrix the identity
+                for (size_t i = 0; i < iterations; ++i) {
+                    viewDrawn = 0;
+
+                    for (const auto& meshlet : meshlets) {
+                        if (frustum.TestSphere(meshlet.center, meshlet.radius) && !meshlet.IsBackfacing(eye)) {
+                            viewDrawn += meshlet.indexCount / 3;
+                        }
+                    }
+                }
+
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                drawn += viewDrawn;
+
+                for (const auto& meshlet : meshlets) {
+                    frustumDrawn += frustum.TestSphere(meshlet.center, meshlet.radius) ? meshlet.indexCount / 3 : 0;
+                }
+            }
+
+            printf("%s: %zu of %zu triangles drawn (%.0f%%), %zu with frustum culling alone, %.2f us per cull\n",
+                   names[d], drawn / views, triangles, 100.0 * drawn / views / std::max<size_t>(triangles, 1),
+                   frustumDrawn / views, seconds * 1e6 / (views * iterations));
+        }
+
+        return 0;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
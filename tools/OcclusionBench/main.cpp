@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Util/MeshData.hpp"
+#include "Util/OcclusionBuffer.hpp"
+
+/// Times the occlusion buffer on a street of wall occluders with random boxes scattered behind and between them,
+/// seen from cameras walking down it with the demo's projection. Prints how long clearing and rasterizing the
+/// occluders, building the hierarchy and testing the boxes take and how many of the boxes get culled
+int main(int argc, char** argv)
+{
+    using namespace Engine;
+
+    size_t count = 10000;
+    size_t iterations = 200;
+
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && strcmp(argv[i], "--boxes") == 0) {
+            count = strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--iterations") == 0) {
+            iterations = std::max<size_t>(strtoul(argv[++i], nullptr, 10), 1);
+        } else {
+            fprintf(stderr, "usage: %s [--boxes n] [--iterations n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // two rows of houses along the street, each a closed box like the ones occluders stand in for
+    std::vector<Util::MeshData> walls;
+
+    for (int i = 0; i < 20; ++i) {
+        auto z = -10.0f * static_cast<float>(i);
+
+        walls.push_back(Util::MakeBox({-14.0f, 0.0f, z - 8.0f}, {-4.0f, 8.0f, z}));
+        walls.push_back(Util::MakeBox({4.0f, 0.0f, z - 8.0f}, {14.0f, 8.0f, z}));
+    }
+
+    struct Box {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Box> boxes;
+
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 min(unit(rng) * 60.0f - 30.0f, unit(rng) * 4.0f, -unit(rng) * 200.0f);
+        boxes.push_back({min, min + glm::vec3(0.5f + unit(rng))});
+    }
+
+    auto projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+    Util::OcclusionBuffer buffer;
+
+    double rasterizeSeconds = 0.0, hierarchySeconds = 0.0, testSeconds = 0.0;
+    size_t visible = 0;
+
+    for (size_t i = 0; i < iterations; ++i) {
+        // walking down the middle of the street, looking slightly to either side
+        auto step = static_cast<float>(i) / static_cast<float>(iterations);
+        glm::vec3 eye(0.0f, 1.7f, -150.0f * step);
+        auto target = eye + glm::vec3(0.3f * std::sin(step * 20.0f), 0.0f, -1.0f);
+        auto projectionView = projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+        auto start = std::chrono::steady_clock::now();
+
+        buffer.Clear();
+
+        for (const auto& wall : walls) {
+            buffer.RasterizeOccluder(wall.positions, wall.indices, projectionView);
+        }
+
+        auto rasterized = std::chrono::steady_clock::now();
+
+        buffer.BuildHierarchy();
+
+        auto built = std::chrono::steady_clock::now();
+
+        for (const auto& box : boxes) {
+            visible += buffer.TestAabb(box.min, box.max, projectionView);
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        rasterizeSeconds += std::chrono::duration<double>(rasterized - start).count();
+        hierarchySeconds += std::chrono::duration<double>(built - rasterized).count();
+        testSeconds += std::chrono::duration<double>(end - built).count();
+    }
+
+    printf("%zu x %zu buffer, %zu occluders, %zu boxes\n", buffer.GetWidth(), buffer.GetHeight(), walls.size(), count);
+    printf("%.1f us clearing and rasterizing, %.1f us building the hierarchy, %.1f us testing (%.3f us per box)\n",
+           rasterizeSeconds * 1e6 / iterations, hierarchySeconds * 1e6 / iterations, testSeconds * 1e6 / iterations,
+           testSeconds * 1e6 / (iterations * std::max<size_t>(count, 1)));
+    printf("%zu of %zu boxes passed the test on average, %.0f%% culled\n",
+           visible / iterations, count, 100.0 - 100.0 * visible / iterations / std::max<size_t>(count, 1));
+
+    return 0;
+}
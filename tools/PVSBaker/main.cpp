@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Util/AssimpLoader.hpp"
+#include "Util/PVS.hpp"
+
+/// Bakes a potentially visible set for a static scene made of one or more model files.
+/// Each file becomes one object of the set, in the order they're given, placed where it was authored unless
+/// --translate, --rotate-y or --scale follow it. Those combine like translate * rotate * scale, the order the
+/// demo builds its model matrices in
+int main(int argc, char** argv)
+{
+    using namespace Engine;
+
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s output.pvs cell_size model [--translate x y z] [--rotate-y degrees] [--scale s] "
+                        "[model ...] [--samples n] [--rays n] [--threads n]\n", argv[0]);
+        return 1;
+    }
+
+    Util::PvsBakeSettings settings;
+    settings.cellSize = static_cast<float>(atof(argv[2]));
+
+    struct Object {
+        const char* path;
+        glm::vec3 translation{0.0f};
+        float rotationY = 0.0f;
+        float scale = 1.0f;
+    };
+
+    std::vector<Object> objects;
+
+    for (int i = 3; i < argc; ++i) {
+        bool placing = strcmp(argv[i], "--translate") == 0 || strcmp(argv[i], "--rotate-y") == 0 ||
+                       strcmp(argv[i], "--scale") == 0;
+
+        if (placing && objects.empty()) {
+            fprintf(stderr, "%s has to follow the model it places\n", argv[i]);
+            return 1;
+        }
+
+        if (i + 3 < argc && strcmp(argv[i], "--translate") == 0) {
+            objects.back().translation = glm::vec3(atof(argv[i + 1]), atof(argv[i + 2]), atof(argv[i + 3]));
+            i += 3;
+        } else if (i + 1 < argc && strcmp(argv[i], "--rotate-y") == 0) {
+            objects.back().rotationY = static_cast<float>(atof(argv[++i]));
+        } else if (i + 1 < argc && strcmp(argv[i], "--scale") == 0) {
+            objects.back().scale = static_cast<float>(atof(argv[++i]));
+        } else if (i + 1 < argc && strcmp(argv[i], "--samples") == 0) {
+            settings.samplesPerCell = strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--rays") == 0) {
+            settings.raysPerObject = strtoul(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+            settings.threads = strtoul(argv[++i], nullptr, 10);
+        } else if (argv[i][0] != '-') {
+            objects.push_back({argv[i]});
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (settings.cellSize <= 0.0f) {
+        fprintf(stderr, "cell size has to be positive\n");
+        return 1;
+    }
+
+    try {
+        std::vector<Util::MeshData> meshes;
+
+        for (const auto& object : objects) {
+            auto mesh = Util::AssimpLoader::LoadMeshData(object.path);
+
+            auto transform = glm::translate(glm::mat4(1.0f), object.translation);
+            transform = glm::rotate(transform, glm::radians(object.rotationY), glm::vec3(0.0f, 1.0f, 0.0f));
+            transform = glm::scale(transform, glm::vec3(object.scale));
+
+            // the baker only casts rays against positions, so those are all that needs moving into the world
+            for (auto& position : mesh.positions) {
+                position = glm::vec3(transform * glm::vec4(position, 1.0f));
+            }
+
+            meshes.push_back(std::move(mesh));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto pvs = Util::PVS::Bake(meshes, settings);
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        pvs.Save(argv[1]);
+
+        size_t uncompressed = pvs.GetCellCount() * ((pvs.GetObjectCount() + 7) / 8);
+
+        printf("baked %zu cells x %zu objects in %.2fs, %zu bytes of visibility (%zu uncompressed)\n",
+               pvs.GetCellCount(), pvs.GetObjectCount(), seconds, pvs.GetDataSize(), uncompressed);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}